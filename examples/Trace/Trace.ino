@@ -0,0 +1,102 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+ 
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------
+Trace: queries all short addresses and sends the DALI_TRACE entries in
+binary to the serial port, format them on the host with extras/trace:
+  stty -F /dev/ttyUSB0 115200 raw && dalitrace /dev/ttyUSB0
+
+Uncomment #define DALI_TRACE in qqqDALI.h (the library is compiled with it).
+###########################################################################*/
+#include "qqqDALI.h"
+
+#ifndef DALI_TRACE
+#error "Uncomment #define DALI_TRACE in qqqDALI.h"
+#endif
+
+Dali dali;
+
+//ATMEGA328 specific
+#define TX_PIN 3
+#define RX_PIN 4
+
+//is bus asserted
+uint8_t bus_is_high() {
+  return digitalRead(RX_PIN); //slow version
+  //return PIND & (1 << 4); //fast version
+}
+
+//assert bus
+void bus_set_low() {
+  digitalWrite(TX_PIN,HIGH); //opto slow version
+  //PORTD |= (1 << 3); //opto fast version
+  
+  //digitalWrite(TX_PIN,LOW); //diy slow version
+  //PORTD &= ~(1 << 3); //diy fast version
+}
+
+//release bus
+void bus_set_high() {
+  digitalWrite(TX_PIN,LOW); //opto slow version
+  //PORTD &= ~(1 << 3); //opto fast version
+  
+  //digitalWrite(TX_PIN,HIGH); //diy slow version
+  //PORTD |= (1 << 3); //diy fast version
+}
+
+void bus_init() {
+  //setup rx pin
+  pinMode(4, INPUT);
+
+  //setup tx pin
+  pinMode(3, OUTPUT);
+  
+  //setup tx timer interrupt
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TCNT1  = 0;
+  OCR1A  = (F_CPU + DALI_TICKS_PER_SECOND / 2) / DALI_TICKS_PER_SECOND; // compare match register at baud rate * DALI_OVERSAMPLE
+  TCCR1B |= (1 << WGM12);   // CTC mode
+  TCCR1B |= (1 << CS10);    // 1:1 prescaler 
+  TIMSK1 |= (1 << OCIE1A);  // enable timer compare interrupt
+}
+
+ISR(TIMER1_COMPA_vect) {
+  dali.timer();
+}
+
+//send the trace entries, 8 bytes each
+void trace_drain() {
+  DaliTraceEntry e;
+  while(dali.trace.read(&e)) {
+    uint8_t b[8] = {(uint8_t)e.tick, (uint8_t)(e.tick >> 8), (uint8_t)(e.tick >> 16), (uint8_t)(e.tick >> 24), e.id, e.a, e.b, e.c};
+    Serial.write(b, 8);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  dali.begin(bus_is_high, bus_set_high, bus_set_low);
+  bus_init();
+  dali.wait_hook = trace_drain; //drain while cmd() waits for the bus
+}
+
+void loop() {
+  for(uint8_t adr = 0; adr < 64; adr++) {
+    dali.cmd(DALI_QUERY_ACTUAL_LEVEL, adr);
+    trace_drain();
+  }
+  delay(1000);
+}
@@ -0,0 +1,107 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+cmd_bench - host CPU time per command, cmd() vs. typed send<>(), and a
+check that both produce the same forward frames and reject out of range
+runtime addresses
+
+Build:
+  g++ -O2 -I../.. -o cmd_bench cmd_bench.cpp ../../qqqDALI.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+
+#include <stdio.h>
+#include <time.h>
+
+//records the last forward frame, gear never reply
+class RecordTransport : public DaliTransport {
+public:
+  uint16_t last;
+  uint32_t frames;
+  int16_t transact(uint8_t *data, uint8_t, uint16_t) {
+    last = (data[0] << 8) | data[1];
+    frames++;
+    return -DALI_RESULT_NO_REPLY;
+  }
+  uint32_t tick() { return 0; }
+};
+
+static Dali dali;
+static RecordTransport rec;
+
+static double now_s() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main() {
+  dali.begin(&rec);
+  int bad = 0;
+
+  //same frames
+  for(uint8_t i = 0; i < 64; i++) {
+    dali.cmd(DALI_QUERY_STATUS, i);
+    uint16_t a = rec.last;
+    dali.send<DALI_QUERY_STATUS>(DaliShortAdr(i));
+    if(a != rec.last) bad++;
+  }
+  for(uint8_t g = 0; g < 16; g++) {
+    dali.cmd(DALI_OFF, 64 + g);
+    uint16_t a = rec.last;
+    dali.send<DALI_OFF>(DaliGroupAdr(g));
+    if(a != rec.last) bad++;
+  }
+  dali.cmd(DALI_RECALL_MAX_LEVEL, 0x7F);
+  uint16_t a = rec.last;
+  dali.send<DALI_RECALL_MAX_LEVEL>(DaliBroadcast());
+  if(a != rec.last) bad++;
+  dali.set_level(100, 5);
+  a = rec.last;
+  dali.dapc(DaliShort<5>(), 100);
+  if(a != rec.last) bad++;
+  uint32_t f0 = rec.frames;
+  dali.send<DALI_SET_MAX_LEVEL>(DaliBroadcast(), 200);
+  dali.send<DALI_SET_MIN_LEVEL>(DaliBroadcast(), 200); //DTR0 already holds 200
+  if(rec.frames - f0 != 5 || rec.last != 0xFF2B) bad++;
+  dali.cmd(DALI_COMPARE, 0);
+  a = rec.last;
+  dali.send_special<DALI_COMPARE>(0);
+  if(a != rec.last) bad++;
+  if(dali.cmd(DALI_OFF, 0x55) != -DALI_RESULT_INVALID_CMD) bad++;
+  //out of range at runtime: rejected, not wrapped to another gear
+  volatile int adr = 65;
+  f0 = rec.frames;
+  if(dali.send<DALI_OFF>(DaliShortAdr(adr)) != -DALI_RESULT_INVALID_CMD) bad++;
+  if(dali.dapc(DaliGroupAdr(adr - 49), 0) != -DALI_RESULT_INVALID_CMD) bad++;
+  if(rec.frames != f0) bad++;
+  printf("frames: %s\n", bad ? "FAIL" : "ok");
+
+  //cpu time per command
+  const int n = 10000000;
+  double t0 = now_s();
+  for(int i = 0; i < n; i++) dali.cmd(DALI_QUERY_STATUS, i & 0x3F);
+  double t1 = now_s();
+  for(int i = 0; i < n; i++) dali.send<DALI_QUERY_STATUS>(DaliShortAdr(i & 0x3F));
+  double t2 = now_s();
+  for(int i = 0; i < n; i++) dali.send<DALI_QUERY_STATUS>(DaliShort<7>());
+  double t3 = now_s();
+  printf("cmd(DALI_QUERY_STATUS, adr)                 %5.1f ns\n", (t1 - t0) / n * 1e9);
+  printf("send<DALI_QUERY_STATUS>(DaliShortAdr(adr))  %5.1f ns\n", (t2 - t1) / n * 1e9);
+  printf("send<DALI_QUERY_STATUS>(DaliShort<7>())     %5.1f ns\n", (t3 - t2) / n * 1e9);
+  return bad;
+}
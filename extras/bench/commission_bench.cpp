@@ -0,0 +1,111 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+commission_bench - bus time to add new gear to a populated bus: commission()
+(INITIALISE unaddressed gear, query all 64 short addresses, search) vs.
+commission_new() (short addresses from a known bitmap, each assignment
+verified), and commissioning the whole bus from scratch, on frame level
+simulated gear
+
+Build:
+  g++ -O2 -I../.. -o commission_bench commission_bench.cpp ../../qqqDALI.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+
+static Dali dali;
+#define CASES 4
+
+static DaliSimGearBus buses[CASES * 3], *bus; //a fresh bus per run
+static uint8_t nbus;
+
+static void wait_step() { bus->now++; } //time passes while commission_new() waits
+
+//bus with the short addresses 0..cnt-1 except hole, plus new_cnt gear without short address
+static void populate(DaliSimGearBus *b, uint8_t cnt, uint8_t hole, uint8_t new_cnt) {
+  for(uint8_t i = 0; i < cnt; i++) {
+    if(i != hole) b->add(i);
+  }
+  for(uint8_t i = 0; i < new_cnt; i++) b->add(0xFF);
+}
+
+//all gear have different short addresses, returns the bitmap of them
+static uint8_t check(DaliSimGearBus *b, uint64_t *bits) {
+  *bits = 0;
+  for(uint8_t i = 0; i < b->gear_cnt; i++) {
+    uint8_t sa = b->gear[i].shortadr;
+    if(sa >= 64 || ((*bits >> sa) & 1)) return 0;
+    *bits |= (uint64_t)1 << sa;
+  }
+  return 1;
+}
+
+static void report(const char *name, uint8_t n, uint32_t f0, uint32_t t0) {
+  printf("  %-34s assigned=%2u frames=%5u bus=%7.2fs\n", name, n, (unsigned)(bus->frames - f0), (bus->now - t0) / (double)DALI_TICKS_PER_SECOND);
+}
+
+int main() {
+  dali.wait_hook = wait_step;
+  int bad = 0;
+  static const uint8_t cases[CASES][2] = {{16, 1}, {48, 1}, {64, 1}, {64, 3}}; //gear on the bus (incl. the new ones), new gear
+  for(uint8_t c = 0; c < CASES; c++) {
+    uint8_t cnt = cases[c][0], new_cnt = cases[c][1];
+    uint8_t hole = cnt / 3; //short address of the replaced driver
+    printf("%u gear, %u new (replaced short address %u%s):\n", cnt, new_cnt, hole, new_cnt > 1 ? " and the top ones" : "");
+    uint64_t bits;
+
+    //commission(): queries all 64 short addresses
+    bus = &buses[nbus++];
+    populate(bus, cnt - new_cnt + 1, hole, new_cnt);
+    dali.begin(bus);
+    uint32_t f0 = bus->frames, t0 = bus->now;
+    uint8_t n = dali.commission(0xFF);
+    report("commission(0xFF)", n, f0, t0);
+    if(n != new_cnt || !check(bus, &bits)) bad |= 1;
+
+    //commission_new(): known used short addresses
+    bus = &buses[nbus++];
+    populate(bus, cnt - new_cnt + 1, hole, new_cnt);
+    dali.begin(bus);
+    uint64_t used = 0;
+    for(uint8_t i = 0; i < bus->gear_cnt; i++) {
+      if(bus->gear[i].shortadr < 64) used |= (uint64_t)1 << bus->gear[i].shortadr;
+    }
+    f0 = bus->frames;
+    t0 = bus->now;
+    n = dali.commission_new(&used);
+    report("commission_new(&used)", n, f0, t0);
+    if(n != new_cnt || !check(bus, &bits) || bits != used) bad |= 2;
+    if(new_cnt == 1 && bus->gear[bus->gear_cnt - 1].shortadr != hole) bad |= 2; //first free short address
+
+    //whole bus from scratch
+    bus = &buses[nbus++];
+    populate(bus, cnt - new_cnt + 1, hole, new_cnt);
+    dali.begin(bus);
+    f0 = bus->frames;
+    t0 = bus->now;
+    n = dali.commission(0x00);
+    report("commission(0x00) whole bus", n, f0, t0);
+    if(n != cnt || !check(bus, &bits)) bad |= 4;
+  }
+
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
@@ -0,0 +1,168 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+compare_bench - bus time of compare() and of commissioning, on the sample
+level simulated bus with emulated gear (DaliGearEmu, 8 ms reply delay)
+
+compare() returns YES once the bus was low for the start bit half bit of
+the reply and NO when the reply window closes, and repeats COMPARE
+compare_retry times after no reply. A glitch in the reply window (a 2
+sample low pulse) must not read as YES. The gear can miss COMPAREs (a lossy frame handler in front of the
+emulation drops the reply with a given probability), the compare_retries
+and compare_retry_yes counters show how often the retry was needed.
+Per run: bus time of one compare() answered YES and NO, and of
+commission() for 8 gear, which must all get different short addresses and
+return 8: every run fails otherwise, also without the retry. Returning
+after the start bit half bit frees the caller, but saves no bus time:
+the next forward frame still waits for the end of the reply. NO returns
+when the reply window closes, 10 ms after the forward frame. The retry
+doubles the time of every NO: the counters tell whether a bus needs it.
+
+Build:
+  g++ -O2 -I../.. -o compare_bench compare_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_gear.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_gear.h"
+#include "../sim/dali_sim_bus.h"
+
+#include <stdio.h>
+
+#define GEAR_CNT 8
+#define N 200 //compare() calls per measurement
+
+static Dali ctl, emu, noise;
+static int noise_node;
+static uint8_t glitch; //low samples of a glitch 5 ms after every forward frame, 0: none
+static DaliGearEmu gears;
+static DaliGear gear[GEAR_CNT];
+
+//misses the COMPARE frame (no reply) with probability loss
+class LossyGear : public DaliFrameHandler {
+public:
+  double loss;
+  uint32_t rng;
+  uint32_t missed;
+  uint8_t frame(const uint8_t *data, uint8_t bitlen, uint8_t *reply_or, uint8_t *reply_and) {
+    uint8_t n = gears.frame(data, bitlen, reply_or, reply_and);
+    if(bitlen == 16 && data[0] == (DALI_COMPARE & 0xFF) && n) {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      if(rng / 4294967296.0 < loss) {
+        missed++;
+        return 0;
+      }
+    }
+    return n;
+  }
+};
+static LossyGear lossy;
+
+static double ms(uint32_t ticks) {
+  return Dali::ticks_to_us(ticks) / 1000.0;
+}
+
+static void step() {
+  if(glitch && ctl.tick() - ctl.tx_end_tick() == DALI_MS_TO_TICKS(5)) {
+    dali_sim_pull[noise_node] = 1;
+    dali_sim_run(glitch);
+    dali_sim_pull[noise_node] = 0;
+    return;
+  }
+  dali_sim_step();
+}
+
+//mean bus time of compare() with the search address at adr, returns the number of YES
+static uint32_t time_compare(uint32_t adr, double *t) {
+  ctl.set_searchaddr(adr);
+  uint32_t yes = 0;
+  uint32_t t0 = dali_sim_steps;
+  for(uint16_t i = 0; i < N; i++) yes += ctl.compare();
+  *t = ms(dali_sim_steps - t0) / N;
+  return yes;
+}
+
+static int run(double loss, uint8_t retry) {
+  int bad = 0;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) gear[i].init(0xFF, 0x100000 * (i + 1) + 0x1234 * i);
+  gears.begin(&emu, gear, GEAR_CNT);
+  emu.emulate(&lossy);
+  lossy.loss = loss;
+  lossy.rng = 2463534242u;
+  lossy.missed = 0;
+  ctl.compare_retry = retry;
+  ctl.compare_cnt = ctl.compare_retries = ctl.compare_retry_yes = 0;
+
+  //one compare() answered YES (all gear in the search) and NO (search address below all random addresses)
+  ctl.cmd(DALI_INITIALISE, 0xFF);
+  double t_yes, t_no;
+  uint32_t yes = time_compare(0xFFFFFF, &t_yes);
+  uint32_t no = N - time_compare(0, &t_no);
+  double t_glitch;
+  glitch = 2;
+  uint32_t no_glitch = N - time_compare(0, &t_glitch);
+  glitch = 0;
+  ctl.cmd(DALI_TERMINATE, 0);
+
+  //commissioning
+  uint32_t t0 = dali_sim_steps;
+  uint8_t n = ctl.commission(0xFF);
+  double t_comm = ms(dali_sim_steps - t0) / 1000;
+  uint64_t used = 0;
+  uint8_t dup = 0;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    uint8_t a = gear[i].shortadr;
+    if(a >= 64 || ((used >> a) & 1)) dup = 1; else used |= (uint64_t)1 << a;
+  }
+  //the bus works after the early YES returns: every gear answers its own query
+  uint8_t wrong = 0;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(gear[i].shortadr < 64 && ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, gear[i].shortadr) != gear[i].level) wrong++;
+  }
+  printf("loss %4.1f%% retry %u | compare YES %5.2f ms (%3u/%u) NO %5.2f ms (%3u/%u) NO+glitch %3u/%u | commission %2u gear%s in %5.2f s, "
+    "%4u compares, %3u retries, %2u needed, %2u replies missed\n",
+    loss * 100, retry, t_yes, (unsigned)yes, N, t_no, (unsigned)no, N, (unsigned)no_glitch, N, n, dup ? " (WRONG addresses)" : "", t_comm,
+    (unsigned)ctl.compare_cnt, (unsigned)ctl.compare_retries, (unsigned)ctl.compare_retry_yes, (unsigned)lossy.missed);
+  //without loss every compare is right and the retry is never needed
+  if(loss == 0 && (yes != N || no != N || ctl.compare_retry_yes || n != GEAR_CNT || dup)) bad |= 1;
+  //with the retry, missed replies are caught
+  if(loss > 0 && retry && (n != GEAR_CNT || dup || !ctl.compare_retry_yes)) bad |= 2;
+  if(wrong) bad |= 4;
+  //a glitch is not a YES, and every gear gets exactly one short address
+  if(no_glitch != no) bad |= 16;
+  if(n != GEAR_CNT || dup) bad |= 32;
+  //NO: forward frame (38 Te, 15.83 ms) and the 10 ms reply window per COMPARE frame, without waiting any longer
+  if(loss == 0 && t_no > (retry + 1) * 26.1) bad |= 8;
+  gears.end();
+  return bad;
+}
+
+int main() {
+  dali_sim_attach(&ctl);
+  dali_sim_attach(&emu);
+  noise_node = dali_sim_attach(&noise);
+  ctl.wait_hook = step;
+  int bad = 0;
+  printf("%u emulated gear, %u samples per bit\n", GEAR_CNT, DALI_OVERSAMPLE);
+  bad |= run(0, 1);
+  bad |= run(0, 0);
+  bad |= run(0.02, 1);
+  bad |= run(0.02, 0);
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
@@ -0,0 +1,259 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+daylight_bench - constant illuminance control of 4 zones (8 gear in one
+group each) over 30 simulated minutes of changing daylight: frames per
+minute and how well the light is held, for
+  naive    query the sensor and send the DAPC for every zone, as fast as
+           the bus allows
+  query    DaliDaylight, sensors queried (deadband, adaptive period, bus
+           time budget)
+  event    DaliDaylight, the sensors send an event frame when their value
+           changes by 2% (or every 30 s), the bench passes it to input()
+
+Light model: sensor value (lux, 10 bits) = daylight of the zone + 800 * mean
+light output of its gear, +-0.5% noise; setpoint 500. Daylight ramps up,
+has two cloud steps and drops at the end. Per zone:
+  frames/min  frames of the zone: sensor queries or events, and DAPCs
+  dapc/min    DAPC frames
+  latency     sensor value to the end of its DAPC frame
+  in band     time the sensor value is within +-10% of the setpoint
+  worst out   longest time outside the band (settling after a step)
+Gear and sensors are frame level simulations (extras/sim/dali_sim_gear.h),
+time advances by the frame times and one tick per idle loop.
+
+Build:
+  g++ -O2 -I../.. -o daylight_bench daylight_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_daylight.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_daylight.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+
+#define ZONES 4
+#define GEAR_PER_ZONE 8
+#define SETPOINT 500
+#define K_LUX 800 //sensor value with all gear of a zone at full output
+#define RUN_S 1800
+#define SAMPLE_TICKS DALI_MS_TO_TICKS(100)
+
+enum {NAIVE, QUERY, EVENT};
+
+static double day(double t, uint8_t z) {
+  double d;
+  if(t < 300) d = 50 + t;                        //morning ramp
+  else if(t < 1300) d = 350;
+  else if(t < 1500) d = 350 + (t - 1300) * 0.35; //to 420
+  else d = 100;                                  //sudden drop
+  if(t >= 600 && t < 720) d -= 200;              //cloud
+  if(t >= 1000 && t < 1030) d -= 150;            //short cloud
+  return d * (1 - 0.15 * z);
+}
+
+//gear and light sensors (control devices 0..ZONES-1, instance 0, QUERY INPUT VALUE + LATCH)
+class SensorBus : public DaliSimGearBus {
+public:
+  uint32_t rng;
+  uint8_t latch[ZONES];
+  uint32_t sensor_frames;
+
+  double lux(uint8_t z) {
+    uint32_t sum = 0;
+    for(uint8_t i = 0; i < GEAR_PER_ZONE; i++) sum += DaliDaylight::light_of(gear[z * GEAR_PER_ZONE + i].level);
+    return day(now / (double)DALI_TICKS_PER_SECOND, z) + K_LUX * sum / (10000.0 * GEAR_PER_ZONE);
+  }
+
+  uint16_t sensor(uint8_t z) {
+    rng = rng * 1103515245u + 12345u;
+    double v = lux(z) * (1 + ((int32_t)((rng >> 16) % 1001) - 500) / 100000.0);
+    return (v < 0 ? 0 : (v > 1023 ? 1023 : (uint16_t)v));
+  }
+
+  int16_t transact(uint8_t *data, uint8_t bitlen, uint16_t timeout_ms) {
+    if(bitlen != 24) return DaliSimGearBus::transact(data, bitlen, timeout_ms);
+    frames++;
+    sensor_frames++;
+    now += settle + DALI_SIM_T_FORWARD(24);
+    uint8_t z = data[0] >> 1;
+    if((data[0] & 0x81) != 0x01 || z >= ZONES || data[1] != 0) {
+      now += DALI_SIM_T_NO_REPLY;
+      settle = 0;
+      return -DALI_RESULT_NO_REPLY;
+    }
+    int16_t rv;
+    if(data[2] == DALI_QUERY_INPUT_VALUE) {
+      uint16_t v = sensor(z) << 6; //10 bits, MSB aligned
+      latch[z] = v & 0xFF;
+      rv = v >> 8;
+    }else if(data[2] == DALI_QUERY_INPUT_VALUE_LATCH) {
+      rv = latch[z];
+    }else{
+      now += DALI_SIM_T_NO_REPLY;
+      settle = 0;
+      return -DALI_RESULT_NO_REPLY;
+    }
+    now += DALI_SIM_T_REPLY_GAP + DALI_SIM_T_BACKWARD;
+    settle = DALI_SETTLE_BWD_TICKS;
+    replies++;
+    return rv;
+  }
+};
+
+struct ZoneStat {
+  uint32_t frames, dapcs, lat_cnt;
+  double lat_sum, lat_max;
+  uint32_t in, samples, out_run, out_max; //in samples
+  uint16_t reported;                      //event mode: last value sent
+  uint32_t reported_tick;
+};
+
+static SensorBus bus[3];
+static Dali dali[3];
+static DaliDaylight dl[3];
+static ZoneStat st[3][ZONES];
+
+static double ms(double ticks) {
+  return ticks * 1000.0 / DALI_TICKS_PER_SECOND;
+}
+
+//naive: every zone, every loop: query, regulate without deadband, DAPC
+static uint16_t naive_out[ZONES];
+static uint8_t naive_step(uint8_t zone) {
+  SensorBus *b = &bus[NAIVE];
+  uint8_t d[3] = {(uint8_t)((zone << 1) | 1), 0, DALI_QUERY_INPUT_VALUE};
+  int16_t hi = b->transact(d, 24, 500);
+  d[2] = DALI_QUERY_INPUT_VALUE_LATCH;
+  int16_t lo = b->transact(d, 24, 500);
+  if(hi < 0 || lo < 0) return 2;
+  uint32_t t = b->now;
+  int32_t v = ((hi << 8) | lo) >> 6;
+  int32_t out = naive_out[zone] + (SETPOINT - v) * 500 * 10 / SETPOINT;
+  naive_out[zone] = (out < 10 ? 10 : (out > 10000 ? 10000 : out));
+  dali[NAIVE].set_level(DaliDaylight::level_of(naive_out[zone]), 64 + zone);
+  ZoneStat *s = &st[NAIVE][zone];
+  s->frames += 3;
+  s->dapcs++;
+  double lat = b->now - t;
+  s->lat_sum += lat;
+  s->lat_cnt++;
+  if(lat > s->lat_max) s->lat_max = lat;
+  return 3;
+}
+
+static void run(uint8_t mode) {
+  SensorBus *b = &bus[mode];
+  DaliDaylight *c = &dl[mode];
+  b->rng = 777;
+  for(uint8_t i = 0; i < ZONES * GEAR_PER_ZONE; i++) {
+    uint8_t g = b->add(i, 6);
+    b->gear[g].groups = 1 << (i / GEAR_PER_ZONE);
+    b->gear[g].level = 254;
+  }
+  dali[mode].begin(b);
+  c->begin(&dali[mode]);
+  for(uint8_t z = 0; z < ZONES; z++) {
+    naive_out[z] = 5000;
+    c->add_zone(64 + z, mode == EVENT ? DALI_DAYLIGHT_EVENT : z, 0, SETPOINT);
+  }
+
+  uint32_t end = RUN_S * (uint32_t)DALI_TICKS_PER_SECOND, next_sample = 0, ev_ticks = 0, rr = 0;
+  while(b->now < end) {
+    while((int32_t)(b->now - next_sample) >= 0) {
+      next_sample += SAMPLE_TICKS;
+      for(uint8_t z = 0; z < ZONES; z++) {
+        ZoneStat *s = &st[mode][z];
+        double l = b->lux(z);
+        s->samples++;
+        if(l >= SETPOINT * 0.9 && l <= SETPOINT * 1.1) {
+          s->in++;
+          s->out_run = 0;
+        }else if(++s->out_run > s->out_max) {
+          s->out_max = s->out_run;
+        }
+        if(mode != EVENT) continue;
+        //sensor event: 24 bit forward frame on the bus
+        uint16_t v = b->sensor(z);
+        uint16_t dv = (v > s->reported ? v - s->reported : s->reported - v);
+        if(dv * 50 > s->reported || b->now - s->reported_tick >= 30u * DALI_TICKS_PER_SECOND) {
+          uint32_t t0 = b->now;
+          b->now += b->settle + DALI_SIM_T_FORWARD(24);
+          b->settle = DALI_SETTLE_FWD_TICKS;
+          b->frames++;
+          b->sensor_frames++;
+          ev_ticks += b->now - t0;
+          s->frames++;
+          s->reported = v;
+          s->reported_tick = b->now;
+          c->input(z, v);
+        }
+      }
+    }
+    uint8_t n;
+    if(mode == NAIVE) {
+      n = naive_step(rr);
+      rr = (rr + 1) % ZONES;
+    }else{
+      n = c->update();
+      for(uint8_t z = 0; n && z < ZONES; z++) {
+        const DaliDaylightZone *p = c->zone(z);
+        if(p->dapcs == st[mode][z].dapcs) continue;
+        st[mode][z].dapcs = p->dapcs;
+        st[mode][z].lat_sum += p->latency;
+        st[mode][z].lat_cnt++;
+      }
+    }
+    if(!n) b->now++;
+  }
+
+  double min = RUN_S / 60.0;
+  uint32_t frames = 0;
+  printf("%s: bus frames %u (%.0f/min), controller bus time %.1f%%\n", mode == NAIVE ? "naive" : mode == QUERY ? "query" : "event",
+    (unsigned)b->frames, b->frames / min, mode == NAIVE ? 100.0 : 100.0 * (c->bus_ticks + ev_ticks) / b->now);
+  printf("  zone  frames/min  dapc/min  latency mean/max ms  in band  worst out s\n");
+  for(uint8_t z = 0; z < ZONES; z++) {
+    ZoneStat *s = &st[mode][z];
+    if(mode != NAIVE) {
+      const DaliDaylightZone *p = c->zone(z);
+      s->frames += p->queries + p->dapcs;
+      s->lat_max = p->latency_max;
+    }
+    frames += s->frames;
+    printf("  %4u  %10.1f  %8.1f  %8.1f / %6.1f    %5.1f%%  %11.1f\n", z, s->frames / min, s->dapcs / min,
+      ms(s->lat_sum / (s->lat_cnt ? s->lat_cnt : 1)), ms(s->lat_max),
+      100.0 * s->in / s->samples, s->out_max * 0.1);
+  }
+}
+
+int main() {
+  for(uint8_t m = NAIVE; m <= EVENT; m++) run(m);
+  int bad = 0;
+  uint32_t fr[3] = {0, 0, 0};
+  for(uint8_t m = NAIVE; m <= EVENT; m++) {
+    for(uint8_t z = 0; z < ZONES; z++) {
+      fr[m] += st[m][z].frames;
+      //the light is held: within +-10% for 95% of the time, every step settles within 15 s
+      if(st[m][z].in * 100 < st[m][z].samples * 95 || st[m][z].out_max > 150) bad |= 1 << m;
+    }
+  }
+  printf("frames vs. naive: query %.1f%%, event %.1f%%\n", 100.0 * fr[QUERY] / fr[NAIVE], 100.0 * fr[EVENT] / fr[NAIVE]);
+  if(fr[QUERY] * 20 > fr[NAIVE] || fr[EVENT] * 20 > fr[NAIVE]) bad |= 8;
+  if(dl[QUERY].bus_ticks > bus[QUERY].now / 10 + DALI_MS_TO_TICKS(100)) bad |= 16; //budget
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
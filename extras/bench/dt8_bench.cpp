@@ -0,0 +1,152 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+dt8_bench - frames and bus time per DT8 colour change, DaliDT8 vs. naive:
+to every gear DTR0, DTR1 (, DTR2), ENABLE_DEVICE_TYPE_X, SET_TEMPORARY_xxx
+(for RGB and for WAF), ENABLE_DEVICE_TYPE_X, ACTIVATE: 6 frames for Tc, 7
+for RGB, 12 for RGBWAF. The naive sequences run on a second simulated bus
+with the same gear, the frame counts are measured there. Then colours
+loaded with activate=0 must not be skipped or activated by later calls.
+
+Build:
+  g++ -O2 -I../.. -o dt8_bench dt8_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_dt8.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_dt8.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+
+#define GEAR_CNT 16
+
+static Dali dali, naive;
+static DaliDT8 dt8;
+static DaliSimGearBus bus, naive_bus;
+
+static const uint8_t RGB[6] = {10, 20, 30, 0xFF, 0xFF, 0xFF};
+static const uint8_t RED[6] = {40, 20, 30, 0xFF, 0xFF, 0xFF};
+static const uint8_t ALL[6] = {1, 2, 3, 4, 5, 6};
+
+struct Case {
+  const char *name;
+  uint16_t adr;          //DaliDT8 address: short/group, or 0x100 | gear mask for set_tc_mask()
+  uint16_t mask;         //addressed gear
+  uint16_t tc;           //0: rgbwaf
+  const uint8_t *rgbwaf;
+};
+
+static const Case cases[] = {
+  {"tc single gear, cold",          3,          0x0008, 250, 0},
+  {"tc single gear, only lsb",      3,          0x0008, 251, 0},
+  {"tc single gear, unchanged",     3,          0x0008, 251, 0},
+  {"tc group of 16",                64 + 0,     0xFFFF, 300, 0},
+  {"tc mask = group of 8",          0x100,      0x00FF, 350, 0},
+  {"tc mask = group of 8 + 2",      0x100,      0x03FF, 400, 0},
+  {"rgb single gear",               5,          0x0020, 0,   RGB},
+  {"rgb single gear, only red",     5,          0x0020, 0,   RED},
+  {"rgbwaf group of 16",            64 + 0,     0xFFFF, 0,   ALL},
+  {"tc group of 16, from rgbwaf",   64 + 0,     0xFFFF, 300, 0},
+  {"rgb single gear, from tc",      3,          0x0008, 0,   RGB},
+  {"tc single gear, same as before rgb", 3,      0x0008, 300, 0},
+};
+
+//naive: the full sequence to every addressed gear
+static void naive_colour(const Case &k) {
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(!((k.mask >> i) & 1)) continue;
+    if(k.tc) {
+      naive.cmd(DALI_DATA_TRANSFER_REGISTER0, k.tc & 0xFF);
+      naive.cmd(DALI_DATA_TRANSFER_REGISTER1, k.tc >> 8);
+      naive.cmd(DALI_ENABLE_DEVICE_TYPE_X, 8);
+      naive.cmd(DALI_DT8_SET_TEMPORARY_COLOUR_TEMPERATURE, i);
+    }else{
+      for(uint8_t t = 0; t < 2; t++) {
+        const uint8_t *c = k.rgbwaf + 3 * t;
+        if(c[0] == 0xFF && c[1] == 0xFF && c[2] == 0xFF) continue;
+        naive.cmd(DALI_DATA_TRANSFER_REGISTER0, c[0]);
+        naive.cmd(DALI_DATA_TRANSFER_REGISTER1, c[1]);
+        naive.cmd(DALI_DATA_TRANSFER_REGISTER2, c[2]);
+        naive.cmd(DALI_ENABLE_DEVICE_TYPE_X, 8);
+        naive.cmd(t == 0 ? DALI_DT8_SET_TEMPORARY_RGB_DIMLEVEL : DALI_DT8_SET_TEMPORARY_WAF_DIMLEVEL, i);
+      }
+    }
+    naive.cmd(DALI_ENABLE_DEVICE_TYPE_X, 8);
+    naive.cmd(DALI_DT8_ACTIVATE, i);
+  }
+}
+
+static void run(const Case &k) {
+  uint32_t f0 = bus.frames;
+  uint32_t t0 = bus.now;
+  if(k.adr & 0x100) dt8.set_tc_mask(k.mask, k.tc);
+  else if(k.tc) dt8.set_tc(k.adr, k.tc);
+  else dt8.set_rgbwaf(k.adr, k.rgbwaf);
+  uint32_t f = bus.frames - f0;
+  double ms = Dali::ticks_to_us(bus.now - t0) / 1000.0;
+
+  uint32_t nf0 = naive_bus.frames;
+  uint32_t nt0 = naive_bus.now;
+  naive_colour(k);
+  uint32_t nf = naive_bus.frames - nf0;
+  double nms = Dali::ticks_to_us(naive_bus.now - nt0) / 1000.0;
+  printf("%-36s frames=%3u bus=%6.1fms | naive frames=%3u bus=%6.1fms\n", k.name, (unsigned)f, ms, (unsigned)nf, nms);
+}
+
+int main() {
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    uint8_t g = bus.add(i, 8);
+    bus.gear[g].groups = (i < 8 ? 0x0003 : 0x0001);
+    naive_bus.add(i, 8);
+  }
+  dali.begin(&bus);
+  naive.begin(&naive_bus);
+  dt8.begin(&dali);
+  dt8.scan();
+
+  int bad = 0;
+  for(uint8_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    run(cases[c]);
+    //the rgbwaf group update makes RGBWAF the active colour type
+    if(c == 8 && (bus.gear[5].rgbwaf[0] != 1 || bus.gear[5].rgbwaf[5] != 6 || bus.gear[12].colour_type != 0x80)) bad++;
+  }
+
+  //activate=0 only loads the temporary colour: the same colour with activate=1 still needs the ACTIVATE
+  uint32_t f0 = dt8.frames;
+  dt8.set_tc(4, 400, 0);
+  if(bus.gear[4].tc != 300) bad++;
+  uint8_t n = dt8.set_tc(4, 400);
+  printf("%-36s frames=%3u\n", "tc single gear, loaded before", (unsigned)n);
+  if(n == 0 || bus.gear[4].tc != 400 || dt8.set_tc(4, 400) != 0) bad++;
+
+  //a temporary colour outside the mask does not start with set_tc_mask()
+  dt8.set_tc(6, 450, 0);
+  n = dt8.set_tc_mask(0x000F, 350);
+  printf("%-36s frames=%3u\n", "tc mask, other gear loaded", (unsigned)n);
+  if(bus.gear[0].tc != 350 || bus.gear[3].tc != 350 || bus.gear[6].tc != 300) bad++;
+  dt8.activate(6);
+  if(bus.gear[6].tc != 450 || dt8.set_tc(6, 450) != 0) bad++;
+  dt8.set_tc(64 + 0, 300);
+  printf("%-36s frames=%3u\n", "activate=0 cases total", (unsigned)(dt8.frames - f0));
+
+  //check the simulated gear ended up with the requested colours, with Tc active
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(bus.gear[i].tc != 300 || bus.gear[i].colour_type != 0x20 || naive_bus.gear[i].colour_type != 0x20) bad++;
+    if(dt8.query_tc(i) != 300) bad++;
+  }
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+duplicate_bench - bus time to find and repair short addresses shared by
+several gear: scan_duplicate_addr() and repair_duplicate_addr() vs.
+deleting all short addresses and commissioning the whole bus again, on
+frame level simulated gear
+
+Build:
+  g++ -O2 -I../.. -o duplicate_bench duplicate_bench.cpp ../../qqqDALI.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+
+#define CASES 3
+
+static Dali dali;
+static DaliSimGearBus buses[CASES * 2], *bus; //a fresh bus per run
+static uint8_t nbus;
+
+static void wait_step() { bus->now++; } //time passes while the random addresses are generated
+
+//cnt gear with short addresses 0..cnt-1, then the duplicates: gear with the short addresses in dup[]
+static void populate(uint8_t cnt, const uint8_t *dup, uint8_t dup_cnt) {
+  bus = &buses[nbus++];
+  for(uint8_t i = 0; i < cnt; i++) bus->add(i);
+  for(uint8_t i = 0; i < dup_cnt; i++) bus->add(dup[i]);
+  dali.begin(bus);
+}
+
+//all gear have different short addresses
+static uint8_t unique() {
+  uint64_t bits = 0;
+  for(uint8_t i = 0; i < bus->gear_cnt; i++) {
+    uint8_t sa = bus->gear[i].shortadr;
+    if(sa >= 64 || ((bits >> sa) & 1)) return 0;
+    bits |= (uint64_t)1 << sa;
+  }
+  return 1;
+}
+
+struct Case {
+  const char *name;
+  uint8_t cnt;
+  uint8_t dup_cnt;
+  uint8_t dup[4];
+};
+
+static const Case cases[CASES] = {
+  {"16 gear, 1 duplicate",           15, 1, {3}},
+  {"48 gear, 1 duplicate",           47, 1, {20}},
+  {"60 gear, 2 short addresses x2/x3", 57, 3, {5, 30, 30}},
+};
+
+int main() {
+  dali.wait_hook = wait_step;
+  int bad = 0;
+  for(uint8_t c = 0; c < CASES; c++) {
+    const Case &k = cases[c];
+    printf("%s:\n", k.name);
+
+    //scan and targeted repair
+    populate(k.cnt, k.dup, k.dup_cnt);
+    uint32_t f0 = bus->frames, t0 = bus->now;
+    uint64_t used;
+    uint64_t dup = dali.scan_duplicate_addr(&used);
+    uint32_t f1 = bus->frames, t1 = bus->now;
+    uint64_t expect = 0;
+    for(uint8_t i = 0; i < k.dup_cnt; i++) expect |= (uint64_t)1 << k.dup[i];
+    uint8_t n = 0;
+    for(uint8_t sa = 0; sa < 64; sa++) {
+      if((dup >> sa) & 1) n += dali.repair_duplicate_addr(sa, &used);
+    }
+    printf("  %-30s duplicates found=%s frames=%5u bus=%6.2fs\n", "scan_duplicate_addr()", dup == expect ? "all" : "WRONG",
+      (unsigned)(f1 - f0), (t1 - t0) / (double)DALI_TICKS_PER_SECOND);
+    printf("  %-30s readdressed=%2u    frames=%5u bus=%6.2fs\n", "repair_duplicate_addr()", n,
+      (unsigned)(bus->frames - f1), (bus->now - t1) / (double)DALI_TICKS_PER_SECOND);
+    printf("  %-30s                   frames=%5u bus=%6.2fs\n", "total", (unsigned)(bus->frames - f0), (bus->now - t0) / (double)DALI_TICKS_PER_SECOND);
+    if(dup != expect || n != k.dup_cnt || !unique()) bad |= 1;
+
+    //delete all short addresses, commission the whole bus
+    populate(k.cnt, k.dup, k.dup_cnt);
+    f0 = bus->frames;
+    t0 = bus->now;
+    dali.cmd(DALI_DATA_TRANSFER_REGISTER0, 0xFF);
+    dali.cmd(DALI_SET_SHORT_ADDRESS, 0xFF);
+    n = dali.commission(0xFF);
+    printf("  %-30s assigned=%2u       frames=%5u bus=%6.2fs\n", "delete + commission()", n, (unsigned)(bus->frames - f0), (bus->now - t0) / (double)DALI_TICKS_PER_SECOND);
+    if(n != bus->gear_cnt || !unique()) bad |= 2;
+  }
+
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
@@ -0,0 +1,134 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+gear_emu_bench - gear emulation on the sample level simulated bus: a
+controller Dali commissions and uses 6 virtual gear of a DaliGearEmu on a
+second Dali, and the reply latency is measured on the bus line: from the
+end of each forward frame (start + 17 bits) to the first low sample of the
+backward frame, for several reply delays
+
+Build:
+  g++ -O2 -I../.. -o gear_emu_bench gear_emu_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_gear.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_gear.h"
+#include "../sim/dali_sim_bus.h"
+
+#include <stdio.h>
+
+#define GEAR_CNT 6
+
+static Dali ctl, emu;
+static DaliGearEmu gears;
+static DaliGear gear[GEAR_CNT];
+
+//bus line observation
+static uint8_t ctl_prev, emu_prev;
+static uint32_t ctl_high, emu_high; //steps the controller / emulator released the line
+static uint32_t fwd_end;      //end of the last forward frame
+static uint32_t lat_min, lat_max, lat_cnt;
+
+static void step() {
+  dali_sim_step();
+  uint32_t t = dali_sim_steps;
+  uint8_t c = dali_sim_pull[0], e = dali_sim_pull[1];
+  if(c && !ctl_prev && ctl_high > 2 * DALI_OVERSAMPLE) {
+    fwd_end = t + 17 * DALI_OVERSAMPLE; //start bit + 16 bits
+  }
+  ctl_high = (c ? 0 : ctl_high + 1);
+  if(e && !emu_prev && emu_high > 2 * DALI_OVERSAMPLE) {
+    uint32_t lat = t - fwd_end;
+    if(!lat_cnt || lat < lat_min) lat_min = lat;
+    if(!lat_cnt || lat > lat_max) lat_max = lat;
+    lat_cnt++;
+  }
+  emu_high = (e ? 0 : emu_high + 1);
+  ctl_prev = c;
+  emu_prev = e;
+}
+
+static void latency_reset() {
+  lat_cnt = 0;
+  lat_min = 0;
+  lat_max = 0;
+}
+
+static double ms(uint32_t ticks) {
+  return Dali::ticks_to_us(ticks) / 1000.0;
+}
+
+int main() {
+  dali_sim_attach(&ctl);
+  dali_sim_attach(&emu);
+  ctl.wait_hook = step;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) gear[i].init(0xFF, 0x100000 * (i + 1) + 0x1234 * i);
+  gears.begin(&emu, gear, GEAR_CNT);
+  int bad = 0;
+
+  //commissioning by the controller
+  uint32_t t0 = dali_sim_steps;
+  uint8_t n = ctl.commission(0xFF);
+  printf("commission: %u gear in %.1f s, %u frames\n", n, ms(dali_sim_steps - t0) / 1000, (unsigned)gears.frames);
+  uint64_t used = 0;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(gear[i].shortadr < 64) used |= (uint64_t)1 << gear[i].shortadr;
+  }
+  if(n != GEAR_CNT || used != ((uint64_t)1 << GEAR_CNT) - 1) bad |= 1;
+
+  //levels, configuration, groups, memory bank 0
+  for(uint8_t i = 0; i < GEAR_CNT; i++) ctl.set_level(10 + i, i);
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, i) != 10 + i) bad |= 2;
+  }
+  if(ctl.set_max_level(200, 3) != 0) bad |= 4;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(gear[i].max_level != (gear[i].shortadr == 3 ? 200 : 254)) bad |= 4;
+  }
+  ctl.cmd(DALI_ADD_TO_GROUP0 + 5, 2);
+  ctl.cmd(DALI_ADD_TO_GROUP0 + 5, 4);
+  ctl.set_level(99, 64 + 5);
+  if(ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, 2) != 99 || ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, 4) != 99 || ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, 3) != 13) bad |= 8;
+  uint8_t bank[32];
+  if(ctl.read_memory_bank(0, 1, bank, sizeof(bank)) != 27 || bank[22] != 0x08) bad |= 16;
+
+  //all gear answer: identical answers merge, different ones collide
+  if(ctl.cmd(DALI_QUERY_CONTROL_GEAR_PRESENT, 0xFF) != 0xFF) bad |= 32;
+  int16_t rv = ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, 0xFF);
+  if(rv != -DALI_RESULT_COLLISION && rv != -DALI_RESULT_INVALID_REPLY) bad |= 32;
+  printf("frames=%u replies=%u collisions=%u\n", (unsigned)gears.frames, (unsigned)gears.replies, (unsigned)gears.collisions);
+
+  //reply latency on the bus line
+  printf("latency measured on the bus, %u ticks per second:\n", (unsigned)DALI_TICKS_PER_SECOND);
+  static const uint16_t delays[] = {6000, DALI_EMU_REPLY_DELAY_US, 10000};
+  for(uint8_t k = 0; k < sizeof(delays) / sizeof(delays[0]); k++) {
+    gears.end();
+    emu.emulate(&gears, delays[k]);
+    latency_reset();
+    uint32_t ok = 0;
+    for(uint16_t i = 0; i < 200; i++) {
+      if(ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, i % GEAR_CNT) >= 0) ok++;
+    }
+    uint32_t expect = (delays[k] * (uint32_t)DALI_TICKS_PER_SECOND + 500000) / 1000000; //nearest tick
+    printf("  reply_delay_us=%5u: %u replies, latency min=%.3f ms max=%.3f ms (emu_latency_ticks=%u, expected %u)\n",
+      delays[k], (unsigned)lat_cnt, ms(lat_min), ms(lat_max), (unsigned)emu.emu_latency_ticks(), (unsigned)expect);
+    if(ok != 200 || lat_cnt != 200 || lat_min != expect || lat_max != expect || emu.emu_latency_ticks() != expect) bad |= 64;
+  }
+
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
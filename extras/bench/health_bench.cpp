@@ -0,0 +1,110 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+health_bench - bus time of DaliHealth sweeps vs. querying every short
+address, on 64 simulated gear in 8 groups of 8
+
+Build:
+  g++ -O2 -I../.. -o health_bench health_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_health.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_health.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+
+//counts DT6 QUERY FAILURE STATUS sent to a broadcast or group address: every LED gear answers it, on a real bus
+//the replies collide
+class HealthBus : public DaliSimGearBus {
+public:
+  uint8_t dt6;
+  uint32_t dt6_multi;
+  HealthBus() : dt6(0), dt6_multi(0) {}
+  int16_t transact(uint8_t *data, uint8_t bitlen, uint16_t timeout_ms) {
+    if(bitlen == 16 && dt6 && (data[0] & 0x81) == 0x81 && data[1] == 241) dt6_multi++;
+    dt6 = (bitlen == 16 && data[0] == 0xC1 && data[1] == 6);
+    return DaliSimGearBus::transact(data, bitlen, timeout_ms);
+  }
+};
+
+static Dali dali;
+static DaliHealth health;
+static HealthBus bus;
+static uint32_t events;
+
+static void on_event(uint8_t adr, uint8_t check, uint8_t status) {
+  events++;
+  printf("  t=%7.2fs event adr=%2d check=%d status=0x%02X\n", bus.bus_seconds(), adr, check, status);
+}
+
+//run the monitor for a number of seconds of bus time, idle ticks pass when it does not send
+static void run(double seconds, uint32_t *q, uint32_t *busy) {
+  uint32_t q0 = health.queries;
+  uint32_t b0 = health.bus_ticks;
+  uint32_t end = bus.now + (uint32_t)(seconds * DALI_TICKS_PER_SECOND);
+  while((int32_t)(bus.now - end) < 0) {
+    if(!health.update()) bus.now++;
+  }
+  *q = health.queries - q0;
+  *busy = health.bus_ticks - b0;
+}
+
+static void report(const char *name, double seconds) {
+  uint32_t q, busy;
+  run(seconds, &q, &busy);
+  printf("%-28s %6.0fs queries=%5u bus=%6.2fs (%.2f%%)\n", name, seconds, (unsigned)q,
+    busy / (double)DALI_TICKS_PER_SECOND, 100.0 * busy / (seconds * DALI_TICKS_PER_SECOND));
+}
+
+int main() {
+  for(uint8_t i = 0; i < 64; i++) {
+    uint8_t g = bus.add(i, 6);
+    bus.gear[g].groups = 1 << (i / 8);
+  }
+  dali.begin(&bus);
+
+  //baseline: one QUERY_STATUS per short address
+  uint32_t t0 = bus.now;
+  for(uint8_t i = 0; i < 64; i++) dali.cmd(DALI_QUERY_STATUS, i);
+  printf("%-28s queries=%5u bus=%6.2fs\n", "QUERY_STATUS sweep", 64, (bus.now - t0) / (double)DALI_TICKS_PER_SECOND);
+
+  health.begin(&dali);
+  health.checks |= 1 << DALI_HEALTH_DT6;
+  health.event_hook = on_event;
+  uint64_t present = 0;
+  for(uint8_t i = 0; i < 64; i++) present |= (uint64_t)1 << i;
+  health.set_present(present);
+  for(uint8_t g = 0; g < 8; g++) health.set_group(g, (uint64_t)0xFF << (8 * g));
+
+  report("all ok", 600);
+  bus.gear[42].lamp_failure = 1;
+  printf("lamp failure on 42 at t=%.2fs\n", bus.bus_seconds());
+  report("lamp failure 42", 600);
+  bus.gear[7].failure_status = 0x02;
+  bus.gear[7].lamp_failure = 1; //an open circuit is a lamp failure
+  bus.gear[42].lamp_failure = 0;
+  printf("open circuit on 7, lamp 42 repaired at t=%.2fs\n", bus.bus_seconds());
+  report("open circuit 7", 600);
+  bus.gear[7].failure_status = 0;
+  bus.gear[7].lamp_failure = 0;
+  report("all ok again", 600);
+
+  printf("DT6 queries to broadcast/group: %u\n", (unsigned)bus.dt6_multi);
+  int bad = (events != 6) || bus.dt6_multi || health.failed(DALI_HEALTH_LAMP) || health.failed(DALI_HEALTH_DT6);
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  return bad;
+}
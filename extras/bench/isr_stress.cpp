@@ -0,0 +1,143 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+isr_stress - timer()/main context handoff under concurrency
+
+A thread runs timer() of all nodes on the simulated bus as fast as it can
+(no real time pacing, it only yields the CPU after every sample when there
+are fewer than 2 cores), while the main thread sends cmd() queries back to
+back. A responder node, driven from the timer thread, answers queries to
+even short addresses with (frame byte 0 + frame byte 1) (cmd() returns
+YES for YES/NO queries, application extended commands 224-236 get no
+reply), and with -n also
+transmits 24 bit frames at random moments, so that tx() races with timer()
+starting to receive.
+
+Every reply is checked: a wrong reply byte without a collision or invalid
+reply result means the handoff lost or mixed up data.
+
+Build (add -fsanitize=thread to check for data races):
+  g++ -O2 -g -I../.. -o isr_stress isr_stress.cpp ../../qqqDALI.cpp -lpthread
+
+Usage:
+  isr_stress [seconds (default 10)] [-n]
+###########################################################################*/
+#include "qqqDALI.h"
+#include "../sim/dali_sim_bus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+
+static Dali master, responder;
+static volatile uint8_t stop;
+static uint8_t noise;
+static uint8_t single_core; //the threads share one core: yield, so the simulated time does not run away from cmd()
+
+static void yield() {
+  if(single_core) sched_yield();
+}
+
+//timer thread: the bus, and the main context of the responder
+static void *timer_thread(void *) {
+  uint32_t rng = 1;
+  uint32_t reply_at = 0;
+  uint8_t reply = 0, pending = 0;
+  uint32_t steps = 0;
+  while(!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+    dali_sim_step();
+    steps++;
+    yield();
+    uint8_t d[8];
+    uint8_t n = responder.rx(d);
+    if(n == 16 && d[1] >= 144 && (d[0] & 1) && !(d[0] & 0x80) && !((d[0] >> 1) & 1) && Dali::reply_format(d, 16) != DALI_REPLY_NONE) {
+      reply = d[0] + d[1];
+      reply_at = steps + DALI_MS_TO_TICKS(3) + 1;
+      pending = 1;
+    }
+    if(pending && (int32_t)(steps - reply_at) >= 0) {
+      responder.tx(&reply, 8);
+      pending = 0;
+    }
+    if(noise && !pending) {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      if(rng % 20000 == 0) {
+        uint8_t f[3] = {0xFF, 0xFF, (uint8_t)rng};
+        responder.tx(f, 24);
+      }
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  double seconds = 10;
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-n")) noise = 1; else seconds = atof(argv[i]);
+  }
+  single_core = (sysconf(_SC_NPROCESSORS_ONLN) < 2);
+  dali_sim_attach(&master);
+  dali_sim_attach(&responder);
+  master.txcollisionhandling = DALI_TX_COLLISSION_ON;
+  master.wait_hook = yield;
+  pthread_t th;
+  pthread_create(&th, NULL, timer_thread, NULL);
+
+  struct timespec t0, t;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint32_t cmds = 0, ok = 0, noreply = 0, coll = 0, inval = 0, timeout = 0, wrong = 0, other = 0;
+  uint8_t adr = 0, opc = 144;
+  do {
+    adr = (adr + 1) & 0x3F;
+    opc = (opc == 255 ? 144 : opc + 1);
+    int16_t rv = master.cmd(opc, adr);
+    cmds++;
+    uint8_t expect = (uint8_t)((adr << 1 | 1) + opc);
+    uint8_t f[2] = {(uint8_t)(adr << 1 | 1), opc};
+    uint8_t format = Dali::reply_format(f, 16);
+    if(format == DALI_REPLY_YES) expect = 0xFF; //YES/NO query: any reply is YES
+    uint8_t answered = !(adr & 1) && format != DALI_REPLY_NONE;
+    if(rv >= 0) {
+      if(answered && rv == expect) ok++; else wrong++;
+    }else if(rv == -DALI_RESULT_NO_REPLY) {
+      if(!answered) ok++; else noreply++;
+    }else if(rv == -DALI_RESULT_COLLISION) {
+      coll++;
+    }else if(rv == -DALI_RESULT_INVALID_REPLY) {
+      inval++;
+    }else if(rv == -DALI_RESULT_TIMEOUT) {
+      timeout++;
+    }else{
+      other++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t);
+  } while(t.tv_sec - t0.tv_sec + (t.tv_nsec - t0.tv_nsec) / 1e9 < seconds);
+  __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+  pthread_join(th, NULL);
+
+  printf("%u cmd() in %.0f s, %u bus samples (%.1fx real time)%s\n", (unsigned)cmds, seconds, (unsigned)dali_sim_steps,
+    dali_sim_steps / (seconds * DALI_TICKS_PER_SECOND), noise ? ", with random frames from the responder" : "");
+  printf("ok %u, missed reply %u, collision %u, invalid reply %u, timeout %u, other %u, wrong reply %u\n",
+    (unsigned)ok, (unsigned)noreply, (unsigned)coll, (unsigned)inval, (unsigned)timeout, (unsigned)other, (unsigned)wrong);
+  int bad = (wrong != 0) || (!noise && ok != cmds);
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  return bad;
+}
@@ -0,0 +1,169 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+meter_bench - bus time of a DaliMeter cycle vs. reading the memory banks
+gear by gear, on 64 simulated gear (48 with energy reporting and
+diagnostics banks, 16 without), and a check of the published values, also
+while other code loads DTRs between the reads
+
+Build:
+  g++ -O2 -I../.. -o meter_bench meter_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_meter.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_meter.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#define METERED 48 //gear 0..47 have banks 202 and 205
+
+static Dali dali;
+static DaliMeter meter;
+static DaliSimGearBus bus;
+static uint32_t published, wrong;
+static uint32_t generation; //changes the simulated counters
+
+static uint64_t energy(uint8_t i) { return 1000000ull * i + 12345 + 7 * generation; }
+static uint32_t power(uint8_t i) { return 250 + i + generation; } //0.1 W
+
+static void set_counters() {
+  for(uint8_t i = 0; i < METERED; i++) {
+    bus.gear[i].set_memory(202, 0x05, 6, energy(i));
+    bus.gear[i].set_memory(202, 0x0C, 4, power(i));
+  }
+}
+
+static double expect(uint8_t adr, uint8_t quantity) {
+  switch(quantity) {
+    case DALI_METER_ACTIVE_ENERGY: return energy(adr);
+    case DALI_METER_ACTIVE_POWER: return power(adr) / 10.0;
+    case DALI_METER_OPERATING_TIME: return 3600 * adr;
+    case DALI_METER_SUPPLY_VOLTAGE: return 230.0;
+    case DALI_METER_POWER_FACTOR: return 0.95;
+    case DALI_METER_TEMPERATURE: return 40;
+  }
+  return NAN;
+}
+
+static void on_value(uint8_t adr, uint8_t quantity, float value, uint32_t) {
+  published++;
+  double e = expect(adr, quantity);
+  if(fabs(value - e) > fabs(e) * 1e-6 + 1e-3) {
+    wrong++;
+    printf("  wrong value adr=%u quantity=%u: %f, expected %f\n", adr, quantity, value, e);
+  }
+}
+
+static void report(const char *name, uint32_t frames, uint32_t ticks) {
+  printf("%-40s frames=%5u bus=%6.2fs\n", name, (unsigned)frames, ticks / (double)DALI_TICKS_PER_SECOND);
+}
+
+//run one metering cycle at full speed, every frames_between poller frames other code reads memory bank 0
+//of gear 60 (loads DTR1 and DTR0)
+static void cycle(uint32_t frames_between) {
+  uint8_t buf[2];
+  uint32_t c = meter.cycles;
+  uint32_t n = 0;
+  while(meter.cycles == c) {
+    n += meter.update();
+    if(frames_between && n >= frames_between) {
+      n = 0;
+      dali.read_memory(60, 0, 3, buf, 2);
+    }
+  }
+}
+
+int main() {
+  for(uint8_t i = 0; i < 64; i++) {
+    uint8_t g = bus.add(i, 6);
+    if(i >= METERED) continue;
+    DaliSimGear *p = &bus.gear[g];
+    p->init_metering();
+    p->set_memory(202, 0x04, 1, 0);    //energy in Wh
+    p->set_memory(202, 0x0B, 1, 0xFF); //power in 0.1 W
+    p->set_memory(205, 0x04, 4, 3600 * i);
+    p->set_memory(205, 0x0B, 2, 2300);
+    p->set_memory(205, 0x0E, 1, 95);
+    p->set_memory(205, 0x1B, 1, 100);
+  }
+  set_counters();
+  dali.begin(&bus);
+  int bad = 0;
+
+  //baselines: gear by gear
+  uint8_t buf[64];
+  uint32_t f0 = bus.frames, t0 = bus.now;
+  for(uint8_t i = 0; i < 64; i++) dali.read_memory_bank(202, i, buf, sizeof(buf));
+  report("read_memory_bank(202) per gear", bus.frames - f0, bus.now - t0);
+  f0 = bus.frames;
+  t0 = bus.now;
+  for(uint8_t i = 0; i < 64; i++) {
+    if(dali.read_memory(i, 202, 0x05, buf, 6) == 6 && buf[5] != (uint8_t)energy(i)) bad |= 32;
+    dali.read_memory(i, 202, 0x0C, buf, 4);
+  }
+  report("read_memory(energy, power) per gear", bus.frames - f0, bus.now - t0);
+
+  //metering cycles at full speed
+  meter.begin(&dali);
+  meter.budget_permille = 1000;
+  meter.interval_ms = 0;
+  meter.value_hook = on_value;
+  cycle(0);
+  report("DaliMeter energy+power, first cycle", meter.cycle_frames, meter.cycle_bus_ticks);
+  cycle(0);
+  report("DaliMeter energy+power", meter.cycle_frames, meter.cycle_bus_ticks);
+  if(published != 2 * 2 * METERED) bad |= 1;
+  for(uint8_t i = 0; i < 64; i++) {
+    const DaliMeterGear *p = meter.gear(i);
+    if(p->available != (i < METERED ? 0x03 : 0)) bad |= 2;
+  }
+
+  //counters change, other code loads DTR0 every 7 poller frames
+  generation++;
+  set_counters();
+  uint32_t p0 = published;
+  cycle(7);
+  report("DaliMeter energy+power, DTR interference", meter.cycle_frames, meter.cycle_bus_ticks);
+  if(published - p0 != 2 * METERED || meter.value(5, DALI_METER_ACTIVE_POWER) != (float)(power(5) / 10.0)) bad |= 4;
+
+  //diagnostics too
+  meter.quantities = 0xFF;
+  cycle(0);
+  report("DaliMeter all quantities, first cycle", meter.cycle_frames, meter.cycle_bus_ticks);
+  p0 = published;
+  cycle(0);
+  report("DaliMeter all quantities", meter.cycle_frames, meter.cycle_bus_ticks);
+  if(published - p0 != 6 * METERED || isnan(meter.value(3, DALI_METER_TEMPERATURE)) || !isnan(meter.value(3, DALI_METER_APPARENT_POWER))) bad |= 8;
+
+  //background: energy+power every 60 s, 5% of the bus time
+  meter.quantities = (1 << DALI_METER_ACTIVE_ENERGY) | (1 << DALI_METER_ACTIVE_POWER);
+  meter.budget_permille = 50;
+  meter.interval_ms = 60000;
+  uint32_t c0 = meter.cycles, b0 = meter.bus_ticks;
+  t0 = bus.now;
+  while(bus.now - t0 < 1800u * DALI_TICKS_PER_SECOND) {
+    if(!meter.update()) bus.now++;
+  }
+  printf("background 1800s: %u cycles, bus=%.2fs (%.2f%%)\n", (unsigned)(meter.cycles - c0),
+    (meter.bus_ticks - b0) / (double)DALI_TICKS_PER_SECOND, 100.0 * (meter.bus_ticks - b0) / (bus.now - t0));
+
+  if(wrong) bad |= 16;
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
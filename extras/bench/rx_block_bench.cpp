@@ -0,0 +1,215 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+rx_block_bench - receiving from captured sample blocks: timer() per sample
+with a bus_is_high() callback reading the capture buffer, vs. rx_samples()
+on the packed buffer
+
+Two captures of 60 s (8 samples per byte, 1 = bus low), synthesized with
+extras/sim/dali_sim_wave.h:
+  typical  a query and its reply every 500 ms, one frame with glitches,
+           a bus power failure of 700 ms
+  busy     query/reply pairs back to back (a scan), with bus settling
+           times of 2.4 ms after replies and 9.17 ms after commands
+Both receivers read the frames with rx(): timer() every 8 samples, the
+block receiver whenever rx_samples() returns early. The times include
+decoding the frames in rx(), which is most of the time on the busy bus. The frames (bits,
+data, start and end tick), the clock (tick()) and the bus events must be the
+same, also with blocks cut at random sample positions.
+
+Build:
+  g++ -O2 -I../.. -o rx_block_bench rx_block_bench.cpp ../../qqqDALI.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "../sim/dali_sim_wave.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define SECONDS 60
+#define NSAMPLES ((uint32_t)SECONDS * DALI_TICKS_PER_SECOND)
+#define TS_US (1e6 / DALI_TICKS_PER_SECOND)
+#define BLOCK 256 //bytes per DMA block
+#define FRAMES_MAX 20000
+#define ROUNDS 5
+
+static Dali dali;
+static uint8_t cap[NSAMPLES / 8];
+static uint32_t pos;
+static uint8_t bus_is_high() {
+  uint8_t h = !((cap[pos >> 3] >> (7 - (pos & 7))) & 1);
+  pos++;
+  return h;
+}
+static void bus_set_low() {}
+static void bus_set_high() {}
+
+static double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct Frame {
+  uint8_t bits, d0, d1;
+  uint32_t start, end;
+};
+
+struct Result {
+  Frame f[FRAMES_MAX];
+  uint32_t n, tick0, tick, events;
+};
+static Result ref, blk;
+
+//capture synthesis
+static uint32_t rng = 1;
+static uint32_t rnd() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+//draw the frame into the capture from t0 (us), returns its end (us)
+static double draw(double t0, const uint8_t *d, uint8_t bitlen, double glitches) {
+  DaliWave w;
+  w.rng = rnd() | 1;
+  w.jitter_us = 20;
+  w.glitch_per_frame = glitches;
+  w.glitch_us = 150;
+  w.frame(d, bitlen);
+  uint32_t i = (uint32_t)(t0 / TS_US) + 1;
+  uint32_t e = (uint32_t)((t0 + w.t_end) / TS_US);
+  for(; i <= e && i < NSAMPLES; i++) {
+    if(!w.level_high(i * TS_US - t0)) cap[i >> 3] |= 0x80 >> (i & 7);
+  }
+  return t0 + w.t_end;
+}
+
+static void low(double t0, double t1) {
+  for(uint32_t i = (uint32_t)(t0 / TS_US); i < (uint32_t)(t1 / TS_US) && i < NSAMPLES; i++) cap[i >> 3] |= 0x80 >> (i & 7);
+}
+
+static void synth(uint8_t busy) {
+  memset(cap, 0, sizeof(cap));
+  rng = 12345 + busy;
+  double t = 1000;
+  uint32_t k = 0;
+  while(t < SECONDS * 1e6 - 100000) {
+    uint8_t q[2] = {(uint8_t)(2 * (k % 64) + 1), 160}, r[1] = {(uint8_t)rnd()};
+    t = draw(t, q, 16, (!busy && k == 7) ? 2 : 0);
+    t = draw(t + 8000, r, 8, 0);
+    t += (busy ? DALI_SETTLE_BWD_US + 2 * 833 : 500000);
+    if(!busy && k == 20) {
+      low(t, t + 700000);
+      t += 800000;
+    }
+    k++;
+  }
+}
+
+static void record(Result *r, uint8_t bits, const uint8_t *d) {
+  if(bits < 2 || r->n >= FRAMES_MAX) return;
+  Frame &f = r->f[r->n++];
+  f.bits = bits;
+  f.d0 = d[0];
+  f.d1 = d[1];
+  f.start = dali.rx_start_tick() - r->tick0;
+  f.end = dali.rx_end_tick() - r->tick0;
+}
+
+static void finish(Result *r) {
+  r->tick = dali.tick() - r->tick0;
+  r->events = dali.bus_events();
+}
+
+static double run_timer(Result *r) {
+  dali.begin(bus_is_high, bus_set_low, bus_set_high);
+  dali.bus_events();
+  r->n = 0;
+  r->tick0 = dali.tick();
+  pos = 0;
+  uint8_t d[4];
+  double t0 = now_s();
+  for(uint32_t i = 0; i < NSAMPLES; i += 8) {
+    for(uint8_t j = 0; j < 8; j++) dali.timer();
+    record(r, dali.rx(d), d);
+  }
+  double dt = now_s() - t0;
+  finish(r);
+  return dt;
+}
+
+//blocks of BLOCK bytes, or cut at random sample positions
+static double run_block(Result *r, uint8_t random_cut) {
+  dali.begin(bus_is_high, bus_set_low, bus_set_high);
+  dali.bus_events();
+  r->n = 0;
+  r->tick0 = dali.tick();
+  uint8_t d[4];
+  double t0 = now_s();
+  uint32_t i = 0;
+  while(i < NSAMPLES) {
+    uint32_t n = i + (random_cut ? 1 + rnd() % (2 * BLOCK * 8) : BLOCK * 8);
+    if(n > NSAMPLES) n = NSAMPLES;
+    while(i < n) {
+      i = dali.rx_samples(cap, i, n);
+      record(r, dali.rx(d), d);
+    }
+  }
+  double dt = now_s() - t0;
+  finish(r);
+  return dt;
+}
+
+static uint8_t same(const Result *a, const Result *b) {
+  if(a->n != b->n || a->tick != b->tick || a->events != b->events) return 0;
+  for(uint32_t i = 0; i < a->n; i++) {
+    const Frame &x = a->f[i], &y = b->f[i];
+    if(x.bits != y.bits || x.d0 != y.d0 || x.d1 != y.d1 || x.start != y.start || x.end != y.end) return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int bad = 0;
+  printf("%u s captures, %u samples per bit, %u samples per second, blocks of %u bytes\n", SECONDS, DALI_OVERSAMPLE,
+    (unsigned)DALI_TICKS_PER_SECOND, BLOCK);
+  for(uint8_t busy = 0; busy < 2; busy++) {
+    synth(busy);
+    double tt = 1e9, tb = 1e9;
+    for(uint8_t k = 0; k < ROUNDS; k++) {
+      double a = run_timer(&ref), b = run_block(&blk, 0);
+      if(a < tt) tt = a;
+      if(b < tb) tb = b;
+    }
+    uint8_t ok = same(&ref, &blk);
+    run_block(&blk, 1);
+    ok &= same(&ref, &blk);
+    uint32_t f8 = 0;
+    for(uint32_t i = 0; i < ref.n; i++) f8 += (ref.f[i].bits == 8);
+    printf("%-7s frames %5u (%5u replies), events 0x%X: timer() %6.1f Msamples/s, rx_samples() %7.1f Msamples/s (x%.0f)%s\n",
+      busy ? "busy" : "typical", (unsigned)ref.n, (unsigned)f8, (unsigned)ref.events, NSAMPLES / tt / 1e6, NSAMPLES / tb / 1e6,
+      tt / tb, ok ? "" : ", DIFFERENT");
+    if(!ok) bad |= 1 << busy;
+    if(ref.events != (busy ? 0 : DALI_BUS_EVENT_DOWN | DALI_BUS_EVENT_UP)) bad |= 4;
+  }
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
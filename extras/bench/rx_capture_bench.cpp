@@ -0,0 +1,153 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+rx_capture_bench - receive buffer: RAM per frame and host CPU time of
+timer() and rx(), raw samples (1 bit per sample, up to 2026-10-19) vs. run
+lengths of the bus levels (4 bits per level change)
+
+Each frame is synthesized once (extras/sim/dali_sim_wave.h) and replayed
+sample by sample into timer(). Per frame it reports the samples and the
+level runs until the stop bits, the bytes each representation needs for
+them, whether rx() returned the frame, and the CPU time per timer() call
+and per rx() call. The disturbance is 60 ms of long low pulses with short
+high gaps (no stop bits in between): more samples than any buffer holds.
+
+Build:
+  g++ -O2 -I../.. -o rx_capture_bench rx_capture_bench.cpp ../../qqqDALI.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "../sim/dali_sim_wave.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define SAMPLES_MAX 4000
+#define IDLE (4 * DALI_OVERSAMPLE) //high samples after the frame
+#define REPS 5000
+#define ROUNDS 7
+
+static Dali dali;
+static uint8_t samples[SAMPLES_MAX];
+static uint16_t nsamples, pos;
+static uint8_t bus_is_high() { return pos < nsamples ? samples[pos] : 1; }
+static void bus_set_low() {}
+static void bus_set_high() {}
+
+static double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//sample a synthesized frame
+static void synth(const uint8_t *data, uint8_t bitlen, double skew) {
+  DaliWave w;
+  w.skew = skew;
+  w.frame(data, bitlen);
+  nsamples = 0;
+  for(double t = 0.5e6 / DALI_TICKS_PER_SECOND; t < w.t_end && nsamples < SAMPLES_MAX - IDLE; t += 1e6 / DALI_TICKS_PER_SECOND) {
+    samples[nsamples++] = w.level_high(t);
+  }
+  for(uint8_t i = 0; i < IDLE; i++) samples[nsamples++] = 1;
+}
+
+//runs of the bus levels up to the stop bits, and samples up to the stop bits
+static void count(uint16_t *ns, uint16_t *nr) {
+  uint16_t high = 0;
+  *nr = 0;
+  *ns = nsamples;
+  for(uint16_t i = 0; i < nsamples; i++) {
+    if(i && samples[i] != samples[i - 1]) (*nr)++;
+    high = (samples[i] ? high + 1 : 0);
+    if(high >= 2 * DALI_OVERSAMPLE) { //stop bits: where timer() ends the frame
+      *ns = i + 1;
+      break;
+    }
+  }
+}
+
+struct Frame {
+  const char *name;
+  uint8_t bitlen;
+  double skew;
+  uint8_t fixed; //the fixed step decoder (DALI_DECODER_FIXED) decodes it, it does not follow slow transmitters
+};
+
+int main() {
+  static const Frame frames[] = {
+    {"backward 8 bits", 8, 0, 1},
+    {"forward 16 bits", 16, 0, 1},
+    {"forward 24 bits", 24, 0, 1},
+    {"32 bits", 32, 0, 1},
+    {"32 bits, 20% slow", 32, 0.2, 0},
+    {"disturbance 60 ms", 0, 0, 1},
+  };
+  printf("%u samples per bit, receive buffer %u bytes", (unsigned)DALI_OVERSAMPLE, (unsigned)DALI_RX_BUF_SIZE);
+#ifdef DALI_RX_RUNS_MAX
+  printf(" (run lengths: %u runs)\n", (unsigned)DALI_RX_RUNS_MAX);
+#else
+  printf(" (raw samples: %u samples)\n", (unsigned)DALI_RX_BUF_SIZE * 8);
+#endif
+  printf("%-20s %8s %6s %10s %10s %6s %12s %10s\n", "frame", "samples", "runs", "raw bytes", "run bytes", "rx()", "timer() ns", "rx() ns");
+  int bad = 0;
+  for(uint8_t f = 0; f < sizeof(frames) / sizeof(frames[0]); f++) {
+    const Frame &k = frames[f];
+    uint8_t data[4] = {0xA5, 0x3C, 0x96, 0xAA};
+    if(k.bitlen) {
+      synth(data, k.bitlen, k.skew);
+    }else{
+      nsamples = 0;
+      uint16_t n = DALI_MS_TO_TICKS(60);
+      while(nsamples < n) {
+        for(uint8_t i = 0; i < 5 * DALI_OVERSAMPLE; i++) samples[nsamples++] = 0;
+        for(uint8_t i = 0; i < DALI_OVERSAMPLE; i++) samples[nsamples++] = 1;
+      }
+      for(uint8_t i = 0; i < IDLE; i++) samples[nsamples++] = 1;
+    }
+    uint16_t ns, nr;
+    count(&ns, &nr);
+
+    //best of ROUNDS rounds: the host is not idle
+    dali.begin(bus_is_high, bus_set_low, bus_set_high);
+    double best_timer = 1e9, best_rx = 1e9;
+    uint8_t rv = 0, rxd[8];
+    for(uint8_t round = 0; round < ROUNDS; round++) {
+      double t_timer = 0, t_rx = 0;
+      for(uint32_t r = 0; r < REPS; r++) {
+        double t0 = now_s();
+        for(pos = 0; pos < nsamples; pos++) dali.timer();
+        double t1 = now_s();
+        rv = dali.rx(rxd);
+        double t2 = now_s();
+        t_timer += t1 - t0;
+        t_rx += t2 - t1;
+      }
+      if(t_timer < best_timer) best_timer = t_timer;
+      if(t_rx < best_rx) best_rx = t_rx;
+    }
+    uint8_t ok = (k.bitlen ? rv == k.bitlen && rxd[0] == data[0] && rxd[(k.bitlen - 1) / 8] == data[(k.bitlen - 1) / 8] : rv == 2);
+    printf("%-20s %8u %6u %10u %10u %6s %12.1f %10.0f\n", k.name, ns, nr + 1, (ns + 7) / 8, (nr + 2) / 2,
+      ok ? (k.bitlen ? "ok" : "error") : "WRONG", best_timer / REPS / nsamples * 1e9, best_rx / REPS * 1e9);
+#ifdef DALI_DECODER_FIXED
+    if(!k.fixed) continue;
+#endif
+    if(!ok) bad |= 1 << f;
+  }
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
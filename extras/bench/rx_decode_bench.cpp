@@ -0,0 +1,170 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+rx_decode_bench - receive path characterization: error rates vs. baud skew,
+edge jitter, asymmetric rise/fall, glitches and sample noise
+
+Every frame is synthesized (extras/sim/dali_sim_wave.h) with random data
+and a random sample phase, sampled by timer() at DALI_TICKS_PER_SECOND and decoded
+by rx(). Per condition it reports:
+  ok      frame decoded with the correct data
+  coll    rx() returned 2: transact() reports a collision (false collision,
+          there is only one transmitter)
+  inval   wrong number of bits: transact() reports an invalid reply
+  wrong   correct number of bits but wrong data (undetected error)
+  lost    no frame completed
+  rx ns   host CPU time of rx() (decoder) per frame
+  isr ns  host CPU time of timer() per frame (includes sampling the synthesized waveform)
+
+IEC62386-101 receivers must accept half bits of 333..500 us (+-20%) and
+double half bits of 667..1000 us.
+
+Build:
+  g++ -O2 -I../.. -o rx_decode_bench rx_decode_bench.cpp ../../qqqDALI.cpp
+  add -DDALI_DECODER_TRACK for the clock recovering decoder (default: fixed
+  step decoder)
+
+Usage:
+  rx_decode_bench [frames per condition (default 100000)] [bits per frame (default 8)]
+###########################################################################*/
+#include "qqqDALI.h"
+#include "../sim/dali_sim_wave.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TS_US (1e6 / DALI_TICKS_PER_SECOND) //sample period
+
+static Dali dali;
+static DaliWave wave;
+static double t_sample;
+static uint8_t bus_is_high() { return wave.level_high(t_sample); }
+static void bus_set_low() {}
+static void bus_set_high() {}
+
+static double now_s() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+struct Condition {
+  const char *name;
+  double skew, jitter_us, asym_us, glitch_per_frame, glitch_us, flip_prob;
+};
+
+static const Condition conditions[] = {
+  {"nominal",                   0,     0,    0, 0,   0, 0},
+  {"skew -20%",             -0.20,     0,    0, 0,   0, 0},
+  {"skew -15%",             -0.15,     0,    0, 0,   0, 0},
+  {"skew -10%",             -0.10,     0,    0, 0,   0, 0},
+  {"skew -5%",              -0.05,     0,    0, 0,   0, 0},
+  {"skew +5%",               0.05,     0,    0, 0,   0, 0},
+  {"skew +10%",              0.10,     0,    0, 0,   0, 0},
+  {"skew +15%",              0.15,     0,    0, 0,   0, 0},
+  {"skew +20%",              0.20,     0,    0, 0,   0, 0},
+  {"jitter 25us",               0,    25,    0, 0,   0, 0},
+  {"jitter 50us",               0,    50,    0, 0,   0, 0},
+  {"jitter 80us",               0,    80,    0, 0,   0, 0},
+  {"jitter 120us",              0,   120,    0, 0,   0, 0},
+  {"asym +50us",                0,     0,   50, 0,   0, 0},
+  {"asym +100us",               0,     0,  100, 0,   0, 0},
+  {"asym +150us",               0,     0,  150, 0,   0, 0},
+  {"asym -50us",                0,     0,  -50, 0,   0, 0},
+  {"asym -100us",               0,     0, -100, 0,   0, 0},
+  {"asym -150us",               0,     0, -150, 0,   0, 0},
+  {"glitch 1x 20us",            0,     0,    0, 1,  20, 0},
+  {"glitch 1x 50us",            0,     0,    0, 1,  50, 0},
+  {"glitch 1x 100us",           0,     0,    0, 1, 100, 0},
+  {"glitch 1x 200us",           0,     0,    0, 1, 200, 0},
+  {"sample flips 1%",           0,     0,    0, 0,   0, 0.01},
+  {"sample flips 5%",           0,     0,    0, 0,   0, 0.05},
+  {"skew+10% jit50 asym+50",  0.10,   50,   50, 0,   0, 0},
+  {"skew-10% jit50 asym-50", -0.10,   50,  -50, 0,   0, 0},
+  {"skew+15% jit80 asym+100", 0.15,   80,  100, 0,   0, 0},
+};
+
+int main(int argc, char **argv) {
+  uint32_t n = (argc > 1 ? atoi(argv[1]) : 100000);
+  uint8_t bitlen = (argc > 2 ? atoi(argv[2]) : 8);
+  if(bitlen < 3 || bitlen > 32) return 1;
+  dali.begin(bus_is_high, bus_set_low, bus_set_high);
+
+  //cost of the clock reads around rx()
+  double c0 = now_s();
+  for(int i = 0; i < 100000; i++) now_s();
+  double clk = (now_s() - c0) / 100000;
+
+  printf("%u frames of %u bits per condition\n", (unsigned)n, bitlen);
+  printf("%-26s %8s %8s %8s %8s %8s %7s %7s\n", "condition", "ok%", "coll%", "inval%", "wrong%", "lost%", "rx ns", "isr ns");
+  uint64_t total = 0;
+  for(uint8_t c = 0; c < sizeof(conditions) / sizeof(conditions[0]); c++) {
+    const Condition &k = conditions[c];
+    wave.skew = k.skew;
+    wave.jitter_us = k.jitter_us;
+    wave.asym_us = k.asym_us;
+    wave.glitch_per_frame = k.glitch_per_frame;
+    wave.glitch_us = k.glitch_us;
+    wave.flip_prob = k.flip_prob;
+    wave.rng = 12345 + c;
+    uint32_t ok = 0, coll = 0, inval = 0, wrong = 0, lost = 0;
+    double t_rx = 0, t_isr = 0;
+    for(uint32_t f = 0; f < n; f++) {
+      uint8_t data[4], rxd[8];
+      for(uint8_t i = 0; i < 4; i++) data[i] = wave.rnd() * 256;
+      wave.frame(data, bitlen);
+      //start sampling a few samples before the frame, with random phase
+      t_sample = -4 * TS_US + wave.rnd() * TS_US;
+      uint16_t max = (uint16_t)((wave.t_end + 40 * TS_US) / TS_US);
+      double t0 = now_s();
+      for(uint16_t i = 0; i < max; i++) {
+        dali.timer();
+        t_sample += TS_US;
+      }
+      //bus idle between frames
+      for(uint8_t i = 0; i < 30; i++) {
+        dali.timer();
+        t_sample += TS_US;
+      }
+      double t1 = now_s();
+      t_isr += (t1 - t0) * max / (max + 30.0);
+      uint8_t rv = dali.rx(rxd);
+      t_rx += now_s() - t1 - clk;
+      if(rv < 2) {
+        lost++;
+      }else if(rv == 2) {
+        coll++;
+      }else if(rv != bitlen) {
+        inval++;
+      }else{
+        uint8_t same = 1;
+        for(uint8_t i = 0; i < bitlen; i++) {
+          if(((data[i >> 3] ^ rxd[i >> 3]) >> (7 - (i & 7))) & 1) same = 0;
+        }
+        if(same) ok++; else wrong++;
+      }
+    }
+    total += n;
+    printf("%-26s %8.3f %8.3f %8.3f %8.3f %8.3f %7.0f %7.0f\n", k.name,
+      100.0 * ok / n, 100.0 * coll / n, 100.0 * inval / n, 100.0 * wrong / n, 100.0 * lost / n,
+      t_rx / n * 1e9, t_isr / n * 1e9);
+    fflush(stdout);
+  }
+  printf("%llu frames total\n", (unsigned long long)total);
+  return 0;
+}
@@ -0,0 +1,226 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+sched_bench - latency of interactive set_level() commands (button presses)
+while memory bank 0 of all gear is read, on 60 frame level simulated gear
+
+Button presses come at random times (exponential, 400 ms mean) over the
+whole read, the latency is from the press to the end of its DAPC frame:
+  blocking          read_memory_bank() for all gear, then the presses
+  blocking per gear the application checks its buttons after every gear
+  scheduler         DaliScheduler: the read is a DaliMemoryTask (bulk
+                    class), the presses are queued with set_level()
+The scheduler run is repeated with 4 new gear commissioned meanwhile by a
+DaliCommissionTask, and with the bulk budget at 30%. The bank contents
+passed to data_hook and the levels of the gear are checked.
+
+Build:
+  g++ -O2 -I../.. -o sched_bench sched_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_sched.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_sched.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define GEAR_CNT 56 //with short address 0..55
+#define NEW_CNT 4   //without short address
+#define PRESS_MAX 1000
+
+static Dali dali;
+static DaliSimGearBus *bus;
+static DaliScheduler sched;
+static DaliMemoryTask mem;
+static DaliCommissionTask comm;
+
+//button presses
+static uint32_t press_tick[PRESS_MAX];
+static uint8_t press_adr[PRESS_MAX], press_level[PRESS_MAX];
+static uint16_t press_cnt, press_next, press_done;
+static uint32_t latency[PRESS_MAX];
+static int bad;
+
+static uint32_t rng = 12345;
+static double rnd() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return (rng & 0xFFFFFF) / 16777216.0;
+}
+
+//presses from t0 on, mean interval 400 ms, until t_end
+static void make_presses(uint32_t t0, uint32_t t_end) {
+  rng = 12345;
+  press_cnt = press_next = press_done = 0;
+  uint32_t t = t0;
+  while(press_cnt < PRESS_MAX) {
+    t += (uint32_t)(-log(1 - rnd()) * DALI_MS_TO_TICKS(400));
+    if((int32_t)(t - t_end) > 0) break;
+    press_tick[press_cnt] = t;
+    press_adr[press_cnt] = rnd() * GEAR_CNT;
+    press_level[press_cnt] = 1 + rnd() * 253;
+    press_cnt++;
+  }
+}
+
+static void press_done_hook(int16_t, uint32_t) {
+  latency[press_done] = bus->now - press_tick[press_done];
+  press_done++;
+}
+
+//blocking application: send the presses which came up to now
+static void handle_presses() {
+  while(press_next < press_cnt && (int32_t)(bus->now - press_tick[press_next]) >= 0) {
+    dali.set_level(press_level[press_next], press_adr[press_next]);
+    press_next++;
+    press_done_hook(0, 0);
+  }
+}
+
+//scheduler application: queue the presses which came up to now (as an interrupt would)
+static void queue_presses() {
+  while(press_next < press_cnt && (int32_t)(bus->now - press_tick[press_next]) >= 0) {
+    if(sched.set_level(press_level[press_next], press_adr[press_next], press_done_hook)) break; //queue full
+    press_next++;
+  }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double ms(uint32_t ticks) {
+  return Dali::ticks_to_us(ticks) / 1000.0;
+}
+
+static void report(const char *name, uint32_t t0) {
+  uint32_t s[PRESS_MAX];
+  for(uint16_t i = 0; i < press_done; i++) s[i] = latency[i];
+  qsort(s, press_done, sizeof(s[0]), cmp_u32);
+  printf("%-30s read %6.1f s, %3u presses: latency p50 %7.1f ms p99 %7.1f ms max %7.1f ms\n", name, ms(bus->now - t0) / 1000,
+    press_done, ms(s[press_done / 2]), ms(s[press_done * 99 / 100]), ms(s[press_done - 1]));
+  if(press_done != press_cnt) bad |= 1;
+  //every gear is at the level of its last press
+  for(uint8_t a = 0; a < GEAR_CNT; a++) {
+    int16_t last = -1;
+    for(uint16_t i = 0; i < press_cnt; i++) if(press_adr[i] == a) last = press_level[i];
+    if(last >= 0 && bus->gear[a].level != last) bad |= 2;
+  }
+}
+
+static uint16_t mem_gear, mem_wrong;
+static void on_data(uint8_t adr, uint8_t bank, const uint8_t *data, uint8_t len) {
+  mem_gear++;
+  const uint8_t *m = bus->gear[adr].memory_bank(bank);
+  if(!m || len != m[0] + 1) {
+    mem_wrong++;
+    return;
+  }
+  for(uint8_t i = 0; i < len; i++) if(data[i] != m[i]) mem_wrong++;
+}
+
+static void setup(DaliSimGearBus *b) {
+  bus = b;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) bus->add(i);
+  for(uint8_t i = 0; i < NEW_CNT; i++) bus->add(0xFF);
+  dali.begin(bus);
+  dali.dtr_invalidate();
+}
+
+static uint64_t all_mask() {
+  return ((uint64_t)1 << GEAR_CNT) - 1;
+}
+
+//run the scheduler until the memory read (and commissioning) are done and all presses are handled
+static void run_sched(DaliSimGearBus *b, const char *name, uint16_t bulk_budget, uint8_t commission, uint32_t read_ticks) {
+  setup(b);
+  sched.begin(&dali);
+  sched.budget_permille[DALI_SCHED_BULK] = bulk_budget;
+  uint8_t buf[32];
+  mem.begin(0, all_mask(), buf, sizeof(buf));
+  mem.data_hook = on_data;
+  mem_gear = mem_wrong = 0;
+  uint64_t used = all_mask();
+  uint32_t t0 = bus->now;
+  make_presses(t0, t0 + read_ticks);
+  sched.add(&mem, DALI_SCHED_BULK);
+  if(commission) {
+    comm.begin(&used);
+    sched.add(&comm, DALI_SCHED_COMMISSION);
+  }
+  while(mem.busy || comm.busy || press_done < press_cnt) {
+    queue_presses();
+    if(!sched.update()) bus->now++; //idle bus
+  }
+  report(name, t0);
+  printf("%30s memory task: %u gear, %u frames, %u wrong bytes; steps interactive %u commission %u bulk %u, bulk wait max %.1f ms\n", "",
+    mem_gear, mem.frames, mem_wrong, (unsigned)sched.steps[DALI_SCHED_INTERACTIVE], (unsigned)sched.steps[DALI_SCHED_COMMISSION],
+    (unsigned)sched.steps[DALI_SCHED_BULK], ms(sched.wait_max[DALI_SCHED_BULK]));
+  if(mem_gear != GEAR_CNT || mem_wrong) bad |= 4;
+  if(commission) {
+    uint64_t sa = 0;
+    uint8_t dup = 0;
+    for(uint8_t i = GEAR_CNT; i < GEAR_CNT + NEW_CNT; i++) {
+      uint8_t a = bus->gear[i].shortadr;
+      if(a >= 64 || ((sa >> a) & 1) || a < GEAR_CNT) dup = 1; else sa |= (uint64_t)1 << a;
+    }
+    printf("%30s commissioned %u new gear%s\n", "", comm.cnt, dup ? ", WRONG short addresses" : "");
+    if(comm.cnt != NEW_CNT || dup) bad |= 8;
+  }
+}
+
+int main() {
+  printf("%u gear, memory bank 0 (27 bytes), button presses every 400 ms on average\n", GEAR_CNT);
+
+  //blocking: the whole read, then the presses
+  static DaliSimGearBus b1;
+  setup(&b1);
+  uint8_t buf[32];
+  uint32_t t0 = bus->now;
+  for(uint8_t a = 0; a < GEAR_CNT; a++) dali.read_memory_bank(0, a, buf, sizeof(buf));
+  uint32_t read_ticks = bus->now - t0;
+  make_presses(t0, t0 + read_ticks);
+  handle_presses();
+  report("blocking", t0);
+
+  //blocking, buttons checked after every gear
+  static DaliSimGearBus b2;
+  setup(&b2);
+  t0 = bus->now;
+  make_presses(t0, t0 + read_ticks);
+  for(uint8_t a = 0; a < GEAR_CNT; a++) {
+    dali.read_memory_bank(0, a, buf, sizeof(buf));
+    handle_presses();
+  }
+  while(press_next < press_cnt) {
+    bus->now++;
+    handle_presses();
+  }
+  report("blocking per gear", t0);
+
+  static DaliSimGearBus b3, b4, b5;
+  run_sched(&b3, "scheduler", 1000, 0, read_ticks);
+  run_sched(&b4, "scheduler + commissioning", 1000, 1, read_ticks);
+  run_sched(&b5, "scheduler, bulk budget 30%", 300, 0, read_ticks);
+
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
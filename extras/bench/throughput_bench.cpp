@@ -0,0 +1,146 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+throughput_bench - forward frames per second of bus time on the sample
+level simulated bus, for commands without reply (set_level loops, group
+setup with send twice commands) and queries, with 6 virtual gear of a
+DaliGearEmu answering
+
+The bus line is observed for the settling times: the shortest gap from the
+end of a forward frame to the start of the next one, and from the end of a
+backward frame to the next forward frame.
+
+Build:
+  g++ -O2 -I../.. -o throughput_bench throughput_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_gear.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_gear.h"
+#include "../sim/dali_sim_bus.h"
+
+#include <stdio.h>
+
+#define GEAR_CNT 6
+
+static Dali ctl, emu;
+static DaliGearEmu gears;
+static DaliGear gear[GEAR_CNT];
+
+//bus line observation
+static uint8_t ctl_prev, emu_prev;
+static uint32_t ctl_high, emu_high;  //steps the controller / emulator released the line
+static uint32_t last_release;        //end of the last frame on the line
+static uint8_t last_fwd;             //the last frame was a forward frame
+static uint32_t gap_fwd, gap_bwd;    //shortest gap to the next forward frame
+
+static void step() {
+  dali_sim_step();
+  uint32_t t = dali_sim_steps;
+  uint8_t c = dali_sim_pull[0], e = dali_sim_pull[1];
+  if(c && !ctl_prev && ctl_high > 2 * DALI_OVERSAMPLE) {
+    uint32_t gap = t - last_release;
+    uint32_t *g = (last_fwd ? &gap_fwd : &gap_bwd);
+    if(gap < *g) *g = gap;
+  }
+  if(e && !emu_prev && emu_high > 2 * DALI_OVERSAMPLE) last_fwd = 0;
+  if(!c && ctl_prev) {
+    last_release = t;
+    last_fwd = 1;
+  }
+  if(!e && emu_prev) last_release = t;
+  ctl_high = (c ? 0 : ctl_high + 1);
+  emu_high = (e ? 0 : emu_high + 1);
+  ctl_prev = c;
+  emu_prev = e;
+}
+
+static double ms(uint32_t ticks) {
+  return Dali::ticks_to_us(ticks) / 1000.0;
+}
+
+static uint32_t t0, f0;
+static void start() {
+  t0 = dali_sim_steps;
+  f0 = gears.frames;
+}
+static void report(const char *name) {
+  uint32_t frames = gears.frames - f0;
+  double s = ms(dali_sim_steps - t0) / 1000;
+  printf("%-36s %5u frames %7.2f s %6.1f frames/s %6.2f ms/frame\n", name, (unsigned)frames, s, frames / s, 1000 * s / frames);
+}
+
+int main() {
+  dali_sim_attach(&ctl);
+  dali_sim_attach(&emu);
+  ctl.wait_hook = step;
+  for(uint8_t i = 0; i < GEAR_CNT; i++) gear[i].init(i, 0x100000 * (i + 1));
+  gears.begin(&emu, gear, GEAR_CNT);
+  int bad = 0;
+  printf("%u gear, %u ticks per second\n", GEAR_CNT, (unsigned)DALI_TICKS_PER_SECOND);
+
+  //set_level loop: DAPC to every gear
+  ctl.set_level(0, 0xFF);
+  gap_fwd = gap_bwd = 0xFFFFFFFF;
+  start();
+  for(uint16_t n = 0; n < 50; n++) {
+    for(uint8_t i = 0; i < GEAR_CNT; i++) ctl.set_level(1 + (n * 7 + i) % 254, i);
+  }
+  report("set_level loop");
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(gear[i].level != 1 + (49 * 7 + i) % 254) bad |= 1;
+  }
+
+  //group setup: ADD TO GROUP / REMOVE FROM GROUP, send twice
+  start();
+  for(uint8_t g = 0; g < 16; g++) {
+    for(uint8_t i = 0; i < GEAR_CNT; i++) {
+      if((g + i) & 1) ctl.cmd(DALI_ADD_TO_GROUP0 + g, i);
+      else ctl.cmd(DALI_REMOVE_FROM_GROUP0 + g, i);
+    }
+  }
+  report("group setup (send twice)");
+  for(uint8_t i = 0; i < GEAR_CNT; i++) {
+    if(gear[i].groups != (i & 1 ? 0x5555 : 0xAAAA)) bad |= 2;
+  }
+
+  //arc power commands to groups
+  start();
+  for(uint16_t n = 0; n < 100; n++) ctl.cmd(n & 1 ? DALI_RECALL_MAX_LEVEL : DALI_RECALL_MIN_LEVEL, 64 + (n & 15));
+  report("arc power commands to groups");
+
+  //queries: the reply window is still waited for
+  start();
+  uint32_t ok = 0;
+  for(uint16_t n = 0; n < 100; n++) {
+    if(ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, n % GEAR_CNT) == gear[n % GEAR_CNT].level) ok++;
+  }
+  report("QUERY ACTUAL LEVEL");
+  if(ok != 100) bad |= 4;
+  start();
+  ok = 0;
+  for(uint16_t n = 0; n < 100; n++) {
+    if(ctl.cmd(DALI_QUERY_LAMP_FAILURE, n % GEAR_CNT) == -DALI_RESULT_NO_REPLY) ok++;
+  }
+  report("QUERY LAMP FAILURE (NO)");
+  if(ok != 100) bad |= 4;
+
+  printf("shortest gap to the next forward frame: after a forward frame %.2f ms, after a backward frame %.2f ms\n",
+    ms(gap_fwd), ms(gap_bwd));
+
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
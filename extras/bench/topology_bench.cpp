@@ -0,0 +1,171 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+topology_bench - bus time of a pruned topology scan vs. querying every
+short address and vs. a warm start from a snapshot, on 64 simulated gear
+(mixed products with different reply delays, and one product whose replies
+merge), and a check that verify() detects replaced and new gear
+
+Build:
+  g++ -O2 -I../.. -o topology_bench topology_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_topology.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_topology.h"
+#include "../sim/dali_sim_gear.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static Dali dali;
+static DaliSimGearBus bus;
+
+//snapshot storage (EEPROM/flash stand-in)
+static uint8_t store[2048];
+static uint16_t store_len, store_pos;
+static void store_write(const uint8_t *data, uint8_t len) {
+  memcpy(store + store_len, data, len);
+  store_len += len;
+}
+static int16_t store_read() {
+  return store_pos < store_len ? store[store_pos++] : -1;
+}
+
+static void report(const char *name, DaliTopology &t, uint32_t f0, uint32_t b0) {
+  printf("%-30s frames=%5u bus=%6.2fs\n", name, (unsigned)(t.frames - f0), (t.bus_ticks - b0) / (double)DALI_TICKS_PER_SECOND);
+}
+
+int main() {
+  for(uint8_t i = 0; i < 64; i++) {
+    uint8_t g = bus.add(i, i < 16 ? 8 : 6);
+    bus.gear[g].groups = 1 << (i / 8);
+    for(uint8_t s = 0; s < 4; s++) bus.gear[g].scene[s] = 64 * s + i;
+  }
+  bus.gear[20].device_type2 = 50; //LED gear with memory bank 1 extension: two device types
+  dali.begin(&bus);
+  int bad = 0;
+
+  //baseline: every value of every short address
+  DaliTopology full;
+  full.begin(&dali);
+  for(uint8_t i = 0; i < 64; i++) full.refresh(i);
+  report("refresh() per short address", full, 0, 0);
+
+  //cold start: pruned scan
+  DaliTopology cold;
+  cold.begin(&dali);
+  uint8_t n = cold.scan();
+  report("cold start: scan()", cold, 0, 0);
+  if(n != 64 || cold.group_members(2) != (uint64_t)0xFF << 16 || !cold.has_device_type(3, 8) || cold.gear(5)->scene[3] != 197) bad++;
+  if(!cold.has_device_type(20, 6) || !cold.has_device_type(20, 50) || cold.has_device_type(21, 50)) bad++;
+  for(uint8_t i = 0; i < 64; i++) {
+    if(memcmp(cold.gear(i), full.gear(i), sizeof(DaliTopoGear))) bad++;
+  }
+
+  //one product: all gear reply at the same delay, identical replies merge and the scan is pruned
+  uint16_t reply_us[64];
+  for(uint8_t i = 0; i < 64; i++) {
+    reply_us[i] = bus.gear[i].reply_us;
+    bus.gear[i].reply_us = 7000;
+  }
+  DaliTopology one;
+  one.begin(&dali);
+  one.scan();
+  report("scan(), one product", one, 0, 0);
+  for(uint8_t i = 0; i < 64; i++) {
+    if(memcmp(one.gear(i), full.gear(i), sizeof(DaliTopoGear))) bad++;
+    bus.gear[i].reply_us = reply_us[i];
+  }
+
+  //overlapping identical replies often decoded as a wrong value: rejected by the confirming addressed query
+  bus.wrong_permille = 500;
+  DaliTopology wrong;
+  wrong.begin(&dali);
+  wrong.scan();
+  report("scan(), 50% wrong merges", wrong, 0, 0);
+  for(uint8_t i = 0; i < 64; i++) {
+    if(memcmp(wrong.gear(i), full.gear(i), sizeof(DaliTopoGear))) bad++;
+  }
+  bus.wrong_permille = 3;
+
+  //time sliced in the background, 25% of the bus time, the application queries a gear meanwhile
+  DaliTopology bg;
+  bg.begin(&dali);
+  bg.scan_budget_permille = 250;
+  bg.scan_start();
+  uint32_t t0 = bus.now;
+  uint32_t app = 0;
+  while(bg.scan_update()) {
+    bus.now++;
+    if(++app % 64 == 0) dali.cmd(DALI_QUERY_ACTUAL_LEVEL, 0);
+  }
+  printf("%-30s frames=%5u bus=%6.2fs elapsed=%6.2fs\n", "scan_update() at 25%", (unsigned)bg.scan_frames,
+    bg.scan_ticks / (double)DALI_TICKS_PER_SECOND, (bus.now - t0) / (double)DALI_TICKS_PER_SECOND);
+  if(bg.present != cold.present || memcmp(bg.gear(40), cold.gear(40), sizeof(DaliTopoGear))) bad++;
+
+  //typical installation: the scene levels are set per group
+  for(uint8_t i = 0; i < 64; i++) {
+    for(uint8_t s = 0; s < 4; s++) bus.gear[i].scene[s] = 64 * s + i / 8;
+  }
+  DaliTopology typ;
+  typ.begin(&dali);
+  typ.scan();
+  report("scan(), scenes per group", typ, 0, 0);
+  if(typ.gear(13)->scene[2] != 129) bad++;
+  for(uint8_t i = 0; i < 64; i++) {
+    for(uint8_t s = 0; s < 4; s++) bus.gear[i].scene[s] = 64 * s + i;
+  }
+  store_len = 0;
+  uint16_t size = cold.serialize(store_write);
+  printf("snapshot: %u bytes (max %u)\n", size, DaliTopology::snapshot_size(64));
+
+  //warm start: deserialize + verify
+  DaliTopology warm;
+  warm.begin(&dali);
+  store_pos = 0;
+  if(warm.deserialize(store_read) != DALI_OK) bad++;
+  if(warm.present != cold.present || memcmp(warm.gear(63), cold.gear(63), sizeof(DaliTopoGear))) bad++;
+  int16_t rv = warm.verify();
+  report("warm start: verify(8)", warm, 0, 0);
+  if(rv != 0) bad++;
+
+  //corrupted snapshot
+  store[20] ^= 1;
+  store_pos = 0;
+  if(warm.deserialize(store_read) != -DALI_RESULT_INVALID_SNAPSHOT || warm.present) bad++;
+  store[20] ^= 1;
+  store_pos = 0;
+  warm.deserialize(store_read);
+
+  //gear 10 replaced by gear with the same short address: found when sampled
+  bus.gear[10].randomadr ^= 0x5A5A5A;
+  uint32_t f0 = warm.frames, b0 = warm.bus_ticks;
+  rv = warm.verify(0xFF);
+  report("replaced gear: verify(all)", warm, f0, b0);
+  if(rv != 1 || warm.mismatch != (uint64_t)1 << 10 || warm.unaddressed) bad++;
+  f0 = warm.frames;
+  b0 = warm.bus_ticks;
+  warm.refresh(10);
+  report("refresh(10)", warm, f0, b0);
+  if(warm.verify(0xFF) != 0) bad++;
+
+  //gear 63 replaced by new gear without short address
+  bus.gear[63].init(0xFF, 0xABCDEF, 6);
+  if(warm.verify() != 1 || !warm.unaddressed) bad++;
+
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  return bad;
+}
@@ -0,0 +1,175 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+trace_bench - DALI_TRACE ring: events of a controller and an emulated gear
+on the sample level simulated bus, formatted as extras/trace/dalitrace
+prints them, loss reporting when the ring is not drained, a writer thread
+racing the reader, and the cost of one trace entry
+
+Build:
+  g++ -O2 -DDALI_TRACE -I../.. -o trace_bench trace_bench.cpp ../../qqqDALI.cpp ../../qqqDALI_gear.cpp -lpthread
+###########################################################################*/
+#include "qqqDALI.h"
+#include "qqqDALI_gear.h"
+#include "../sim/dali_sim_bus.h"
+#include "../trace/dali_trace_fmt.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifndef DALI_TRACE
+#error "build with -DDALI_TRACE"
+#endif
+
+static Dali ctl, emu;
+static DaliGearEmu gears;
+static DaliGear gear[2];
+
+static double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//drain a ring, print the entries if name is set, returns the number of entries (DALI_EV_LOST: the count it reports)
+static uint32_t drain(Dali *d, const char *name, uint32_t *ids) {
+  DaliTraceEntry e;
+  uint32_t n = 0;
+  while(d->trace.read(&e)) {
+    dali_trace_rec r = {e.tick, e.id, e.a, e.b, e.c};
+    char buf[80];
+    if(name) printf("  %-4s %10.3f  %s\n", name, e.tick * 1000.0 / DALI_TICKS_PER_SECOND, dali_trace_format(&r, buf, sizeof(buf)));
+    if(ids) ids[n < 16 ? n : 15] = e.id;
+    n += (e.id == DALI_EV_LOST ? e.a : 1);
+  }
+  return n;
+}
+
+//writer thread for the race test
+static DaliTrace race;
+static volatile uint8_t race_stop;
+static volatile uint32_t race_written;
+static void *race_writer(void *) {
+  uint32_t i = 0;
+  while(!race_stop) {
+    uint8_t a = i;
+    race.put(1, i, a, ~a, a ^ 0x5A);
+    i++;
+    race_written = i;
+    if(!(i & 0x0F)) sched_yield(); //the reader must get in before 256 entries (8 bit sequence numbers)
+  }
+  return 0;
+}
+
+int main() {
+  dali_sim_attach(&ctl);
+  dali_sim_attach(&emu);
+  ctl.wait_hook = dali_sim_step;
+  gear[0].init(0, 0x123456);
+  gear[1].init(1, 0x654321);
+  gears.begin(&emu, gear, 2);
+  dali_sim_run(100);
+  drain(&ctl, 0, 0);
+  drain(&emu, 0, 0);
+  int bad = 0;
+  uint32_t lost0;
+
+  //one exchange of each kind, traced
+  printf("query with reply, query without reply, command, memory bank read:\n");
+  ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, 0);
+  dali_sim_run(DALI_MS_TO_TICKS(30)); //emulator sees the end of the backward frame
+  drain(&ctl, "ctl", 0);
+  drain(&emu, "emu", 0);
+  ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, 7);
+  drain(&ctl, "ctl", 0);
+  ctl.set_level(50, 1);
+  drain(&ctl, "ctl", 0);
+  uint8_t bank[32];
+  ctl.read_memory_bank(0, 1, bank, sizeof(bank));
+  uint32_t n = drain(&ctl, 0, 0);
+  printf("  ctl  (memory bank read: %u entries)\n", (unsigned)n);
+  drain(&emu, 0, 0);
+
+  //every query is traced in the same order when drained after each one
+  uint32_t queries = 2000, ok = 0;
+  static const uint8_t expect[] = {DALI_EV_FORWARD, DALI_EV_TX_START, DALI_EV_TX_END, DALI_EV_RX_START, DALI_EV_RX_END,
+    DALI_EV_RX_DECODE, DALI_EV_RESULT};
+  lost0 = ctl.trace.lost;
+  for(uint32_t i = 0; i < queries; i++) {
+    uint32_t ids[16];
+    ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, i & 1);
+    n = drain(&ctl, 0, ids);
+    uint8_t same = (n == sizeof(expect));
+    for(uint8_t k = 0; same && k < n; k++) same = (ids[k] == expect[k]);
+    if(same) ok++;
+    else if(i == 0) {
+      printf("unexpected sequence:");
+      for(uint8_t k = 0; k < n && k < 16; k++) printf(" %u", (unsigned)ids[k]);
+      printf("\n");
+    }
+    drain(&emu, 0, 0);
+  }
+  printf("%u queries drained after each: %u with the expected %u entries, lost=%u\n", (unsigned)queries, (unsigned)ok,
+    (unsigned)sizeof(expect), (unsigned)(ctl.trace.lost - lost0));
+  if(ok != queries || ctl.trace.lost != lost0) bad |= 1;
+
+  //not drained: the oldest entries are overwritten and reported as lost
+  for(uint32_t i = 0; i < 20; i++) ctl.cmd(DALI_QUERY_ACTUAL_LEVEL, 0);
+  n = drain(&ctl, 0, 0);
+  uint32_t lost = ctl.trace.lost - lost0;
+  printf("20 queries not drained: %u entries written, read %u, lost %u\n", (unsigned)(20 * sizeof(expect)),
+    (unsigned)(n - lost), (unsigned)lost);
+  if(n != 20 * sizeof(expect) || n - lost != DALI_TRACE_SIZE) bad |= 2;
+
+  //writer thread racing the reader: no torn entries, written = read + lost
+  pthread_t th;
+  pthread_create(&th, 0, race_writer, 0);
+  uint32_t got = 0, torn = 0, order = 0, last = 0;
+  double t0 = now_s();
+  while(now_s() - t0 < 1.0) {
+    DaliTraceEntry e;
+    while(race.read(&e)) {
+      if(e.id == DALI_EV_LOST) continue;
+      uint8_t a = e.tick;
+      if(e.a != a || e.b != (uint8_t)~a || e.c != (a ^ 0x5A)) torn++;
+      if(got && e.tick <= last) order++;
+      last = e.tick;
+      got++;
+    }
+  }
+  race_stop = 1;
+  pthread_join(th, 0);
+  DaliTraceEntry e;
+  while(race.read(&e)) {
+    if(e.id != DALI_EV_LOST) got++;
+  }
+  printf("race: written %u, read %u, lost %u, torn %u, out of order %u\n", (unsigned)race_written, (unsigned)got,
+    (unsigned)race.lost, (unsigned)torn, (unsigned)order);
+  if(torn || order || got + race.lost != race_written) bad |= 4;
+
+  //cost of an entry
+  DaliTrace t;
+  uint32_t cnt = 10000000;
+  t0 = now_s();
+  for(uint32_t i = 0; i < cnt; i++) t.put(DALI_EV_RX_START, i, 1, 0, 0);
+  double t1 = now_s();
+  printf("trace.put(): %.1f ns\n", (t1 - t0) / cnt * 1e9);
+
+  printf("verify: %s\n", bad ? "FAIL" : "ok");
+  if(bad) printf("failed checks 0x%02X\n", bad);
+  return bad;
+}
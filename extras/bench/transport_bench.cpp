@@ -0,0 +1,78 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+transport_bench - high level commands over the sample engine vs. a byte
+stream transport: frames per second and host CPU time per frame
+
+Build:
+  g++ -O2 -I../.. -o transport_bench transport_bench.cpp ../../qqqDALI.cpp -lpthread
+
+Usage:
+  transport_bench sim [n]            sample engine, timer() thread in this process
+  transport_bench serial:<dev> [n]   DaliStreamTransport, e.g. to extras/sim/dali_pty_adapter
+###########################################################################*/
+#include "qqqDALI.h"
+#include "../sim/dali_sim_bus.h"
+#include "../sim/dali_host_serial.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+static Dali dali;
+static DaliStreamTransport serial_transport;
+
+static double cpu_s() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static double wall_s() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: transport_bench sim|serial:<dev> [n]\n");
+    return 1;
+  }
+  int n = (argc > 2 ? atoi(argv[2]) : 100);
+  if(!strcmp(argv[1], "sim")) {
+    dali_sim_attach(&dali);
+    dali_sim_start_realtime();
+  }else if(!strncmp(argv[1], "serial:", 7)) {
+    if(dali_serial_open(&serial_transport, argv[1] + 7)) return 1;
+    dali.begin(&serial_transport);
+  }else{
+    return 1;
+  }
+
+  double w0 = wall_s();
+  double c0 = cpu_s();
+  for(int i = 0; i < n; i++) {
+    if(i & 1) dali.set_level(i & 0xFE);
+    else dali.cmd(DALI_QUERY_STATUS, 0xFF);
+  }
+  double w = wall_s() - w0;
+  double c = cpu_s() - c0;
+  printf("%s: frames=%d wall=%.2fs frames/s=%.1f cpu=%.3fs cpu/frame=%.1fus\n", argv[1], n, w, n / w, c, c / n * 1e6);
+  return 0;
+}
@@ -0,0 +1,171 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+tx_encode_bench - verify and benchmark the transmit encoders
+
+verify: every 8 and 16 bit frame and random frames of 1..32 bits are sent
+through tx()/timer(), the pin waveform is compared sample by sample with
+the waveform of Dali::encode_hb() and Dali::encode_edges(), and with the
+bit by bit encoder tx() used before (reference copy below).
+
+bench: host CPU time per 16 bit frame of each encoder, and interrupts per
+frame for timer(), an edge schedule and a DMA bitstream.
+
+Build:
+  g++ -O2 -I../.. -o tx_encode_bench tx_encode_bench.cpp ../../qqqDALI.cpp
+###########################################################################*/
+#include "qqqDALI.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static Dali dali;
+static uint8_t pin_high = 1;
+static uint8_t bus_is_high() { return pin_high; }
+static void bus_set_low() { pin_high = 0; }
+static void bus_set_high() { pin_high = 1; }
+
+//reference: the bit by bit encoder of tx() before the lookup table encoder
+static void ref_push_2hb(uint8_t *hb, uint8_t *hblen, uint8_t v) {
+  hb[*hblen >> 3] |= v << (6 - (*hblen & 0x7));
+  *hblen += 2;
+}
+
+static uint8_t ref_encode(const uint8_t *data, uint8_t bitlen, uint8_t *hb) {
+  uint8_t hblen = 0;
+  memset(hb, 0, DALI_TX_HB_BYTES);
+  ref_push_2hb(hb, &hblen, 0x2);
+  for(uint8_t i = 0; i < bitlen; i++) {
+    ref_push_2hb(hb, &hblen, data[i >> 3] & (1 << (7 - (i & 0x7))) ? 0x2 : 0x1);
+  }
+  ref_push_2hb(hb, &hblen, 0x0);
+  ref_push_2hb(hb, &hblen, 0x0);
+  return hblen;
+}
+
+//returns 0 if all waveforms agree
+static int verify(const uint8_t *data, uint8_t bitlen) {
+  uint8_t hb[DALI_TX_HB_BYTES], ref[DALI_TX_HB_BYTES], edges[DALI_TX_EDGES_MAX];
+  uint8_t hblen = Dali::encode_hb(data, bitlen, hb);
+  uint8_t reflen = ref_encode(data, bitlen, ref);
+  uint8_t ne = Dali::encode_edges(data, bitlen, edges);
+  if(hblen != reflen) return 2;
+
+  //waveform of the sample engine: DALI_OVERSAMPLE/2 samples per half bit, it goes idle on the sample after the last stop half bit
+  const uint8_t sphb = DALI_OVERSAMPLE / 2;
+  uint8_t wave[sphb * 70];
+  if(dali.tx((uint8_t *)data, bitlen)) return 1;
+  for(uint16_t n = 0; n < sphb * hblen; n++) {
+    dali.timer();
+    wave[n] = pin_high;
+  }
+  dali.timer();
+  if(dali.tx_state() != DALI_OK) return 2;
+  for(uint8_t i = 0; i < 20; i++) dali.timer(); //idle between frames
+  uint8_t e = 0;
+  uint8_t level_high = 1;
+  for(uint8_t i = 0; i < hblen; i++) {
+    uint8_t hb_high = !((hb[i >> 3] >> (7 - (i & 7))) & 1);
+    uint8_t ref_high = !((ref[i >> 3] >> (7 - (i & 7))) & 1);
+    while(e < ne && edges[e] == i) {
+      level_high = (e & 1);
+      e++;
+    }
+    if(hb_high != ref_high || hb_high != level_high) return 3;
+    for(uint8_t s = 0; s < sphb; s++) {
+      if(wave[sphb * i + s] != hb_high) return 4;
+    }
+  }
+  if(e != ne || !level_high) return 5;
+  if(Dali::hb_collision(hb, hb, hblen) != 0xFF) return 6;
+  return 0;
+}
+
+static double now_s() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main() {
+  dali.begin(bus_is_high, bus_set_low, bus_set_high);
+  for(uint8_t i = 0; i < 20; i++) dali.timer();
+
+  //verify
+  uint32_t frames = 0, bad = 0;
+  uint8_t d[4];
+  for(uint32_t v = 0; v < 0x100; v++) {
+    d[0] = v;
+    if(verify(d, 8)) bad++;
+    frames++;
+  }
+  for(uint32_t v = 0; v < 0x10000; v++) {
+    d[0] = v >> 8;
+    d[1] = v;
+    if(verify(d, 16)) bad++;
+    frames++;
+  }
+  srand(1);
+  for(uint32_t k = 0; k < 100000; k++) {
+    for(uint8_t i = 0; i < 4; i++) d[i] = rand();
+    if(verify(d, 1 + k % 32)) bad++;
+    frames++;
+  }
+  //collision check: bus read back low in the second half of the start bit
+  uint8_t hb[DALI_TX_HB_BYTES], rx[DALI_TX_HB_BYTES];
+  d[0] = 0xFF;
+  uint8_t hblen = Dali::encode_hb(d, 8, hb);
+  memcpy(rx, hb, sizeof(rx));
+  rx[0] |= 0x40;
+  if(Dali::hb_collision(hb, rx, hblen) != 1) bad++;
+  printf("verify: %u frames, %u mismatches: %s\n", (unsigned)frames, (unsigned)bad, bad ? "FAIL" : "ok");
+
+  //encode cost, 16 bit frames
+  const uint32_t n = 20000000;
+  volatile uint8_t sink = 0;
+  uint8_t edges[DALI_TX_EDGES_MAX];
+  uint32_t edgecnt = 0;
+  double t0 = now_s();
+  for(uint32_t i = 0; i < n; i++) {
+    d[0] = i >> 8;
+    d[1] = i;
+    sink += ref_encode(d, 16, hb) + hb[2];
+  }
+  double t1 = now_s();
+  for(uint32_t i = 0; i < n; i++) {
+    d[0] = i >> 8;
+    d[1] = i;
+    sink += Dali::encode_hb(d, 16, hb) + hb[2];
+  }
+  double t2 = now_s();
+  for(uint32_t i = 0; i < n; i++) {
+    d[0] = i >> 8;
+    d[1] = i;
+    uint8_t ne = Dali::encode_edges(d, 16, edges);
+    sink += edges[ne - 1];
+    edgecnt += ne;
+  }
+  double t3 = now_s();
+  printf("bit by bit half bit encoder (old tx)   %5.1f ns/frame\n", (t1 - t0) / n * 1e9);
+  printf("nibble lookup half bit encoder         %5.1f ns/frame\n", (t2 - t1) / n * 1e9);
+  printf("edge schedule encoder                  %5.1f ns/frame\n", (t3 - t2) / n * 1e9);
+  printf("interrupts per 16 bit frame: timer() %d, edge schedule %.1f (avg), DMA bitstream 1\n",
+    DALI_OVERSAMPLE / 2 * (2 + 32 + 4), (double)edgecnt / n);
+  return bad ? 1 : 0;
+}
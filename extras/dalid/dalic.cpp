@@ -0,0 +1,126 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+dalic - minimal dalid client
+
+Build:
+  g++ -O2 -I../.. -o dalic dalic.cpp
+
+Usage:
+  dalic [-s socket] cmd <cmd> <arg>      execute a DALI_xxx command (numeric value)
+  dalic [-s socket] level <adr> <level>  set arc level
+  dalic [-s socket] load <n>             send n queries/levels pipelined, print stats
+###########################################################################*/
+#include "dalid_proto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static int sock_connect(const char *path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+  if(connect(fd, (struct sockaddr*)&sa, sizeof(sa))) {
+    perror("dalic: connect");
+    exit(1);
+  }
+  return fd;
+}
+
+static void send_msg(int fd, uint8_t op, uint16_t seq, uint16_t cmd, uint8_t arg) {
+  dalid_msg m;
+  memset(&m, 0, sizeof(m));
+  m.op = op;
+  m.seq = seq;
+  m.cmd = cmd;
+  m.arg = arg;
+  if(write(fd, &m, sizeof(m)) != sizeof(m)) {
+    perror("dalic: write");
+    exit(1);
+  }
+}
+
+static void recv_msg(int fd, dalid_msg *m) {
+  uint8_t *p = (uint8_t*)m;
+  size_t n = 0;
+  while(n < sizeof(*m)) {
+    int rv = read(fd, p + n, sizeof(*m) - n);
+    if(rv <= 0) {
+      fprintf(stderr, "dalic: connection closed\n");
+      exit(1);
+    }
+    n += rv;
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *sockpath = DALID_SOCKET_PATH;
+  int argi = 1;
+  if(argc > 2 && !strcmp(argv[1], "-s")) {
+    sockpath = argv[2];
+    argi = 3;
+  }
+  if(argc - argi < 2) {
+    fprintf(stderr, "usage: dalic [-s socket] cmd <cmd> <arg> | level <adr> <level> | load <n>\n");
+    return 1;
+  }
+  int fd = sock_connect(sockpath);
+  const char *what = argv[argi];
+  dalid_msg m;
+
+  if(!strcmp(what, "load")) {
+    //mix of shareable queries and level commands, all outstanding at once
+    int n = atoi(argv[argi + 1]);
+    for(int i = 0; i < n; i++) {
+      if(i & 1) {
+        send_msg(fd, DALID_OP_SET_LEVEL, i, 0xFF, i & 0xFE);
+      }else{
+        send_msg(fd, DALID_OP_CMD, i, 144 /*DALI_QUERY_STATUS*/, 0xFF);
+      }
+    }
+    int shared = 0;
+    for(int i = 0; i < n; i++) {
+      recv_msg(fd, &m);
+      if(m.flags & DALID_FLAG_SHARED) shared++;
+    }
+    send_msg(fd, DALID_OP_STATS, 0, 0, 0);
+    recv_msg(fd, &m);
+    printf("requests=%d shared=%d completed=%d lat_avg=%.1fms lat_max=%ums shared=%u%%\n",
+      n, shared, (int)m.result, m.latency_us / 1000.0, m.cmd, m.arg);
+    return 0;
+  }
+
+  if(argc - argi < 3) return 1;
+  uint16_t a = strtol(argv[argi + 1], NULL, 0);
+  uint8_t b = strtol(argv[argi + 2], NULL, 0);
+  if(!strcmp(what, "cmd")) {
+    send_msg(fd, DALID_OP_CMD, 1, a, b);
+  }else if(!strcmp(what, "level")) {
+    send_msg(fd, DALID_OP_SET_LEVEL, 1, a, b);
+  }else{
+    return 1;
+  }
+  recv_msg(fd, &m);
+  printf("result=%d latency=%.1fms%s\n", (int)m.result, m.latency_us / 1000.0, (m.flags & DALID_FLAG_SHARED) ? " shared" : "");
+  return 0;
+}
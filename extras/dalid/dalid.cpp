@@ -0,0 +1,549 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+dalid - Linux DALI gateway daemon
+
+Owns the DALI bus and multiplexes any number of clients onto it through a
+unix socket (protocol in dalid_proto.h).
+
+- identical queries arriving within the coalesce window share one bus
+  transaction: they attach to a pending/in-flight query, or get the cached
+  reply of a query that completed less than the window ago. Any non-query
+  command invalidates the cache.
+- pending DAPC (set_level) commands for the same address are merged (last
+  level wins), a pending broadcast DAPC supersedes all older pending DAPCs,
+  and DAPCs are sent before queries and the commands of other clients. A
+  DAPC does not overtake earlier commands of its own client: while one of
+  them is pending, it queues behind it and is not merged.
+- per-client throughput and latency are reported on disconnect, every
+  -r seconds, and through DALID_OP_STATS.
+- replies are queued per client and written when its socket takes them,
+  a client with more than 64 KB of unread replies is disconnected.
+
+Note: commands from different clients are interleaved, a client which loads
+DTR0 and then issues a SET_xxx command can race with another client doing
+the same.
+
+Build:
+  g++ -O2 -I../.. -o dalid dalid.cpp ../../qqqDALI.cpp -lpthread
+
+Usage:
+  dalid [-s socket] [-w coalesce_window_ms] [-r report_interval_s] [-b backend]
+
+Backends:
+  sim            in-process simulated bus, timer() driven by a DALI_TICKS_PER_SECOND thread
+  serial:<dev>   DaliStreamTransport to an adapter on a serial port (or the
+                 pty of extras/sim/dali_pty_adapter)
+###########################################################################*/
+#include "qqqDALI.h"
+#include "dalid_proto.h"
+#include "../sim/dali_sim_bus.h"
+#include "../sim/dali_host_serial.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+static Dali dali;
+
+static uint64_t now_us() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+//======================================================================
+// Bus backends
+//======================================================================
+struct backend {
+  const char *name;
+  int (*start)(const char *arg); //install hooks with dali.begin() and start the bus, returns 0 on success
+};
+
+//----------------------------------------------------------------------
+//sim: sample engine on the in-process simulated bus, timer() driven by a DALI_TICKS_PER_SECOND thread
+static int sim_start(const char *) {
+  dali_sim_attach(&dali);
+  return dali_sim_start_realtime();
+}
+
+//----------------------------------------------------------------------
+//serial: frame transport to an adapter which does its own bit timing, no timer() needed
+static DaliStreamTransport serial_transport;
+
+static int serial_start(const char *dev) {
+  if(!dev || dali_serial_open(&serial_transport, dev)) return 1;
+  dali.begin(&serial_transport);
+  return 0;
+}
+
+static const backend backends[] = {
+  {"sim", sim_start},
+  {"serial", serial_start},
+};
+
+//======================================================================
+// Transactions
+//======================================================================
+struct waiter {
+  uint64_t client_id;
+  dalid_msg req;
+  uint64_t t_enqueue;
+  uint8_t shared;
+};
+
+struct txn {
+  uint8_t op;
+  uint16_t cmd;
+  uint8_t arg;
+  int32_t result;
+  uint32_t gen;    //cache generation the transaction was queued in
+  std::vector<waiter> waiters;
+};
+
+//shared between main thread and bus worker, protected by q_mutex
+static pthread_mutex_t q_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t q_cond = PTHREAD_COND_INITIALIZER;
+static std::deque<txn*> q_level;  //DAPC commands, served first
+static std::deque<txn*> q_normal; //everything else, FIFO
+static txn *q_inflight;           //transaction currently on the bus
+static std::deque<txn*> q_done;   //completed, waiting for replies to be sent
+static int done_pipe[2];          //worker -> main thread wakeup
+
+//bus statistics
+static uint64_t stat_txn;         //bus transactions executed
+static uint64_t stat_req;         //requests received
+
+//is cmd a query without side effects, i.e. can replies be shared?
+static uint8_t is_shareable_query(uint16_t cmd) {
+  switch(cmd) {
+    case DALI_COMPARE:
+    case DALI_VERIFY_SHORT_ADDRESS:
+    case DALI_QUERY_SHORT_ADDRESS:
+      return 0; //depend on INITIALISE state set up by the client
+  }
+  if(cmd & 0x0300) return 0;
+  if(cmd == DALI_READ_MEMORY_LOCATION) return 0; //increments DTR0
+  return (cmd >= DALI_QUERY_STATUS && cmd < 224); //224-255 are device type specific
+}
+
+static uint32_t txn_key(uint8_t op, uint16_t cmd, uint8_t arg) {
+  return ((uint32_t)op << 24) | ((uint32_t)cmd << 8) | arg;
+}
+
+static void *bus_worker_thread(void *) {
+  while(1) {
+    pthread_mutex_lock(&q_mutex);
+    while(q_level.empty() && q_normal.empty()) pthread_cond_wait(&q_cond, &q_mutex);
+    std::deque<txn*> &q = (q_level.empty() ? q_normal : q_level);
+    txn *t = q.front();
+    q.pop_front();
+    q_inflight = t;
+    pthread_mutex_unlock(&q_mutex);
+
+    int32_t rv = 0;
+    if(t->op == DALID_OP_SET_LEVEL) {
+      dali.set_level(t->arg, t->cmd);
+    }else{
+      rv = dali.cmd(t->cmd, t->arg);
+    }
+
+    pthread_mutex_lock(&q_mutex);
+    t->result = rv;
+    q_inflight = NULL;
+    q_done.push_back(t);
+    stat_txn++;
+    pthread_mutex_unlock(&q_mutex);
+    char c = 0;
+    if(write(done_pipe[1], &c, 1) < 0) {}
+  }
+  return NULL;
+}
+
+//======================================================================
+// Clients
+//======================================================================
+struct client {
+  uint64_t id;
+  int fd;
+  uint8_t buf[sizeof(dalid_msg)];
+  uint8_t buflen;
+  uint64_t t_connect;
+  uint64_t requests;
+  uint64_t completed;
+  uint64_t shared;
+  uint64_t latency_sum_us;
+  uint64_t latency_max_us;
+  std::vector<uint8_t> out; //replies the socket did not take yet, written when poll() reports POLLOUT
+};
+
+#define CLIENT_OUT_MAX 65536 //a client which does not read its replies is disconnected
+
+static std::map<uint64_t, client> clients;
+static uint64_t next_client_id = 1;
+
+//cache of recently completed shareable queries: key -> (result, completion time)
+struct cached_reply {
+  int32_t result;
+  uint64_t t;
+};
+static std::map<uint32_t, cached_reply> cache;
+static uint32_t coalesce_window_us = 50000;
+static uint32_t cache_gen;        //bumped by every queued non-query: older query replies may be stale
+
+//write as much of the queued replies as the socket takes, returns 0 if client should be closed
+static uint8_t client_write(client &c) {
+  while(!c.out.empty()) {
+    ssize_t n = write(c.fd, &c.out[0], c.out.size());
+    if(n < 0) return (errno == EAGAIN || errno == EINTR);
+    c.out.erase(c.out.begin(), c.out.begin() + n);
+  }
+  return 1;
+}
+
+//queue a message for the client and write it if the socket takes it, a dead client is detected by poll()
+static void client_send(client &c, const dalid_msg &m) {
+  const uint8_t *p = (const uint8_t*)&m;
+  c.out.insert(c.out.end(), p, p + sizeof(m));
+  client_write(c);
+}
+
+static void send_reply(client &c, const dalid_msg &req, int32_t result, uint64_t t_enqueue, uint8_t shared) {
+  uint64_t lat = now_us() - t_enqueue;
+  c.completed++;
+  if(shared) c.shared++;
+  c.latency_sum_us += lat;
+  if(lat > c.latency_max_us) c.latency_max_us = lat;
+
+  dalid_msg m = req;
+  m.flags = (shared ? DALID_FLAG_SHARED : 0);
+  m.result = result;
+  m.latency_us = (lat > 0xffffffff ? 0xffffffff : lat);
+  client_send(c, m);
+}
+
+static void print_client_stats(const client &c, const char *event) {
+  double secs = (now_us() - c.t_connect) / 1e6;
+  fprintf(stderr, "client %llu %s: req=%llu done=%llu shared=%llu rate=%.1f/s lat_avg=%.1fms lat_max=%.1fms\n",
+    (unsigned long long)c.id, event,
+    (unsigned long long)c.requests, (unsigned long long)c.completed, (unsigned long long)c.shared,
+    secs > 0 ? c.completed / secs : 0.0,
+    c.completed ? c.latency_sum_us / 1000.0 / c.completed : 0.0,
+    c.latency_max_us / 1000.0);
+}
+
+//find an identical pending (not yet started) query, which is not followed by a command that could change its reply
+static txn *find_pending_query(std::deque<txn*> &q, uint8_t op, uint16_t cmd, uint8_t arg) {
+  for(size_t i = q.size(); i > 0; i--) {
+    txn *t = q[i - 1];
+    if(t->op == op && t->cmd == cmd && t->arg == arg) return t;
+    if(t->op != DALID_OP_CMD || !is_shareable_query(t->cmd)) return NULL;
+  }
+  return NULL;
+}
+
+//does the client have a pending (not yet started) command which is not a shareable query?
+static uint8_t has_pending_cmd(uint64_t client_id) {
+  for(size_t i = 0; i < q_normal.size(); i++) {
+    txn *t = q_normal[i];
+    if(t->op == DALID_OP_CMD && is_shareable_query(t->cmd)) continue;
+    for(size_t j = 0; j < t->waiters.size(); j++) {
+      if(t->waiters[j].client_id == client_id) return 1;
+    }
+  }
+  return 0;
+}
+
+static void enqueue(client &c, const dalid_msg &req) {
+  waiter w;
+  w.client_id = c.id;
+  w.req = req;
+  w.t_enqueue = now_us();
+  w.shared = 0;
+  stat_req++;
+  c.requests++;
+
+  if(req.op == DALID_OP_CMD && is_shareable_query(req.cmd)) {
+    //recently completed identical query -> reply from cache
+    std::map<uint32_t, cached_reply>::iterator it = cache.find(txn_key(req.op, req.cmd, req.arg));
+    if(it != cache.end() && w.t_enqueue - it->second.t < coalesce_window_us) {
+      send_reply(c, req, it->second.result, w.t_enqueue, 1);
+      return;
+    }
+    //identical query pending or on the bus, queued after the last non-query -> attach
+    pthread_mutex_lock(&q_mutex);
+    txn *t = find_pending_query(q_normal, req.op, req.cmd, req.arg);
+    if(!t && q_normal.empty() && q_level.empty() && q_inflight && q_inflight->op == req.op && q_inflight->cmd == req.cmd && q_inflight->arg == req.arg) t = q_inflight;
+    if(t && t->gen != cache_gen) t = NULL;
+    if(t) {
+      w.shared = 1;
+      if(t->waiters.size() == 1) t->waiters[0].shared = 1;
+      t->waiters.push_back(w);
+      pthread_mutex_unlock(&q_mutex);
+      return;
+    }
+    pthread_mutex_unlock(&q_mutex);
+  }else{
+    cache.clear(); //any command can change what queries return
+    cache_gen++;
+  }
+
+  //a DAPC jumps ahead of queries and other clients' commands, but queues behind pending commands of its own client
+  pthread_mutex_lock(&q_mutex);
+  if(req.op == DALID_OP_SET_LEVEL && !has_pending_cmd(c.id)) {
+    uint8_t adr = req.cmd;
+    txn *t = NULL;
+    if(adr == 0x7F || adr == 0xFF) {
+      //broadcast supersedes all pending DAPCs
+      t = new txn();
+      for(size_t i = 0; i < q_level.size(); i++) {
+        txn *p = q_level[i];
+        for(size_t j = 0; j < p->waiters.size(); j++) t->waiters.push_back(p->waiters[j]);
+        delete p;
+      }
+      q_level.clear();
+      q_level.push_back(t);
+    }else{
+      //merge with the last pending DAPC to the same address, unless a group/broadcast DAPC was queued after it
+      for(size_t i = q_level.size(); i > 0; i--) {
+        txn *p = q_level[i - 1];
+        if(p->cmd == adr) {
+          t = p;
+          break;
+        }
+        if(p->cmd >= 64) break;
+      }
+      if(!t) {
+        t = new txn();
+        q_level.push_back(t);
+      }
+    }
+    t->gen = cache_gen;
+    t->op = req.op;
+    t->cmd = adr;
+    t->arg = req.arg; //last level wins
+    if(!t->waiters.empty()) {
+      w.shared = 1;
+      for(size_t j = 0; j < t->waiters.size(); j++) t->waiters[j].shared = 1;
+    }
+    t->waiters.push_back(w);
+  }else{
+    txn *t = new txn();
+    t->gen = cache_gen;
+    t->op = req.op;
+    t->cmd = req.cmd;
+    t->arg = req.arg;
+    t->waiters.push_back(w);
+    q_normal.push_back(t);
+  }
+  pthread_cond_signal(&q_cond);
+  pthread_mutex_unlock(&q_mutex);
+}
+
+static void handle_stats(client &c, const dalid_msg &req) {
+  dalid_msg m = req;
+  m.flags = 0;
+  m.result = (c.completed > 0x7fffffff ? 0x7fffffff : c.completed);
+  m.latency_us = (c.completed ? c.latency_sum_us / c.completed : 0);
+  uint64_t max_ms = c.latency_max_us / 1000;
+  m.cmd = (max_ms > 0xffff ? 0xffff : max_ms);
+  m.arg = (c.completed ? c.shared * 100 / c.completed : 0);
+  client_send(c, m);
+}
+
+static void process_done() {
+  char buf[64];
+  while(read(done_pipe[0], buf, sizeof(buf)) > 0);
+
+  pthread_mutex_lock(&q_mutex);
+  std::deque<txn*> done;
+  done.swap(q_done);
+  pthread_mutex_unlock(&q_mutex);
+
+  uint64_t t_now = now_us();
+  for(size_t i = 0; i < done.size(); i++) {
+    txn *t = done[i];
+    if(t->op == DALID_OP_CMD && is_shareable_query(t->cmd)) {
+      //a non-query queued since this query may have changed the reply
+      if(t->gen == cache_gen) {
+        cached_reply cr;
+        cr.result = t->result;
+        cr.t = t_now;
+        cache[txn_key(t->op, t->cmd, t->arg)] = cr;
+      }
+    }else{
+      cache.clear();
+    }
+    for(size_t j = 0; j < t->waiters.size(); j++) {
+      waiter &w = t->waiters[j];
+      std::map<uint64_t, client>::iterator it = clients.find(w.client_id);
+      if(it == clients.end()) continue; //client disconnected
+      send_reply(it->second, w.req, t->result, w.t_enqueue, w.shared);
+    }
+    delete t;
+  }
+}
+
+//returns 0 if client should be closed
+static uint8_t client_read(client &c) {
+  int n = read(c.fd, c.buf + c.buflen, sizeof(c.buf) - c.buflen);
+  if(n <= 0) return (n < 0 && errno == EAGAIN);
+  c.buflen += n;
+  if(c.buflen < sizeof(dalid_msg)) return 1;
+  c.buflen = 0;
+
+  dalid_msg req;
+  memcpy(&req, c.buf, sizeof(req));
+  switch(req.op) {
+    case DALID_OP_CMD:
+    case DALID_OP_SET_LEVEL:
+      enqueue(c, req);
+      break;
+    case DALID_OP_STATS:
+      handle_stats(c, req);
+      break;
+    default:
+      return 0; //protocol error
+  }
+  return 1;
+}
+
+//======================================================================
+// Main
+//======================================================================
+static void usage() {
+  fprintf(stderr, "usage: dalid [-s socket] [-w coalesce_window_ms] [-r report_interval_s] [-b backend]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  const char *sockpath = DALID_SOCKET_PATH;
+  const char *backend_name = "sim";
+  uint32_t report_s = 0;
+  int opt;
+  while((opt = getopt(argc, argv, "s:w:r:b:")) != -1) {
+    switch(opt) {
+      case 's': sockpath = optarg; break;
+      case 'w': coalesce_window_us = atoi(optarg) * 1000; break;
+      case 'r': report_s = atoi(optarg); break;
+      case 'b': backend_name = optarg; break;
+      default: usage();
+    }
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  //backend name, optionally followed by :argument
+  const backend *be = NULL;
+  const char *backend_arg = strchr(backend_name, ':');
+  size_t namelen = (backend_arg ? (size_t)(backend_arg - backend_name) : strlen(backend_name));
+  if(backend_arg) backend_arg++;
+  for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+    if(strlen(backends[i].name) == namelen && !strncmp(backends[i].name, backend_name, namelen)) be = &backends[i];
+  }
+  if(!be) usage();
+  if(be->start(backend_arg)) {
+    fprintf(stderr, "dalid: backend %s failed to start\n", be->name);
+    return 1;
+  }
+
+  if(pipe(done_pipe)) return 1;
+  fcntl(done_pipe[0], F_SETFL, O_NONBLOCK);
+  pthread_t th;
+  pthread_create(&th, NULL, bus_worker_thread, NULL);
+
+  int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  strncpy(sa.sun_path, sockpath, sizeof(sa.sun_path) - 1);
+  unlink(sockpath);
+  if(bind(lfd, (struct sockaddr*)&sa, sizeof(sa)) || listen(lfd, 16)) {
+    perror("dalid: bind");
+    return 1;
+  }
+  fprintf(stderr, "dalid: backend=%s socket=%s window=%ums\n", be->name, sockpath, coalesce_window_us / 1000);
+
+  uint64_t t_report = now_us();
+  std::vector<struct pollfd> pfds;
+  std::vector<uint64_t> pids;
+  while(1) {
+    pfds.clear();
+    pids.clear();
+    struct pollfd p;
+    p.events = POLLIN;
+    p.fd = lfd;
+    pfds.push_back(p);
+    p.fd = done_pipe[0];
+    pfds.push_back(p);
+    for(std::map<uint64_t, client>::iterator it = clients.begin(); it != clients.end(); ++it) {
+      p.fd = it->second.fd;
+      p.events = (it->second.out.empty() ? POLLIN : POLLIN | POLLOUT);
+      pfds.push_back(p);
+      pids.push_back(it->first);
+    }
+    poll(&pfds[0], pfds.size(), 1000);
+
+    if(pfds[0].revents & POLLIN) {
+      int fd = accept(lfd, NULL, NULL);
+      if(fd >= 0) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        client c = client();
+        c.id = next_client_id++;
+        c.fd = fd;
+        c.t_connect = now_us();
+        clients[c.id] = c;
+      }
+    }
+    if(pfds[1].revents & POLLIN) process_done();
+    for(size_t i = 2; i < pfds.size(); i++) {
+      if(!pfds[i].revents) continue;
+      client &c = clients[pids[i - 2]];
+      uint8_t ok = 1;
+      if(pfds[i].revents & POLLOUT) ok = client_write(c);
+      if(ok && (pfds[i].revents & ~POLLOUT)) ok = client_read(c);
+      if(ok && c.out.size() > CLIENT_OUT_MAX) ok = 0;
+      if(!ok) {
+        print_client_stats(c, "disconnected");
+        close(c.fd);
+        clients.erase(c.id);
+      }
+    }
+
+    if(report_s && now_us() - t_report >= report_s * 1000000ull) {
+      t_report = now_us();
+      pthread_mutex_lock(&q_mutex);
+      fprintf(stderr, "bus: requests=%llu transactions=%llu pending=%u\n",
+        (unsigned long long)stat_req, (unsigned long long)stat_txn, (unsigned)(q_level.size() + q_normal.size()));
+      pthread_mutex_unlock(&q_mutex);
+      for(std::map<uint64_t, client>::iterator it = clients.begin(); it != clients.end(); ++it) print_client_stats(it->second, "report");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+dalid client protocol
+
+Clients connect to the daemon's unix stream socket and exchange fixed size
+16 byte messages, all multi byte fields little endian. A client may have
+any number of requests outstanding, replies carry the request's seq and
+can arrive out of order (level commands are prioritized over queries).
+
+request:  op, flags, seq, cmd, arg            (result, latency_us ignored)
+reply:    op, flags, seq, cmd, arg, result, latency_us
+
+DALID_OP_CMD        execute Dali::cmd(cmd,arg), result = reply byte or negative DALI_RESULT_xxx
+DALID_OP_SET_LEVEL  execute Dali::set_level(arg,cmd), cmd = address (YAAAAAA), arg = level, result = 0
+DALID_OP_STATS      result = number of completed requests of this client
+                    latency_us = mean latency, cmd = max latency in ms (capped at 65535)
+                    arg = percentage of requests that shared a bus transaction
+
+reply flags:
+DALID_FLAG_SHARED   the request shared a bus transaction with another request
+                    (coalesced identical query or merged level command)
+###########################################################################*/
+#ifndef DALID_PROTO_H
+#define DALID_PROTO_H
+
+#include <inttypes.h>
+
+#define DALID_SOCKET_PATH "/tmp/dalid.sock"
+
+#define DALID_OP_CMD 1
+#define DALID_OP_SET_LEVEL 2
+#define DALID_OP_STATS 3
+
+#define DALID_FLAG_SHARED 0x01
+
+struct __attribute__((packed)) dalid_msg {
+  uint8_t op;
+  uint8_t flags;
+  uint16_t seq;
+  uint16_t cmd;
+  uint8_t arg;
+  uint8_t reserved;
+  int32_t result;
+  uint32_t latency_us;
+};
+
+#endif
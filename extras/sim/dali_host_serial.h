@@ -0,0 +1,70 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+DaliStreamTransport hooks for a Linux serial port or pty (one per process)
+###########################################################################*/
+#ifndef DALI_HOST_SERIAL_H
+#define DALI_HOST_SERIAL_H
+
+#include "qqqDALI.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static int dali_serial_fd = -1;
+
+//returns -1 if no byte arrived within 1 ms, so callers busy waiting on it don't burn CPU
+static inline int16_t dali_serial_read_byte() {
+  struct pollfd p;
+  p.fd = dali_serial_fd;
+  p.events = POLLIN;
+  if(poll(&p, 1, 1) <= 0) return -1;
+  uint8_t c;
+  if(read(dali_serial_fd, &c, 1) != 1) return -1;
+  return c;
+}
+
+static inline void dali_serial_write_bytes(const uint8_t *data, uint8_t len) {
+  if(write(dali_serial_fd, data, len) != len) perror("dali_serial: write");
+}
+
+static inline uint32_t dali_serial_micros() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint32_t)((uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000);
+}
+
+//open dev in raw mode at 115200 baud and bind it to transport, returns 0 on success
+static inline int dali_serial_open(DaliStreamTransport *transport, const char *dev) {
+  dali_serial_fd = open(dev, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if(dali_serial_fd < 0) {
+    perror("dali_serial: open");
+    return 1;
+  }
+  struct termios tio;
+  tcgetattr(dali_serial_fd, &tio);
+  cfmakeraw(&tio);
+  cfsetspeed(&tio, B115200);
+  tcsetattr(dali_serial_fd, TCSANOW, &tio);
+  transport->begin(dali_serial_read_byte, dali_serial_write_bytes, dali_serial_micros);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+dali_pty_adapter - local stand-in for a serial DALI adapter
+
+Creates a pseudo terminal and serves the DaliStreamTransport protocol on
+it. Each forward frame is executed with the sample engine on the
+simulated bus (real time, timer() at DALI_TICKS_PER_SECOND), the result is sent back as reply.
+Point a DaliStreamTransport (for example dalid -b serial:<pty>) at the
+printed device path.
+
+Build:
+  g++ -O2 -I../.. -o dali_pty_adapter dali_pty_adapter.cpp ../../qqqDALI.cpp -lpthread
+###########################################################################*/
+#include "qqqDALI.h"
+#include "dali_sim_bus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+static Dali dali;
+
+int main() {
+  int mfd = posix_openpt(O_RDWR | O_NOCTTY);
+  if(mfd < 0 || grantpt(mfd) || unlockpt(mfd)) {
+    perror("dali_pty_adapter: posix_openpt");
+    return 1;
+  }
+  //keep the slave open in raw mode, so the settings stick when the client opens it
+  const char *path = ptsname(mfd);
+  int sfd = open(path, O_RDWR | O_NOCTTY);
+  struct termios tio;
+  tcgetattr(sfd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(sfd, TCSANOW, &tio);
+
+  dali_sim_attach(&dali);
+  dali_sim_start_realtime();
+
+  printf("%s\n", path);
+  fflush(stdout);
+
+  //parse DALI_STREAM_SYNC_REQ, seq, bitlen, data
+  uint8_t req[3+4];
+  uint8_t pos = 0;
+  uint8_t len = 0;
+  while(1) {
+    uint8_t c;
+    if(read(mfd, &c, 1) != 1) {
+      usleep(1000);
+      continue;
+    }
+    if(pos == 0 && c != DALI_STREAM_SYNC_REQ) continue;
+    req[pos++] = c;
+    if(pos == 3) {
+      if(req[2] > 32) {
+        pos = 0;
+        continue;
+      }
+      len = 3 + ((req[2] + 7) >> 3);
+    }
+    if(pos < 3 || pos < len) continue;
+    pos = 0;
+
+    int16_t rv = dali.transact(req + 3, req[2], 500);
+    uint8_t rep[4];
+    uint8_t n = DaliStreamTransport::build_reply(req[1], rv, rep);
+    if(write(mfd, rep, n) != n) perror("dali_pty_adapter: write");
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Simulated DALI bus for host (Linux) programs
+
+The bus line is a wired-AND: it is low if any attached node pulls it low.
+One bus per process, up to DALI_SIM_MAX_NODES Dali instances.
+
+Two ways to drive the nodes' timer():
+- dali_sim_start_realtime(): a thread calls dali_sim_step() DALI_TICKS_PER_SECOND times per second,
+  for daemons and stand-ins which talk to the outside world.
+- virtual time: set dali.wait_hook = dali_sim_step on the node that runs
+  blocking calls. Every wait loop iteration then advances the bus by one
+  sample period, deterministic and as fast as the CPU allows.
+###########################################################################*/
+#ifndef DALI_SIM_BUS_H
+#define DALI_SIM_BUS_H
+
+#include "qqqDALI.h"
+#include <pthread.h>
+#include <time.h>
+
+#define DALI_SIM_MAX_NODES 8
+
+static Dali *dali_sim_node[DALI_SIM_MAX_NODES];
+static volatile uint8_t dali_sim_pull[DALI_SIM_MAX_NODES]; //node is pulling the line low
+static uint8_t dali_sim_node_cnt;
+static uint32_t dali_sim_steps; //number of sample periods simulated
+
+static inline uint8_t dali_sim_bus_is_high() {
+  for(uint8_t i = 0; i < dali_sim_node_cnt; i++) if(dali_sim_pull[i]) return 0;
+  return 1;
+}
+
+template<int N> static void dali_sim_set_low() { dali_sim_pull[N] = 1; }
+template<int N> static void dali_sim_set_high() { dali_sim_pull[N] = 0; }
+
+static void (*const dali_sim_set_low_fn[DALI_SIM_MAX_NODES])() = {
+  dali_sim_set_low<0>, dali_sim_set_low<1>, dali_sim_set_low<2>, dali_sim_set_low<3>,
+  dali_sim_set_low<4>, dali_sim_set_low<5>, dali_sim_set_low<6>, dali_sim_set_low<7>,
+};
+static void (*const dali_sim_set_high_fn[DALI_SIM_MAX_NODES])() = {
+  dali_sim_set_high<0>, dali_sim_set_high<1>, dali_sim_set_high<2>, dali_sim_set_high<3>,
+  dali_sim_set_high<4>, dali_sim_set_high<5>, dali_sim_set_high<6>, dali_sim_set_high<7>,
+};
+
+//attach a node to the bus, returns node number or -1 if the bus is full
+static inline int dali_sim_attach(Dali *dali) {
+  if(dali_sim_node_cnt >= DALI_SIM_MAX_NODES) return -1;
+  uint8_t n = dali_sim_node_cnt;
+  dali_sim_node[n] = dali;
+  dali_sim_node_cnt++;
+  dali->begin(dali_sim_bus_is_high, dali_sim_set_low_fn[n], dali_sim_set_high_fn[n]);
+  return n;
+}
+
+//advance the bus by one sample period
+static inline void dali_sim_step() {
+  for(uint8_t i = 0; i < dali_sim_node_cnt; i++) dali_sim_node[i]->timer();
+  dali_sim_steps++;
+}
+
+//advance the bus by n sample periods
+static inline void dali_sim_run(uint32_t n) {
+  while(n--) dali_sim_step();
+}
+
+static inline void *dali_sim_realtime_thread(void *) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  while(1) {
+    t.tv_nsec += 1000000000 / DALI_TICKS_PER_SECOND;
+    if(t.tv_nsec >= 1000000000) {
+      t.tv_nsec -= 1000000000;
+      t.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+    dali_sim_step();
+  }
+  return NULL;
+}
+
+//drive the bus from a DALI_TICKS_PER_SECOND thread, returns 0 on success
+static inline int dali_sim_start_realtime() {
+  pthread_t th;
+  return pthread_create(&th, NULL, dali_sim_realtime_thread, NULL);
+}
+
+#endif
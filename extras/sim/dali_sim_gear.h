@@ -0,0 +1,415 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Frame level simulated bus with control gear, for host benchmarks
+
+DaliSimGearBus is a DaliTransport which executes each forward frame on a
+set of simulated gear and returns their backward frame. Every gear replies
+at its own delay after the forward frame (reply_us, 5.5-10.5 ms as real
+gear): identical replies starting within merge_us merge into one frame,
+further apart they overlap at an offset and are a collision, or with
+wrong_permille decode to a wrong value. Different replies are a collision.
+YES replies always merge (any bus activity is YES). Bus time is
+accounted in ticks the way the sample engine spends it:
+  settling idle + forward frame + (reply gap + backward frame | reply window)
+
+Gear model (IEC62386-102 subset): DAPC/arc commands, configuration commands
+(executed on the second of two identical frames), DTR0-2, queries, groups,
+scenes, memory bank 0, energy reporting banks 202/203 (IEC62386-252),
+diagnostics bank 205 (IEC62386-253), DT6 failure status, INITIALISE/RANDOMISE/COMPARE/WITHDRAW/PROGRAM/VERIFY
+addressing, DT8 colour temperature and RGBWAF (one active colour type).
+###########################################################################*/
+#ifndef DALI_SIM_GEAR_H
+#define DALI_SIM_GEAR_H
+
+#include "qqqDALI.h"
+#include <string.h>
+
+#define DALI_SIM_GEAR_MAX 64
+
+//bus time per transaction, in ticks
+#define DALI_SIM_T_FORWARD(bits) (((bits) + 3) * DALI_OVERSAMPLE) //start bit + data bits + 2 stop bits
+#define DALI_SIM_T_REPLY_GAP (30 * DALI_OVERSAMPLE / 8) //forward frame end to backward frame start (2.9-12.4 ms in the spec)
+#define DALI_SIM_T_BACKWARD (11 * DALI_OVERSAMPLE) //start bit + 8 bits + 2 stop bits
+#define DALI_SIM_T_NO_REPLY (DALI_MS_TO_TICKS(10) + 1) //reply window
+
+struct DaliSimGear {
+  uint8_t present;
+  uint8_t shortadr;       //0-63 or 0xFF for none
+  uint32_t randomadr;
+  uint32_t searchadr;
+  uint8_t level;
+  uint8_t min_level, max_level, power_on_level, failure_level, fade;
+  uint16_t groups;
+  uint8_t scene[16];
+  uint8_t dtr[3];
+  uint8_t device_type;    //6 LED, 8 colour
+  uint8_t device_type2;   //second device type, 0xFF: none. QUERY DEVICE TYPE answers MASK, QUERY NEXT DEVICE TYPE lists both
+  uint8_t next_dt;        //QUERY NEXT DEVICE TYPE position, 0: the previous frame was not QUERY (NEXT) DEVICE TYPE
+  uint8_t initialise;     //in INITIALISE state
+  uint8_t withdrawn;
+  uint8_t enabled_dt;     //device type enabled for the next command, 0xFF none
+  uint8_t lamp_failure;
+  uint8_t gear_failure;
+  uint8_t power_failure;  //set on power up, cleared by an arc power command
+  uint8_t failure_status; //DT6 failure status bits
+  uint16_t tc, tc_temp;   //DT8 colour temperature (mirek), temporary value (0xFFFF = MASK)
+  uint8_t rgbwaf[6], rgbwaf_temp[6];
+  uint8_t colour_type;    //DT8 active colour type, as QUERY COLOUR STATUS: 0x20 Tc, 0x80 RGBWAF
+  uint8_t bank0[27];
+  uint8_t bank202[16], bank203[16], bank205[29]; //bank 202/203/205 (location 0 is 0: not implemented)
+  uint8_t last0, last1;   //previous frame, for send-twice commands
+  uint16_t reply_us;      //start of the backward frame after the end of the forward frame
+  uint32_t seed;
+
+  void init(uint8_t sa, uint32_t rnd, uint8_t dt) {
+    memset(this, 0, sizeof(*this));
+    present = 1;
+    shortadr = sa;
+    randomadr = rnd & 0xFFFFFF;
+    seed = rnd * 2654435761u + 1;
+    min_level = 1;
+    max_level = 254;
+    power_on_level = 254;
+    failure_level = 254;
+    level = 254;
+    memset(scene, 0xFF, sizeof(scene));
+    device_type = dt;
+    device_type2 = 0xFF;
+    enabled_dt = 0xFF;
+    power_failure = 1;
+    tc = 250;
+    tc_temp = 0xFFFF;
+    memset(rgbwaf_temp, 0xFF, sizeof(rgbwaf_temp));
+    colour_type = 0x20;
+    bank0[0] = sizeof(bank0) - 1; //last accessible memory location
+    for(uint8_t i = 3; i < sizeof(bank0); i++) bank0[i] = i;
+    last0 = last1 = 0;
+    reply_us = 5500 + (seed >> 8) % 5001;
+  }
+
+  //memory bank, NULL if not implemented
+  uint8_t *memory_bank(uint8_t bank) {
+    uint8_t *p = 0;
+    if(bank == 0) p = bank0;
+    else if(bank == 202) p = bank202;
+    else if(bank == 203) p = bank203;
+    else if(bank == 205) p = bank205;
+    return (p && p[0]) ? p : 0;
+  }
+
+  //implement the energy reporting (202, with apparent energy also 203) and control gear diagnostics (205) banks
+  void init_metering(uint8_t apparent = 0) {
+    bank202[0] = sizeof(bank202) - 1;
+    bank202[3] = 1; //version
+    if(apparent) {
+      bank203[0] = sizeof(bank203) - 1;
+      bank203[3] = 1;
+    }
+    bank205[0] = sizeof(bank205) - 1;
+    bank205[3] = 1;
+  }
+
+  //store a big endian value of len bytes at location loc of a memory bank
+  void set_memory(uint8_t bank, uint8_t loc, uint8_t len, uint64_t v) {
+    uint8_t *p = (bank == 0 ? bank0 : bank == 202 ? bank202 : bank == 203 ? bank203 : bank205);
+    for(uint8_t i = len; i > 0; i--) {
+      p[loc + i - 1] = v & 0xFF;
+      v >>= 8;
+    }
+  }
+
+  //bus power failure for more than 500 ms: go to the system failure level
+  void bus_failure() {
+    if(failure_level != 0xFF) level = failure_level;
+  }
+
+  uint8_t addressed(uint8_t a) {
+    if((a & 0xFE) == 0xFE) return 1; //broadcast
+    if((a & 0xFE) == 0xFC) return shortadr == 0xFF; //broadcast unaddressed
+    if(!(a & 0x80)) return shortadr == ((a >> 1) & 0x3F);
+    if((a & 0xE0) == 0x80) return (groups >> ((a >> 1) & 0xF)) & 1;
+    return 0;
+  }
+
+  void set_level(uint8_t v) {
+    if(v == 0xFF) return; //MASK
+    power_failure = 0;
+    if(v == 0) level = 0;
+    else level = (v < min_level ? min_level : (v > max_level ? max_level : v));
+  }
+
+  uint8_t status() {
+    return (gear_failure ? 0x01 : 0) | (lamp_failure ? 0x02 : 0) | (level ? 0x04 : 0)
+      | (shortadr == 0xFF ? 0x40 : 0) | (power_failure ? 0x80 : 0);
+  }
+
+  //execute a 16 bit forward frame, returns reply byte or -1 for no reply
+  int16_t frame(uint8_t a, uint8_t b) {
+    if(!present) return -1;
+    uint8_t twice = (a == last0 && b == last1);
+    last0 = a;
+    last1 = b;
+    uint8_t dt = enabled_dt;
+    enabled_dt = 0xFF;
+    uint8_t ndt = next_dt; //the device type list only continues on the next frame
+    next_dt = 0;
+
+    //special commands
+    if(a >= 0xA0 && a <= 0xCB && (a & 1)) {
+      uint8_t match = initialise && !withdrawn && randomadr == searchadr;
+      switch(a) {
+        case 0xA1: initialise = 0; withdrawn = 0; return -1; //TERMINATE
+        case 0xA3: dtr[0] = b; return -1;
+        case 0xA5: //INITIALISE
+          if(twice && (b == 0x00 || (b == 0xFF && shortadr == 0xFF) || ((b & 0x81) == 0x01 && ((b >> 1) & 0x3F) == shortadr))) {
+            initialise = 1;
+            withdrawn = 0;
+          }
+          return -1;
+        case 0xA7: //RANDOMISE
+          if(twice && initialise) {
+            seed = seed * 1103515245u + 12345u;
+            randomadr = (seed >> 4) & 0xFFFFFF;
+          }
+          return -1;
+        case 0xA9: return (initialise && !withdrawn && randomadr <= searchadr) ? 0xFF : -1; //COMPARE
+        case 0xAB: if(match) withdrawn = 1; return -1; //WITHDRAW
+        case 0xB1: searchadr = (searchadr & 0x00FFFF) | ((uint32_t)b << 16); return -1;
+        case 0xB3: searchadr = (searchadr & 0xFF00FF) | ((uint32_t)b << 8); return -1;
+        case 0xB5: searchadr = (searchadr & 0xFFFF00) | b; return -1;
+        case 0xB7: if(match) shortadr = (b == 0xFF ? 0xFF : (b >> 1) & 0x3F); return -1; //PROGRAM SHORT ADDRESS
+        case 0xB9: return (initialise && shortadr == ((b >> 1) & 0x3F)) ? 0xFF : -1; //VERIFY SHORT ADDRESS
+        case 0xBB: return match ? (shortadr == 0xFF ? 0xFF : (shortadr << 1) | 1) : -1; //QUERY SHORT ADDRESS
+        case 0xC1: enabled_dt = b; return -1;
+        case 0xC3: dtr[1] = b; return -1;
+        case 0xC5: dtr[2] = b; return -1;
+      }
+      return -1;
+    }
+
+    if(!addressed(a)) return -1;
+    if(!(a & 1)) { //DAPC
+      set_level(b);
+      return -1;
+    }
+
+    //arc power commands
+    if(b < 32) {
+      switch(b) {
+        case 0: level = 0; power_failure = 0; break;
+        case 5: set_level(max_level); break;
+        case 6: set_level(min_level); break;
+        default:
+          if(b >= 16 && scene[b & 0xF] != 0xFF) set_level(scene[b & 0xF]);
+      }
+      return -1;
+    }
+
+    //configuration commands, executed when received twice
+    if(b < 144) {
+      if(!twice) return -1;
+      last0 = last1 = 0;
+      if(b == 32) { level = 254; groups = 0; memset(scene, 0xFF, sizeof(scene)); }
+      else if(b == 33) dtr[0] = level;
+      else if(b == 42) max_level = dtr[0];
+      else if(b == 43) min_level = dtr[0];
+      else if(b == 44) failure_level = dtr[0];
+      else if(b == 45) power_on_level = dtr[0];
+      else if(b == 46) fade = (fade & 0x0F) | (dtr[0] << 4);
+      else if(b == 47) fade = (fade & 0xF0) | (dtr[0] & 0x0F);
+      else if(b >= 64 && b < 80) scene[b & 0xF] = dtr[0];
+      else if(b >= 80 && b < 96) scene[b & 0xF] = 0xFF;
+      else if(b >= 96 && b < 112) groups |= 1 << (b & 0xF);
+      else if(b >= 112 && b < 128) groups &= ~(1 << (b & 0xF));
+      else if(b == 128) shortadr = (dtr[0] == 0xFF ? 0xFF : (dtr[0] >> 1) & 0x3F);
+      return -1;
+    }
+
+    //device type 8 application extended commands
+    if(b >= 224) {
+      if(dt == 6 && device_type == 6 && b == 241) return failure_status; //DT6 QUERY FAILURE STATUS
+      if(dt != 8 || device_type != 8) return -1;
+      switch(b) {
+        case 226: //ACTIVATE: the temporary colour type becomes the active one
+          if(tc_temp != 0xFFFF) {
+            tc = tc_temp;
+            colour_type = 0x20;
+          }
+          for(uint8_t i = 0; i < 6; i++) {
+            if(rgbwaf_temp[i] == 0xFF) continue;
+            rgbwaf[i] = rgbwaf_temp[i];
+            colour_type = 0x80;
+          }
+          tc_temp = 0xFFFF;
+          memset(rgbwaf_temp, 0xFF, sizeof(rgbwaf_temp));
+          return -1;
+        //a temporary value of one colour type drops those of the other
+        case 231: tc_temp = ((uint16_t)dtr[1] << 8) | dtr[0]; memset(rgbwaf_temp, 0xFF, sizeof(rgbwaf_temp)); return -1;
+        case 235: for(uint8_t i = 0; i < 3; i++) rgbwaf_temp[i] = dtr[i]; tc_temp = 0xFFFF; return -1;
+        case 236: for(uint8_t i = 0; i < 3; i++) rgbwaf_temp[3 + i] = dtr[i]; tc_temp = 0xFFFF; return -1;
+        case 248: return colour_type; //QUERY COLOUR STATUS
+        case 250: //QUERY COLOUR VALUE: MASK for a colour type which is not active
+          if(dtr[0] != 2 || colour_type != 0x20) {
+            dtr[0] = 0xFF;
+            return 0xFF;
+          }
+          dtr[0] = tc & 0xFF;
+          return tc >> 8;
+        case 255: return 2;
+      }
+      return -1;
+    }
+
+    //queries
+    switch(b) {
+      case 144: return status();
+      case 145: return 0xFF;
+      case 146: return lamp_failure ? 0xFF : -1;
+      case 147: return level ? 0xFF : -1;
+      case 150: return shortadr == 0xFF ? 0xFF : -1;
+      case 151: return 8;
+      case 152: return dtr[0];
+      case 153:
+        if(device_type2 == 0xFF) return device_type;
+        next_dt = 1;
+        return 0xFF; //several device types
+      case 167: //QUERY NEXT DEVICE TYPE: lowest first, then 0xFE. No reply unless directly after QUERY (NEXT) DEVICE TYPE
+        if(device_type2 == 0xFF) return 0xFE;
+        if(!ndt) return -1;
+        next_dt = (ndt < 3 ? ndt + 1 : 3);
+        if(ndt == 1) return device_type < device_type2 ? device_type : device_type2;
+        if(ndt == 2) return device_type < device_type2 ? device_type2 : device_type;
+        return 0xFE;
+      case 154: return 1;
+      case 155: return power_failure ? 0xFF : -1;
+      case 156: return dtr[1];
+      case 157: return dtr[2];
+      case 160: return level;
+      case 161: return max_level;
+      case 162: return min_level;
+      case 163: return power_on_level;
+      case 164: return failure_level;
+      case 165: return fade;
+      case 169: return gear_failure ? 0xFF : -1;
+      case 192: return groups & 0xFF;
+      case 193: return groups >> 8;
+      case 194: return (randomadr >> 16) & 0xFF;
+      case 195: return (randomadr >> 8) & 0xFF;
+      case 196: return randomadr & 0xFF;
+      case 197: { //READ MEMORY LOCATION
+        uint8_t *bank = memory_bank(dtr[1]);
+        if(!bank) return -1; //bank not implemented: DTR0 does not change
+        int16_t v = (dtr[0] <= bank[0] ? bank[dtr[0]] : -1);
+        if(dtr[0] < 0xFF) dtr[0]++;
+        return v;
+      }
+    }
+    if(b >= 176 && b < 192) return scene[b & 0xF];
+    return -1;
+  }
+};
+
+class DaliSimGearBus : public DaliTransport {
+public:
+  DaliSimGear gear[DALI_SIM_GEAR_MAX];
+  uint8_t gear_cnt;
+  uint32_t now;           //bus time in ticks
+  uint32_t frames;        //forward frames sent
+  uint32_t replies;       //backward frames received
+  uint32_t collisions;    //transactions with different replies
+  uint8_t down;           //bus power failure: frames time out
+  uint8_t settle;         //idle before the next forward frame, as Dali::tx_wait()
+  uint16_t merge_us;      //identical replies starting further apart than this do not merge into one frame
+  uint16_t wrong_permille; //identical replies which do not merge: share decoded as a wrong value instead of a collision
+  uint32_t rng;
+
+  DaliSimGearBus() : gear_cnt(0), now(0), frames(0), replies(0), collisions(0), down(0), settle(DALI_SETTLE_BWD_TICKS),
+    merge_us(50), wrong_permille(3), rng(1) {}
+
+  //bus power goes down (all gear go to their system failure level) or comes back
+  void set_down(uint8_t d) {
+    if(d && !down) {
+      for(uint8_t i = 0; i < gear_cnt; i++) gear[i].bus_failure();
+    }
+    down = d;
+  }
+
+  //add gear with short address sa (0xFF: none), returns gear index
+  uint8_t add(uint8_t sa, uint8_t device_type = 6) {
+    uint8_t i = gear_cnt++;
+    gear[i].init(sa, 0x123456u * (i + 1) + 0x9E3779u * sa, device_type);
+    return i;
+  }
+
+  int16_t transact(uint8_t *data, uint8_t bitlen, uint16_t timeout_ms) {
+    if(down) {
+      now += DALI_MS_TO_TICKS(timeout_ms);
+      return -DALI_RESULT_TIMEOUT;
+    }
+    frames++;
+    now += settle + DALI_SIM_T_FORWARD(bitlen);
+    settle = 0; //the reply window passed
+    if(bitlen != 16) {
+      now += DALI_SIM_T_NO_REPLY;
+      return -DALI_RESULT_NO_REPLY;
+    }
+    int16_t rv = -1;
+    uint8_t coll = 0;
+    uint16_t us_min = 0xFFFF, us_max = 0;
+    for(uint8_t i = 0; i < gear_cnt; i++) {
+      int16_t r = gear[i].frame(data[0], data[1]);
+      if(r < 0) continue;
+      if(rv >= 0 && r != rv) coll = 1;
+      rv = r;
+      if(gear[i].reply_us < us_min) us_min = gear[i].reply_us;
+      if(gear[i].reply_us > us_max) us_max = gear[i].reply_us;
+    }
+    if(!coll && rv >= 0 && us_max - us_min > merge_us && Dali::reply_format(data, bitlen) != DALI_REPLY_YES) {
+      //the same frame at an offset: the wired-AND does not decode, or decodes to another value
+      rng = rng * 1103515245u + 12345;
+      if((rng >> 16) % 1000 < wrong_permille) rv ^= 1 << ((rng >> 8) & 7);
+      else coll = 1;
+    }
+    if(Dali::reply_format(data, bitlen) == DALI_REPLY_NONE) {
+      settle = DALI_SETTLE_FWD_TICKS; //the controller does not wait for a reply
+      return -DALI_RESULT_NO_REPLY;
+    }
+    if(rv < 0) {
+      now += DALI_SIM_T_NO_REPLY;
+      return -DALI_RESULT_NO_REPLY;
+    }
+    now += DALI_SIM_T_REPLY_GAP + DALI_SIM_T_BACKWARD;
+    settle = DALI_SETTLE_BWD_TICKS;
+    replies++;
+    if(coll) {
+      collisions++;
+      return -DALI_RESULT_COLLISION;
+    }
+    return rv;
+  }
+
+  uint32_t tick() {
+    return now;
+  }
+
+  double bus_seconds() {
+    return (double)now / DALI_TICKS_PER_SECOND;
+  }
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Synthesized bus waveforms with timing errors, for decoder benchmarks
+
+DaliWave builds the waveform of one frame in continuous time (us) from
+Dali::encode_edges(), with:
+  skew      baud rate deviation, 0.1: bits 10% longer (slow transmitter)
+  jitter    every edge moves uniformly within +-jitter_us
+  asym      bus release (rising edges) is late by asym_us, negative: early
+  glitches  glitch_per_frame inverted pulses of glitch_us at random times
+  flips     every sample reads inverted with probability flip_prob
+level_high(t) then returns the bus level at time t, t must not decrease.
+###########################################################################*/
+#ifndef DALI_SIM_WAVE_H
+#define DALI_SIM_WAVE_H
+
+#include "qqqDALI.h"
+
+#define DALI_WAVE_TE_US (1e6 / 2400) //half bit time
+
+struct DaliWave {
+  double skew;
+  double jitter_us;
+  double asym_us;
+  double glitch_per_frame;
+  double glitch_us;
+  double flip_prob;
+
+  double t_edge[DALI_TX_EDGES_MAX];
+  uint8_t n_edge;
+  double t_glitch[8];
+  uint8_t n_glitch;
+  double t_end; //end of the stop bits
+  uint8_t cursor;
+  uint32_t rng;
+
+  DaliWave() : skew(0), jitter_us(0), asym_us(0), glitch_per_frame(0), glitch_us(0), flip_prob(0), n_edge(0), n_glitch(0), t_end(0), cursor(0), rng(1) {}
+
+  double rnd() { //uniform [0,1), xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng / 4294967296.0;
+  }
+
+  void frame(const uint8_t *data, uint8_t bitlen) {
+    uint8_t e[DALI_TX_EDGES_MAX];
+    n_edge = Dali::encode_edges(data, bitlen, e);
+    double te = DALI_WAVE_TE_US * (1 + skew);
+    double prev = -1e9;
+    for(uint8_t i = 0; i < n_edge; i++) {
+      double t = e[i] * te + (2 * rnd() - 1) * jitter_us + ((i & 1) ? asym_us : 0);
+      if(t < prev + 1) t = prev + 1;
+      t_edge[i] = prev = t;
+    }
+    t_end = (2 + 2 * bitlen + 4) * te;
+    n_glitch = 0;
+    double g = glitch_per_frame;
+    while(n_glitch < 8 && rnd() < g) { //glitch_per_frame >= 1 gives at least one
+      t_glitch[n_glitch++] = rnd() * t_end;
+      g -= 1;
+    }
+    cursor = 0;
+  }
+
+  uint8_t level_high(double t) {
+    while(cursor < n_edge && t_edge[cursor] <= t) cursor++;
+    uint8_t high = !(cursor & 1); //odd number of edges passed: low
+    for(uint8_t i = 0; i < n_glitch; i++) {
+      if(t >= t_glitch[i] && t < t_glitch[i] + glitch_us) high = !high;
+    }
+    if(flip_prob > 0 && rnd() < flip_prob) high = !high;
+    return high;
+  }
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Host side formatter for DALI_TRACE entries (see qqqDALI.h TRACE)
+
+An entry is 8 bytes as the sketch sends them: tick (little endian), event
+id, argument bytes a b c. dali_trace_format() turns one entry into text,
+ticks are converted with the sender's ticks per second.
+###########################################################################*/
+#ifndef DALI_TRACE_FMT_H
+#define DALI_TRACE_FMT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define DALI_TRACE_ENTRY_BYTES 8
+
+struct dali_trace_rec {
+  uint32_t tick;
+  uint8_t id, a, b, c;
+};
+
+static inline void dali_trace_unpack(const uint8_t *p, dali_trace_rec *r) {
+  r->tick = p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+  r->id = p[4];
+  r->a = p[5];
+  r->b = p[6];
+  r->c = p[7];
+}
+
+static inline const char *dali_trace_result_name(int16_t rv) {
+  switch(-rv) {
+    case 1: return "BUS_NOT_IDLE";
+    case 2: return "FRAME_TOO_LONG";
+    case 3: return "COLLISION";
+    case 4: return "TRANSMITTING";
+    case 5: return "RECEIVING";
+    case 101: return "NO_REPLY";
+    case 102: return "TIMEOUT";
+    case 103: return "DATA_TOO_LONG";
+    case 104: return "INVALID_CMD";
+    case 105: return "INVALID_REPLY";
+  }
+  return "?";
+}
+
+//format the event of r into buf (without time), returns buf
+static inline char *dali_trace_format(const dali_trace_rec *r, char *buf, size_t size) {
+  static const char *const format[] = {"any", "yes/no", "short address"};
+  int16_t rv = (int16_t)(r->a | r->b << 8);
+  switch(r->id) {
+    case 1: snprintf(buf, size, "rx start%s", r->a ? "" : " (dropped, unread frame)"); break;
+    case 2: snprintf(buf, size, "rx end, %u runs%s", r->a, r->b ? "" : " (dropped)"); break;
+    case 3: snprintf(buf, size, "tx start, %u half bits", r->a); break;
+    case 4: snprintf(buf, size, "tx end"); break;
+    case 5: snprintf(buf, size, "tx collision at half bit %u", r->a); break;
+    case 6: snprintf(buf, size, "bus down"); break;
+    case 7: snprintf(buf, size, "bus up"); break;
+    case 8: snprintf(buf, size, "emu frame %u bits %02X %02X", r->a, r->b, r->c); break;
+    case 9: snprintf(buf, size, "emu reply, %u answers, or=%02X and=%02X%s", r->a, r->b, r->c, r->b != r->c ? " (collision)" : ""); break;
+    case 16:
+      if(r->a) snprintf(buf, size, "decode %u bits %02X (%u runs)", r->a, r->b, r->c);
+      else snprintf(buf, size, "decode error/collision (%u runs)", r->c);
+      break;
+    case 17:
+      if(r->a > 8) snprintf(buf, size, "forward %u bits %02X %02X", r->a, r->b, r->c);
+      else snprintf(buf, size, "forward %u bits %02X", r->a, r->b);
+      break;
+    case 18:
+      if(rv >= 0) snprintf(buf, size, "result %02X (%s)", rv, r->c < 3 ? format[r->c] : "?");
+      else snprintf(buf, size, "result %d %s", rv, dali_trace_result_name(rv));
+      break;
+    case 19:
+      if(r->c == 0xFF) snprintf(buf, size, "memory bank %u adr %02X: error", r->a, r->b);
+      else snprintf(buf, size, "memory bank %u adr %02X: %u bytes", r->a, r->b, r->c);
+      break;
+    case 255: snprintf(buf, size, "*** %u%s entries lost", r->a, r->a == 255 ? " or more" : ""); break;
+    default: snprintf(buf, size, "event %u %02X %02X %02X", r->id, r->a, r->b, r->c);
+  }
+  return buf;
+}
+
+#endif
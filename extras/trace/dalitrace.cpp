@@ -0,0 +1,68 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+dalitrace - print DALI_TRACE entries: time, time since the previous entry
+and the event
+
+Reads the binary entries (8 bytes each, as examples/Trace sends them) from
+a file, a serial port or stdin.
+
+Build:
+  g++ -O2 -o dalitrace dalitrace.cpp
+
+Usage:
+  dalitrace [-t ticks per second (default 9600)] [file]
+  stty -F /dev/ttyUSB0 115200 raw && dalitrace /dev/ttyUSB0
+###########################################################################*/
+#include "dali_trace_fmt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+  double tps = 9600;
+  const char *path = 0;
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-t") && i + 1 < argc) tps = atof(argv[++i]);
+    else path = argv[i];
+  }
+  FILE *f = (path ? fopen(path, "rb") : stdin);
+  if(!f) {
+    perror("dalitrace: open");
+    return 1;
+  }
+
+  uint8_t p[DALI_TRACE_ENTRY_BYTES];
+  dali_trace_rec r;
+  uint32_t prev = 0;
+  uint8_t first = 1;
+  char buf[80];
+  while(fread(p, 1, sizeof(p), f) == sizeof(p)) {
+    dali_trace_unpack(p, &r);
+    if(r.id == 255) { //no tick
+      printf("%12s %10s  %s\n", "", "", dali_trace_format(&r, buf, sizeof(buf)));
+      continue;
+    }
+    double dt = (first ? 0 : (uint32_t)(r.tick - prev) * 1000.0 / tps);
+    printf("%12.3f %+10.3f  %s\n", r.tick * 1000.0 / tps, dt, dali_trace_format(&r, buf, sizeof(buf)));
+    prev = r.tick;
+    first = 0;
+  }
+  fflush(stdout);
+  return 0;
+}
@@ -1,722 +1,1758 @@
-/*###########################################################################
-        copyright qqqlab.com / github.com/qqqlab
- 
-        This program is free software: you can redistribute it and/or modify
-        it under the terms of the GNU General Public License as published by
-        the Free Software Foundation, either version 3 of the License, or
-        (at your option) any later version.
-
-        This program is distributed in the hope that it will be useful,
-        but WITHOUT ANY WARRANTY; without even the implied warranty of
-        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-        GNU General Public License for more details.
-
-        You should have received a copy of the GNU General Public License
-        along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-----------------------------------------------------------------------------
-Changelog:
-2020-11-14 Rewrite with sampling instead of pinchange
-2020-11-10 Split off hardware specific code into separate class
-2020-11-08 Created & tested on ATMega328 @ 8Mhz
-###########################################################################*/
-
-//#define DALI_DEBUG
-
-//=================================================================
-// LOW LEVEL DRIVER
-//=================================================================
-#include "qqqDALI.h"
-
-#ifdef DALI_DEBUG
-#include "arduino.h"
-#endif
-
-//timing
-#define BEFORE_CMD_IDLE_MS 13 //require 13ms idle time before sending a cmd()
-
-//busstate
-#define IDLE 0
-#define RX 1
-#define COLLISION_RX 2
-#define TX 3
-#define COLLISION_TX 4
-
-void Dali::begin(uint8_t (*bus_is_high)(), void (*bus_set_low)(), void (*bus_set_high)())
-{
-  this->bus_is_high = bus_is_high;
-  this->bus_set_low = bus_set_low;
-  this->bus_set_high = bus_set_high;
-  _init();
-}
-
-void Dali::_set_busstate_idle() {
-  bus_set_high();
-  idlecnt = 0;
-  busstate = IDLE;
-}
-
-void Dali::_init() {
-  _set_busstate_idle();
-  rxstate = EMPTY;
-  txcollision = 0;  
-}
-
-uint16_t Dali::milli() {
-  while(ticks==0xFF); //wait for _millis update to finish
-  return _milli;
-}
-
-// timer interrupt service routine, called 9600 times per second
-void Dali::timer() {
-  //get bus sample
-  uint8_t busishigh = (bus_is_high() ? 1 : 0); //bus_high is 1 on high (non-asserted), 0 on low (asserted)
-
-  //millis update
-  ticks++;
-  if(ticks==10) {
-    ticks = 0xff; //signal _millis is updating
-    _milli++;
-    ticks = 0; 
-  }
-  
-  switch(busstate) {
-  case IDLE:
-    if(busishigh) {
-      if(idlecnt != 0xff) idlecnt++;
-      break;
-    }
-    //set busstate = RX
-    rxpos = 0;
-    rxbitcnt = 0;
-    rxidle = 0;
-    rxstate = RECEIVING;
-    busstate = RX;
-    //fall-thru to RX
-  case RX:
-    //store sample
-    rxbyte = (rxbyte << 1) | busishigh;
-    rxbitcnt++;
-    if(rxbitcnt == 8) {
-      rxdata[rxpos] = rxbyte;
-      rxpos++;
-      if(rxpos > DALI_RX_BUF_SIZE - 1) rxpos = DALI_RX_BUF_SIZE - 1;
-      rxbitcnt = 0;
-    }
-    //check for reception of 2 stop bits
-    if(busishigh) {
-      rxidle++;
-      if(rxidle >= 16) { 
-        rxdata[rxpos] = 0xFF;
-        rxpos++;
-        rxstate = COMPLETED;
-        _set_busstate_idle();
-        break;
-      }
-    }else{
-      rxidle = 0;
-    }
-    break;
-  case TX:
-    if(txhbcnt >= txhblen) {
-      //all bits transmitted, go back to IDLE
-      _set_busstate_idle();
-    }else{
-      //check for collisions (transmitting high but bus is low)      
-      if( (
-            txcollisionhandling == DALI_TX_COLLISSION_ON //handle all
-            || (txcollisionhandling == DALI_TX_COLLISSION_AUTO && txhblen != 2+8+4) //handle only if not transmitting 8 bits (2+8+4 half bits)
-          ) && (txhigh && !busishigh)  //transmitting high, but bus is low 
-          && (txspcnt==1 || txspcnt==2) ) // in middle of transmitting low period
-      {
-        if(txcollision != 0xFF) txcollision++;
-        txspcnt = 0;
-        busstate = COLLISION_TX;  
-        return;      
-      }
-    
-      //send data bits (MSB first) to bus every 4th sample time
-      if(txspcnt == 0) {
-        //send bit
-        uint8_t pos = txhbcnt >> 3;
-        uint8_t bitmask = 1 << (7 - (txhbcnt & 0x7));
-        if( txhbdata[pos] & bitmask ) {
-          bus_set_low();
-          txhigh = 0;  
-        }else{        
-          bus_set_high();
-          txhigh = 1;
-        }
-        //update half bit counter
-        txhbcnt++; 
-        //next transmit in 4 sample times
-        txspcnt = 4;
-      }
-      txspcnt--;
-    }
-    break;    
-  case COLLISION_TX:
-    //keep bus low for 16 samples = 4 TE
-    bus_set_low();
-    txspcnt++;
-    if(txspcnt >= 16) _set_busstate_idle();
-    break;  
-  }
-}
-
-//push 2 half bits into the half bit transmit buffer, MSB first, 0x0=stop, 0x1= bit value 0, 0x2= bit value 1/start
-void Dali::_tx_push_2hb(uint8_t hb) {
-  uint8_t pos = txhblen>>3;
-  uint8_t shift = 6 - (txhblen & 0x7);
-  txhbdata[pos] |= hb << shift;
-  txhblen += 2;
-}
-  
-//non-blocking transmit
-//transmit if bus is IDLE, without checking hold off times, sends start+stop bits
-uint8_t Dali::tx(uint8_t *data, uint8_t bitlen) {
-  if(bitlen > 32) return DALI_RESULT_FRAME_TOO_LONG;
-  if(busstate != IDLE) return DALI_RESULT_BUS_NOT_IDLE;
-
-  //clear data
-  for(uint8_t i=0; i<9; i++) txhbdata[i]=0;
-  
-  //push data in transmit buffer
-  txhblen = 0;
-  _tx_push_2hb(0x2); //start bit
-  //data bits MSB first
-  for(uint8_t i=0; i<bitlen; i++) {
-    uint8_t pos = i>>3;
-    uint8_t mask = 1 << (7 - (i & 0x7));
-    _tx_push_2hb( data[pos] & mask ? 0x2 : 0x1 );
-  }
-  _tx_push_2hb(0x0); //stop bit
-  _tx_push_2hb(0x0); //stop bit
-
-  //setup tx vars
-  txhbcnt = 0;
-  txspcnt = 0;
-  txcollision = 0;
-  rxstate = EMPTY;
-  busstate = TX;
-  return DALI_OK;
-}
-
-uint8_t Dali::tx_state() {
-  if(txcollision) {
-    txcollision = 0;
-    return DALI_RESULT_COLLISION;
-  }  
-  if(busstate == TX) return DALI_RESULT_TRANSMITTING;
-  return DALI_OK;
-}  
-  
-
-
-
-//-------------------------------------------------------------------
-//manchester decode
-/*
-
-Prefectly matched transmitter and sampling: 8 samples per bit        
----------+   +---+   +-------+       +-------+   +------------------------
-         |   |   |   |       |       |       |   |
-         +---+   +---+       +-------+       +---+
-sample-> 012345670123456701234567012345670123456701234567012345670
-sync->   ^       ^       ^       ^       ^       ^       ^       ^
-decode-> start   1       1       0       1       0       stop    stop
-
-
-slow transmitter: 9 samples per bit
----------+   +----+    +--------+        +--------+   +------------------------
-         |   |    |    |        |        |        |   |
-         +---+    +----+        +--------+        +---+
-sample-> 0123456780123456780123456780123456780123456780123456780123456780
-sync->   ^        ^        ^        ^        ^        ^        ^        ^
-decode-> start    1        1        0        1        0        stop     stop
-
-*/
-
-//compute weight for a 8 bit sample i
-uint8_t Dali::_man_weight(uint8_t i) {
-  int8_t w = 0;
-  w += ((i>>7) & 1) ? 1 : -1;
-  w += ((i>>6) & 1) ? 2 : -2; //put more weight in middle
-  w += ((i>>5) & 1) ? 2 : -2; //put more weight in middle
-  w += ((i>>4) & 1) ? 1 : -1;
-  w -= ((i>>3) & 1) ? 1 : -1;
-  w -= ((i>>2) & 1) ? 2 : -2; //put more weight in middle
-  w -= ((i>>1) & 1) ? 2 : -2; //put more weight in middle
-  w -= ((i>>0) & 1) ? 1 : -1;
-  //w at this point: 
-  //w = -12 perfect manchester encoded value 1 
-  //... 
-  //w =  -2 very weak value 1
-  //w =   0 unknown (all samples high or low)
-  //... 
-  //w =  12 perfect manchester encoded value 0
-
-  w *= 2;
-  if(w<0) w = -w + 1;  
-  return w;
-}       
-
-//call with bitpos <= DALI_RX_BUF_SIZE*8-8;
-uint8_t Dali::_man_sample(uint8_t *edata, uint16_t bitpos, uint8_t *stop_coll) {
-  uint8_t pos = bitpos>>3;
-  uint8_t shift = bitpos & 0x7;
-  uint8_t sample = (edata[pos] << shift) | (edata[pos+1] >> (8-shift));
-
-  //stop bit: received high (non-asserted) bus for last 8 samples
-  if(sample == 0xFF) *stop_coll = 1;
-    
-  //collision: received low (asserted) bus for last 8 samples
-  if(sample == 0x00) *stop_coll = 2;
-    
-  return sample;
-}
-
-
-//decode 8 times oversampled encoded data
-//returns bitlen of decoded data, or 0 on collision
-uint8_t Dali::_man_decode(uint8_t *edata, uint8_t ebitlen, uint8_t *ddata) {
-  uint8_t dbitlen = 0;
-  uint16_t ebitpos = 1;
-  while(ebitpos+1<ebitlen) { 
-    uint8_t stop_coll = 0;
-    //weight at nominal oversample rate
-    uint8_t sample = _man_sample(edata, ebitpos, &stop_coll);    
-    uint8_t weightmax = _man_weight(sample); //weight of maximum
-    uint8_t pmax = 8; //position of maximum
-
-    //weight at nominal oversample rate - 1
-    sample = _man_sample(edata, ebitpos - 1, &stop_coll);
-    uint8_t w = _man_weight(sample);   
-    if( weightmax < w) { //when equal keep pmax=8, the nominal oversample baud rate
-      weightmax = w;
-      pmax = 7;
-    }
-
-    //weight at nominal oversample rate + 1
-    sample = _man_sample(edata, ebitpos + 1, &stop_coll);
-    w = _man_weight(sample);    
-    if( weightmax < w ) { //when equal keep previous value
-      weightmax = w;
-      pmax = 9;
-    }
-
-    //handle stop/collision
-    if(stop_coll==1) break; //stop
-    if(stop_coll==2) return 0; //collison
-
-    //store mancheter bit
-    if(dbitlen > 0) { //ignore start bit
-      uint8_t bytepos = (dbitlen - 1) >> 3;
-      uint8_t bitpos = (dbitlen - 1) & 0x7;
-      if(bitpos == 0) ddata[bytepos] = 0; //empty data before storing first bit
-      ddata[bytepos] = (ddata[bytepos] << 1) | (weightmax & 1); //get databit from bit0 of weight
-    }
-    dbitlen++;
-    ebitpos += pmax; //jump to next mancheter bit, skipping over number of samples with max weight   
-  }
-  if(dbitlen>1) dbitlen--;
-  return dbitlen;  
-}
-
-//non-blocking receive, 
-//returns 0 empty, 1 if busy receiving, 2 decode error, >2 number of bits received
-uint8_t Dali::rx(uint8_t *ddata) {
-  switch(rxstate) {
-  case EMPTY: return 0;
-  case RECEIVING: return 1;
-  case COMPLETED: 
-    rxstate = EMPTY;   
-    uint8_t dlen = _man_decode(rxdata,rxpos*8,ddata);
-    
-
-#ifdef DALI_DEBUG
-  if(dlen!=8){
-    //print received samples
-    Serial.print("RX: len=");
-    Serial.print(rxpos*8);
-    Serial.print(" ");
-    for(uint8_t i=0;i<rxpos;i++) {
-      for(uint8_t m=0x80;m!=0x00;m>>=1) {
-        if(rxdata[i]&m) Serial.print("1"); else Serial.print("0");
-      }
-      Serial.print(" ");
-    }
-
-    //print decoded data
-    Serial.print("decoded: len=");
-    Serial.print(dlen);
-    Serial.print(" ");
-    for(uint8_t i=0;i<dlen;i++) {
-      if( ddata[i>>3] & (1 << (7 - (i & 0x7))) ) Serial.print("1"); else Serial.print("0");
-    }
-    Serial.println();   
-  }
-#endif
-    
-    if(dlen<3) return 2;
-    return dlen;
-  }
-  return 0; //should not get here
-}
-
-
-//=================================================================
-// HIGH LEVEL FUNCTIONS
-//=================================================================
-
-//blocking send - wait until successful send or timeout
-uint8_t Dali::tx_wait(uint8_t* data, uint8_t bitlen, uint16_t timeout_ms) {
-  if(bitlen>32) return DALI_RESULT_DATA_TOO_LONG;
-  uint16_t start_ms = milli();  
-  while(1) {
-    //wait for 10ms idle
-     while(idlecnt < BEFORE_CMD_IDLE_MS){
-      //Serial.print('w');
-      if(milli() - start_ms > timeout_ms) return DALI_RESULT_TIMEOUT;
-    }   
-    //try transmit
-    while(tx(data,bitlen) != DALI_OK){
-      //Serial.print('w');
-      if(milli() - start_ms > timeout_ms) return DALI_RESULT_TIMEOUT;
-    }
-    //wait for completion
-    uint8_t rv;
-    while(1) {
-      rv = tx_state();
-      if(rv != DALI_RESULT_TRANSMITTING) break;
-      if(milli() - start_ms > timeout_ms) return DALI_RESULT_TIMEOUT;
-    }
-    //exit if transmit was ok
-    if(rv == DALI_OK) return DALI_OK;
-    //not ok (for example collision) - retry until timeout
-  }
-  return DALI_RESULT_TIMEOUT;
-}
-
-//blocking transmit 2 byte command, receive 1 byte reply (if a reply was sent)
-//returns >=0 with reply byte
-//returns <0 with negative result code
-int16_t Dali::tx_wait_rx(uint8_t cmd0, uint8_t cmd1, uint16_t timeout_ms) {
-#ifdef DALI_DEBUG  
-  Serial.print("TX");
-  Serial.print(cmd0>>4,HEX);
-  Serial.print(cmd0&0xF,HEX);
-  Serial.print(cmd1>>4,HEX);
-  Serial.print(cmd1&0xF,HEX);
-  Serial.print(" ");
-#endif
-  uint8_t data[4];
-  data[0] = cmd0; 
-  data[1] = cmd1;
-  int16_t rv = tx_wait(data, 16, timeout_ms);
-  if(rv) return -rv;;
-
-  //wait up to 10 ms for start of reply, additional 15ms for receive to complete
-  uint16_t rx_start_ms = milli();
-  uint16_t rx_timeout_ms = 10;
-  while(1) {
-    rv = rx(data);
-    switch( rv ) {
-      case 0: break; //nothing received yet, wait
-      case 1: rx_timeout_ms = 25; break; //extend timeout, wait for RX completion
-      case 2: return -DALI_RESULT_COLLISION; //report collision
-      default: 
-        if(rv==8) 
-          return data[0];
-        else
-          return -DALI_RESULT_INVALID_REPLY;
-    }
-    if(milli() - rx_start_ms > rx_timeout_ms) return -DALI_RESULT_NO_REPLY;
-  }
-  return -DALI_RESULT_NO_REPLY; //should not get here
-}
-
-
-//check YAAAAAA: 0000 0000 to 0011 1111 adr, 0100 0000 to 0100 1111 group, x111 1111 broadcast
-uint8_t Dali::_check_yaaaaaa(uint8_t yaaaaaa) {
-  return (yaaaaaa<=0b01001111 || yaaaaaa==0b01111111 || yaaaaaa==0b11111111);
-}
-
-void Dali::set_level(uint8_t level, uint8_t adr) {
-  if(_check_yaaaaaa(adr)) tx_wait_rx(adr<<1,level);
-}
-
-int16_t Dali::cmd(uint16_t cmd, uint8_t arg) {
-  //Serial.print("dali_cmd[");Serial.print(cmd,HEX);Serial.print(",");Serial.print(arg,HEX);Serial.print(")");
-  uint8_t cmd0,cmd1;
-  if(cmd & 0x0100) {
-    //special commands: MUST NOT have YAAAAAAX pattern for cmd
-    //Serial.print(" SPC");
-    if(!_check_yaaaaaa(cmd>>1)) {
-      cmd0 = cmd;
-      cmd1 = arg;
-    }else{
-      return DALI_RESULT_INVALID_CMD;
-    }
-  }else{
-    //regular commands: MUST have YAAAAAA pattern for arg
-
-    //Serial.print(" REG");
-    if(_check_yaaaaaa(arg)) { 
-      cmd0 = arg<<1|1;
-      cmd1 = cmd;
-    }else{
-      return DALI_RESULT_INVALID_CMD;
-    }
-  }
-  if(cmd & 0x0200) {
-    //Serial.print(" REPEAT");
-    tx_wait_rx(cmd0, cmd1);
-  }
-  int16_t rv = tx_wait_rx(cmd0, cmd1);
-  //Serial.print(" rv=");Serial.println(rv);
-  return rv;
-}
-
-
-uint8_t Dali::set_operating_mode(uint8_t v, uint8_t adr) {
-  return _set_value(DALI_SET_OPERATING_MODE, DALI_QUERY_OPERATING_MODE, v, adr);
-}
-
-uint8_t Dali::set_max_level(uint8_t v, uint8_t adr) {
-  return _set_value(DALI_SET_MAX_LEVEL, DALI_QUERY_MAX_LEVEL, v, adr);
-}
-
-uint8_t Dali::set_min_level(uint8_t v, uint8_t adr) {
-  return _set_value(DALI_SET_MIN_LEVEL, DALI_QUERY_MIN_LEVEL, v, adr);
-}
-
-
-uint8_t Dali::set_system_failure_level(uint8_t v, uint8_t adr) {
-  return _set_value(DALI_SET_SYSTEM_FAILURE_LEVEL, DALI_QUERY_SYSTEM_FAILURE_LEVEL, v, adr);
-}
-
-uint8_t Dali::set_power_on_level(uint8_t v, uint8_t adr) {
-  return _set_value(DALI_SET_POWER_ON_LEVEL, DALI_QUERY_POWER_ON_LEVEL, v, adr);
-}
-
-//set a parameter value, returns 0 on success
-uint8_t Dali::_set_value(uint16_t setcmd, uint16_t getcmd, uint8_t v, uint8_t adr) {
-  int16_t current_v = cmd(getcmd,adr); //get current parameter value
-  if(current_v == v) return 0;
-  cmd(DALI_DATA_TRANSFER_REGISTER0,v); //store value in DTR
-  int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR0,adr); //get DTR value
-  if(dtr != v) return 1;
-  cmd(setcmd,adr); //set parameter value = DTR
-  current_v = cmd(getcmd,adr); //get current parameter value
-  if(current_v != v) return 2;
-  return 0;
-}
-
-
-
-
-//======================================================================
-// Commissioning short addresses
-//======================================================================
-
-//Sets the slave Note 1 to the INITIALISE status for15 minutes.
-//Commands 259 to 270 are enabled only for a slave in this
-//status.
-
-//set search address
-void Dali::set_searchaddr(uint32_t adr) {
-  cmd(DALI_SEARCHADDRH,adr>>16);
-  cmd(DALI_SEARCHADDRM,adr>>8);
-  cmd(DALI_SEARCHADDRL,adr);
-}
-
-//set search address, but set only changed bytes (takes less time)
-void Dali::set_searchaddr_diff(uint32_t adr_new,uint32_t adr_current) {
-  if( (uint8_t)(adr_new>>16) !=  (uint8_t)(adr_current>>16) ) cmd(DALI_SEARCHADDRH,adr_new>>16);
-  if( (uint8_t)(adr_new>>8)  !=  (uint8_t)(adr_current>>8)  ) cmd(DALI_SEARCHADDRM,adr_new>>8);
-  if( (uint8_t)(adr_new)     !=  (uint8_t)(adr_current)     ) cmd(DALI_SEARCHADDRL,adr_new);
-}
-
-//Is the random address smaller or equal to the search address?
-//as more than one device can reply, the reply gets garbled
-uint8_t Dali::compare() {
-  uint8_t retry = 2;
-  while(retry>0) {
-    //compare is true if we received any activity on the bus as reply.
-    //sometimes the reply is not registered... so only accept retry times 'no reply' as a real false compare
-    int16_t rv = cmd(DALI_COMPARE,0x00);
-    if(rv == -DALI_RESULT_COLLISION) return 1;
-    if(rv == -DALI_RESULT_INVALID_REPLY) return 1;
-    if(rv == 0xFF) return 1;
-
-    retry--;
-  }
-  return 0;
-}
-
-//The slave shall store the received 6-bit address (AAAAAA) as a short address if it is selected.
-void Dali::program_short_address(uint8_t shortadr) {
-  cmd(DALI_PROGRAM_SHORT_ADDRESS, (shortadr << 1) | 0x01);
-}
-
-//What is the short address of the slave being selected?
-uint8_t Dali::query_short_address() {
-  return cmd(DALI_QUERY_SHORT_ADDRESS, 0x00) >> 1;
-}
-
-//find addr with binary search
-uint32_t Dali::find_addr() {
-  uint32_t adr = 0x800000;
-  uint32_t addsub = 0x400000;
-  uint32_t adr_last = adr;
-  set_searchaddr(adr);
-  
-  while(addsub) {
-    set_searchaddr_diff(adr,adr_last);
-    adr_last = adr;
-    //Serial.print("cmpadr=");
-    //Serial.print(adr,HEX);
-    uint8_t cmp = compare(); //returns 1 if searchadr > adr
-    //Serial.print("cmp ");
-    //Serial.print(adr,HEX);
-    //Serial.print(" = ");
-    //Serial.println(cmp);
-    if(cmp) adr-=addsub; else adr+=addsub;
-    addsub >>= 1;
-  }
-  set_searchaddr_diff(adr,adr_last);
-  adr_last = adr;
-  if(!compare()) {
-    adr++;
-    set_searchaddr_diff(adr,adr_last);
-  }
-  return adr;
-}
-
-//init_arg=11111111 : all without short address
-//init_arg=00000000 : all 
-//init_arg=0AAAAAA1 : only for this shortadr
-//returns number of new short addresses assigned
-uint8_t Dali::commission(uint8_t init_arg) {
-  uint8_t cnt = 0;
-  uint8_t arr[64];
-  uint8_t sa;
-  for(sa=0; sa<64; sa++) arr[sa]=0;
-
-  //start commissioning
-  cmd(DALI_INITIALISE,init_arg);
-  cmd(DALI_RANDOMISE,0x00);
-  //need 100ms pause after RANDOMISE, scan takes care of this...
-
-  //find used short addresses (run always, seems to work better than without...)
-  for(sa = 0; sa<64; sa++) {
-    int16_t rv = cmd(DALI_QUERY_STATUS,sa);
-    if(rv>=0) {
-      if(init_arg!=0b00000000) arr[sa]=1; //remove address from list if not in "all" mode
-    }
-  }
-
-  //find random addresses and assign unused short addresses
-  while(1) {
-    uint32_t adr = find_addr();
-    if(adr>0xffffff) break; //no more random addresses found -> exit
-
-    //find first unused short address
-    for(sa=0; sa<64; sa++) {
-      if(arr[sa]==0) break;
-    }
-    if(sa>=64) break; //all 64 short addresses assigned -> exit
-
-    //mark short address as used
-    arr[sa] = 1;
-    cnt++;
- 
-    //assign short address
-    program_short_address(sa);
-
-    //Serial.println(query_short_address()); //TODO check read adr, handle if not the same...
-
-    //remove the device from the search
-    cmd(DALI_WITHDRAW,0x00);
-  }
-
-  //terminate the DALI_INITIALISE command
-  cmd(DALI_TERMINATE,0x00);
-  return cnt;
-}
-
-//======================================================================
-// Memory
-//======================================================================
-uint8_t Dali::set_dtr0(uint8_t value, uint8_t adr) {
-  uint8_t retry=3;
-  while(retry) {
-    cmd(DALI_DATA_TRANSFER_REGISTER0,value); //store value in DTR
-    int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR0,adr); //get DTR value
-    if(dtr == value) return 0;
-    retry--;    
-  }
-  return 1;
-}
-
-uint8_t Dali::set_dtr1(uint8_t value, uint8_t adr) {
-  uint8_t retry=3;
-  while(retry) {
-    cmd(DALI_DATA_TRANSFER_REGISTER1,value); //store value in DTR
-    int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR1,adr); //get DTR value
-    if(dtr == value) return 0;
-    retry--;    
-  }
-  return 1;
-}
-
-uint8_t Dali::set_dtr2(uint8_t value, uint8_t adr) {
-  uint8_t retry=3;
-  while(retry) {
-    cmd(DALI_DATA_TRANSFER_REGISTER2,value); //store value in DTR
-    int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR2,adr); //get DTR value
-    if(dtr == value) return 0;
-    retry--;    
-  }
-  return 1;
-}
-
-uint8_t Dali::read_memory_bank(uint8_t bank, uint8_t adr) {
-  uint16_t rv;
-
-  if(set_dtr0(0, adr)) return 1;
-  if(set_dtr1(bank, adr)) return 2;
-    
-  //uint8_t data[255];
-  uint16_t len = cmd(DALI_READ_MEMORY_LOCATION, adr);
-#ifdef DALI_DEBUG
-  Serial.print("memlen=");
-  Serial.println(len);
-  for(uint8_t i=0;i<len;i++) {
-    int16_t mem = cmd(DALI_READ_MEMORY_LOCATION, adr);
-    if(mem>=0) {
-      //data[i] = mem;
-      Serial.print(i,HEX);
-      Serial.print(":");
-      Serial.print(mem);
-      Serial.print(" 0x");
-      Serial.print(mem,HEX);
-      Serial.print(" ");
-      if(mem>=32 && mem <127) Serial.print((char)mem);   
-      Serial.println(); 
-    }else if(mem!=-DALI_RESULT_NO_REPLY) {
-      Serial.print(i,HEX);
-      Serial.print(":err=");
-      Serial.println(mem);   
-    }
-    //delay(10);
-  }
-#endif
-
-  uint16_t dtr0 = cmd(DALI_QUERY_CONTENT_DTR0,adr); //get DTR value
-  if(dtr0 != 255) return 4;
-}
-
-
-//======================================================================
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+ 
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Frame transport interface, byte stream transport
+2026-10-19 32 bit monotonic tick clock, frame timestamps
+2020-11-14 Rewrite with sampling instead of pinchange
+2020-11-10 Split off hardware specific code into separate class
+2020-11-08 Created & tested on ATMega328 @ 8Mhz
+###########################################################################*/
+
+//=================================================================
+// LOW LEVEL DRIVER
+//=================================================================
+#include "qqqDALI.h"
+
+//timing
+#define RX_REPLY_START_TICKS DALI_MS_TO_TICKS(10) //wait up to 10 ms for start of reply
+#define RX_REPLY_END_TICKS DALI_MS_TO_TICKS(25) //wait up to 25 ms for completion of reply
+#define RX_HALFBIT_TICKS (DALI_OVERSAMPLE / 2 - 1) //shortest start bit half bit (333 us) as sampled, shorter is a glitch
+
+//handoff between timer() and the main context
+//timer() owns the receive buffer while rxstate is RECEIVING, the main context while it is COMPLETED (until rx() sets
+//EMPTY). The main context owns the transmit buffer while busstate is not TX or COLLISION_TX, tx() fills it and then
+//publishes it by switching busstate IDLE->TX. busstate and rxstate are stored with release and loaded with acquire
+//ordering, so the buffer contents are visible to the new owner. Both sides leave IDLE with a compare-and-swap: when
+//timer() starts receiving at the same time as tx() starts transmitting, one of them wins.
+#if defined(__GNUC__) && !defined(__AVR__)
+//hosts and multi-core parts: timer() may run on another core or thread
+#define DALI_LOAD(v) __atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define DALI_STORE(v, x) __atomic_store_n(&(v), (x), __ATOMIC_RELAXED)
+#define DALI_LOAD_ACQUIRE(v) __atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+#define DALI_STORE_RELEASE(v, x) __atomic_store_n(&(v), (x), __ATOMIC_RELEASE)
+#define DALI_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#define DALI_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#ifndef __ARM_ARCH_6M__
+static inline uint8_t _dali_cas(volatile uint8_t *v, uint8_t expected, uint8_t desired) {
+  return __atomic_compare_exchange_n(v, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#define DALI_FETCH_OR(v, x) __atomic_fetch_or(&(v), (x), __ATOMIC_RELAXED)
+static inline uint8_t _dali_xchg(volatile uint8_t *v, uint8_t x) {
+  return __atomic_exchange_n(v, x, __ATOMIC_RELAXED);
+}
+static inline uint8_t _dali_fetch_inc(volatile uint8_t *v) {
+  return __atomic_fetch_add(v, 1, __ATOMIC_RELAXED);
+}
+#endif
+#else
+//single core: byte access is atomic, timer() is not interrupted by the main context
+#define DALI_LOAD(v) (v)
+#define DALI_STORE(v, x) ((v) = (x))
+#define DALI_LOAD_ACQUIRE(v) (v)
+#define DALI_STORE_RELEASE(v, x) ((v) = (x))
+#define DALI_FENCE_RELEASE()
+#define DALI_FENCE_ACQUIRE()
+#endif
+
+#if !defined(__GNUC__) || defined(__AVR__) || defined(__ARM_ARCH_6M__)
+//read-modify-write with interrupts disabled, the main context is not interrupted by timer() in between
+#if defined(__AVR__)
+#include <util/atomic.h>
+#define DALI_CRITICAL ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#elif defined(__ARM_ARCH_6M__)
+//Cortex-M0/M0+ (SAMD21, RP2040) have no exclusive load/store: GCC implements the __atomic read-modify-writes with
+//calls into libatomic, which is not linked. Loads, stores and fences above are native. PRIMASK is restored on leaving
+//the block, as ATOMIC_RESTORESTATE. This only excludes interrupts of the own core: on RP2040 timer() and the main
+//context run on the same core
+static inline uint32_t _dali_irq_save() {
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) : : "memory");
+  return primask;
+}
+static inline void _dali_irq_restore(const uint32_t *primask) {
+  __asm__ volatile("msr primask, %0" : : "r"(*primask) : "memory");
+}
+#define DALI_CRITICAL for(uint32_t _dali_pm __attribute__((cleanup(_dali_irq_restore))) = _dali_irq_save(), \
+  _dali_once = 1; _dali_once; _dali_once = 0)
+#else
+#define DALI_CRITICAL
+#endif
+static inline uint8_t _dali_cas(volatile uint8_t *v, uint8_t expected, uint8_t desired) {
+  uint8_t ok;
+  DALI_CRITICAL {
+    ok = (*v == expected);
+    if(ok) *v = desired;
+  }
+  return ok;
+}
+#define DALI_FETCH_OR(v, x) ((v) |= (x)) //timer() only
+static inline uint8_t _dali_xchg(volatile uint8_t *v, uint8_t x) {
+  uint8_t old;
+  DALI_CRITICAL {
+    old = *v;
+    *v = x;
+  }
+  return old;
+}
+static inline uint8_t _dali_fetch_inc(volatile uint8_t *v) {
+  uint8_t old;
+  DALI_CRITICAL {
+    old = *v;
+    *v = old + 1;
+  }
+  return old;
+}
+#endif
+
+//trace events, no code without DALI_TRACE
+#ifdef DALI_TRACE
+#define DALI_TRACE_PUT(id, tick, a, b, c) trace.put((id), (tick), (a), (b), (c))
+#else
+#define DALI_TRACE_PUT(id, tick, a, b, c)
+#endif
+
+//busstate
+#define IDLE 0
+#define RX 1
+#define COLLISION_RX 2
+#define TX 3
+#define COLLISION_TX 4
+#define BUSDOWN 5 //bus low for DALI_BUS_DOWN_MS, until it is high for DALI_BUS_UP_MS
+
+#define DALI_BUS_DOWN_TICKS DALI_MS_TO_TICKS(DALI_BUS_DOWN_MS)
+#define DALI_BUS_UP_TICKS DALI_MS_TO_TICKS(DALI_BUS_UP_MS)
+
+#ifdef DALI_TRACE
+//trace ring: a writer reserves a sequence number by incrementing head, marks the slot as being written (seq = n-1),
+//fills it and publishes it (seq = n). The reader copies the entry and checks that seq did not change meanwhile: a
+//writer which wrapped around the ring overwrote it
+void DaliTrace::put(uint8_t id, uint32_t tick, uint8_t a, uint8_t b, uint8_t c) {
+  uint8_t n = _dali_fetch_inc(&head);
+  volatile uint8_t *e = ring[n & (DALI_TRACE_SIZE - 1)];
+  DALI_STORE(seq[n & (DALI_TRACE_SIZE - 1)], (uint8_t)(n - 1));
+  DALI_FENCE_RELEASE();
+  e[0] = tick;
+  e[1] = tick >> 8;
+  e[2] = tick >> 16;
+  e[3] = tick >> 24;
+  e[4] = id;
+  e[5] = a;
+  e[6] = b;
+  e[7] = c;
+  DALI_STORE_RELEASE(seq[n & (DALI_TRACE_SIZE - 1)], n);
+}
+
+uint8_t DaliTrace::read(DaliTraceEntry *e) {
+  uint16_t skipped = 0;
+  while(1) {
+    uint8_t h = DALI_LOAD(head);
+    if((uint8_t)(h - tail) > DALI_TRACE_SIZE) {
+      //the writers went around the ring
+      skipped += (uint8_t)(h - tail) - DALI_TRACE_SIZE;
+      tail = h - DALI_TRACE_SIZE;
+    }
+    if(tail == h) break;
+    uint8_t i = tail & (DALI_TRACE_SIZE - 1);
+    uint8_t s = DALI_LOAD_ACQUIRE(seq[i]);
+    if(s == (uint8_t)(tail - DALI_TRACE_SIZE) || s == (uint8_t)(tail - 1)) break; //still being written
+    if(s == tail) {
+      if(skipped) break; //report the loss first, this entry is read next time
+      volatile uint8_t *r = ring[i];
+      e->tick = r[0] | (uint32_t)r[1] << 8 | (uint32_t)r[2] << 16 | (uint32_t)r[3] << 24;
+      e->id = r[4];
+      e->a = r[5];
+      e->b = r[6];
+      e->c = r[7];
+      DALI_FENCE_ACQUIRE();
+      if(DALI_LOAD(seq[i]) == s) {
+        tail++;
+        return 1;
+      }
+    }
+    //overwritten
+    tail++;
+    skipped++;
+  }
+  if(!skipped) return 0;
+  lost += skipped;
+  e->tick = 0;
+  e->id = DALI_EV_LOST;
+  e->a = (skipped > 255 ? 255 : skipped);
+  e->b = 0;
+  e->c = 0;
+  return 1;
+}
+#endif
+
+void Dali::begin(uint8_t (*bus_is_high)(), void (*bus_set_low)(), void (*bus_set_high)())
+{
+  this->bus_is_high = bus_is_high;
+  this->bus_set_low = bus_set_low;
+  this->bus_set_high = bus_set_high;
+  _init();
+}
+
+void Dali::_set_busstate_idle() {
+  bus_set_high();
+  DALI_STORE(idlecnt, 0);
+  DALI_STORE_RELEASE(busstate, IDLE);
+}
+
+void Dali::_init() {
+  _set_busstate_idle();
+  DALI_STORE_RELEASE(rxstate, EMPTY);
+  rxown = 0;
+  txcollision = 0;  
+  busevents = 0;
+  emupending = 0;
+  settle = DALI_SETTLE_BWD_TICKS;
+}
+
+//read a 32 bit value which is updated by timer() without blocking the ISR:
+//read twice until both reads agree, a torn read (ISR fired in between) is retried
+uint32_t Dali::_read32(volatile uint32_t *v) {
+#if defined(__GNUC__) && !defined(__AVR__)
+  return __atomic_load_n(v, __ATOMIC_RELAXED);
+#else
+  uint32_t a, b;
+  do {
+    a = *v;
+    b = *v;
+  } while(a != b);
+  return a;
+#endif
+}
+
+uint32_t Dali::tick() {
+  if(transport != this) return transport->tick();
+  return _sample_tick();
+}
+
+uint32_t Dali::_sample_tick() {
+  return _read32(&_tick);
+}
+
+uint16_t Dali::milli() {
+  return tick() / (DALI_OVERSAMPLE * 10 / 8);
+}
+
+//1 tick = 1000000/DALI_TICKS_PER_SECOND us = 625/TICKS_PER_625US us, split to prevent overflow
+#define TICKS_PER_625US (DALI_TICKS_PER_SECOND / 1600) //6
+uint32_t Dali::ticks_to_us(uint32_t ticks) {
+  return (ticks / TICKS_PER_625US) * 625 + (ticks % TICKS_PER_625US) * 625 / TICKS_PER_625US;
+}
+
+uint32_t Dali::us_to_ticks(uint32_t us) {
+  return (us / 625) * TICKS_PER_625US + (us % 625) * TICKS_PER_625US / 625;
+}
+
+uint32_t Dali::tx_start_tick() {
+  return _read32(&txstarttick);
+}
+
+uint32_t Dali::tx_end_tick() {
+  return _read32(&txendtick);
+}
+
+uint32_t Dali::rx_start_tick() {
+  return _read32(&rxstarttick);
+}
+
+uint32_t Dali::rx_end_tick() {
+  return _read32(&rxendtick);
+}
+
+uint8_t Dali::bus_events() {
+  return _dali_xchg(&busevents, 0);
+}
+
+uint8_t Dali::bus_is_down() {
+  return DALI_LOAD(busstate) == BUSDOWN;
+}
+
+uint32_t Dali::bus_down_tick() {
+  return _read32(&busdowntick);
+}
+
+uint32_t Dali::bus_up_tick() {
+  return _read32(&busuptick);
+}
+
+void Dali::emulate(DaliFrameHandler *handler, uint16_t reply_delay_us) {
+  //timer() only reads emuh and emudelay while emuon is set
+  DALI_STORE(emuon, 0);
+  emupending = 0;
+  if(!handler) return;
+  emuh = handler;
+  emudelay = us_to_ticks(reply_delay_us + 500000 / DALI_TICKS_PER_SECOND); //nearest tick
+  DALI_STORE_RELEASE(emuon, 1);
+}
+
+uint32_t Dali::emu_frame_end_tick() {
+  return _read32(&emuend);
+}
+
+uint32_t Dali::emu_latency_ticks() {
+  return _read32(&emulatency);
+}
+
+//receiver: a bus level run of len samples ended, store its length in rxdata
+void Dali::_rx_run(uint16_t len) {
+  uint8_t p = rxpos;
+  if(p >= DALI_RX_RUNS_MAX) {
+    rxpos = DALI_RX_RUNS_MAX + 1; //too many edges for a frame: decode error instead of a clipped frame
+    return;
+  }
+  uint8_t v = (len < DALI_RX_RUN_SAT ? len : DALI_RX_RUN_SAT);
+  if(p & 1) rxdata[p >> 1] |= v << 4;
+  else rxdata[p >> 1] = v;
+  rxpos = p + 1;
+}
+
+//gear emulation decoder: a bus level run of len samples ended, 1 or 2 half bits of level low (1) or high (0)
+void Dali::_emu_run(uint8_t low, uint16_t len) {
+  if(emubits == 0xFF) return;
+  uint8_t n = (2 * len <= 3 * (DALI_OVERSAMPLE / 2) ? 1 : (2 * len <= 5 * (DALI_OVERSAMPLE / 2) ? 2 : 0));
+  if(!n) {
+    emubits = 0xFF; //not a half bit or a bit: violation
+    return;
+  }
+  while(n--) {
+    if(emuhalf == 0xFF) {
+      emuhalf = low;
+      continue;
+    }
+    if(emuhalf == low || (emubits == 0 && !emuhalf) || emubits > 32) {
+      emubits = 0xFF; //no level change in the middle of the bit, start bit is not 1, or too long
+      return;
+    }
+    if(emubits) {
+      uint8_t i = emubits - 1;
+      emudata[i >> 3] = (emudata[i >> 3] << 1) | emuhalf; //bit value 1: low, then high
+    }
+    emubits++;
+    emuhalf = 0xFF;
+  }
+}
+
+//gear emulation: stop bits of a frame detected at tick t, pass it to the handler and prepare the backward frame
+void Dali::_emu_frame(uint32_t t) {
+  uint32_t end = emurise; //the last bit ends with the last rising edge (bit 0), or a half bit after it (bit 1)
+  if(emuhalf == 1) {
+    _emu_run(0, DALI_OVERSAMPLE / 2);
+    end += DALI_OVERSAMPLE / 2;
+  }
+  if(emubits == 0xFF || emuhalf != 0xFF || emubits < 9) return;
+  uint8_t bitlen = emubits - 1;
+  if(bitlen & 7) emudata[bitlen >> 3] <<= 8 - (bitlen & 7);
+  DALI_STORE(emuend, end);
+  DALI_TRACE_PUT(DALI_EV_EMU_FRAME, t, bitlen, emudata[0], emudata[1]);
+  uint8_t r_or = 0, r_and = 0xFF;
+  uint8_t n = emuh->frame(emudata, bitlen, &r_or, &r_and);
+  if(!n) return;
+  DALI_TRACE_PUT(DALI_EV_EMU_REPLY, t, n, r_or, r_and);
+  //the bus is the wired OR of the low half bits of all replies: bits where the replies differ are low for a full bit
+  uint8_t hb0[DALI_TX_HB_BYTES], hb1[DALI_TX_HB_BYTES];
+  txhblen = encode_hb(&r_or, 8, hb0);
+  encode_hb(&r_and, 8, hb1);
+  for(uint8_t i=0; i<(txhblen+7)/8; i++) txhbdata[i] = hb0[i] | hb1[i];
+  emureply = end + emudelay - 1; //the first half bit goes out on the tick after the switch to TX
+  if((int32_t)(emureply - t) <= 0) emureply = t + 1;
+  emupending = 1;
+}
+
+//bus went low at tick t in IDLE: start receiving, returns 0 (and changes nothing) if tx() just started a transmission
+uint8_t Dali::_rx_start(uint32_t t) {
+  if(!_dali_cas(&busstate, IDLE, RX)) return 0;
+  //receive into rxdata if the main context does not own it (unread frame: this frame is dropped)
+  rxown = _dali_cas(&rxstate, EMPTY, RECEIVING);
+  if(rxown) {
+    rxpos = 0;
+    DALI_STORE(rxstarttick, t);
+  }
+  DALI_TRACE_PUT(DALI_EV_RX_START, t, rxown, 0, 0);
+  rxidle = 0;
+  rxlow = 0;
+  DALI_STORE(rxhalfbit, 0);
+  emupending = 0; //a frame started before the backward frame: drop it
+  emubits = 0;
+  emuhalf = 0xFF;
+  return 1;
+}
+
+//stop bits received at tick t
+void Dali::_rx_end(uint32_t t) {
+  if(rxown) {
+    DALI_STORE(rxendtick, t);
+    DALI_STORE_RELEASE(rxstate, COMPLETED); //hand rxdata and rxpos to the main context
+  }
+  DALI_TRACE_PUT(DALI_EV_RX_END, t, rxpos, rxown, 0);
+  if(DALI_LOAD(emuon)) _emu_frame(t);
+  _set_busstate_idle();
+}
+
+//bus low for DALI_BUS_DOWN_TICKS at tick t
+void Dali::_bus_down(uint32_t t) {
+  if(rxown) DALI_STORE_RELEASE(rxstate, EMPTY); //drop the frame
+  rxown = 0;
+  DALI_STORE(busdowntick, t - DALI_BUS_DOWN_TICKS);
+  DALI_FETCH_OR(busevents, DALI_BUS_EVENT_DOWN);
+  DALI_STORE_RELEASE(busstate, BUSDOWN);
+  DALI_TRACE_PUT(DALI_EV_BUS_DOWN, t, 0, 0, 0);
+}
+
+//bus high for DALI_BUS_UP_TICKS at tick t after a bus failure
+void Dali::_bus_up(uint32_t t) {
+  DALI_STORE(busuptick, t - DALI_BUS_UP_TICKS);
+  DALI_FETCH_OR(busevents, DALI_BUS_EVENT_UP);
+  _set_busstate_idle();
+  DALI_TRACE_PUT(DALI_EV_BUS_UP, t, 0, 0, 0);
+}
+
+// timer interrupt service routine, called DALI_TICKS_PER_SECOND (9600) times per second
+void Dali::timer() {
+  //get bus sample
+  _sample(bus_is_high() ? 1 : 0); //bus_high is 1 on high (non-asserted), 0 on low (asserted)
+}
+
+//one bus sample, busishigh is 1 on high (non-asserted), 0 on low (asserted)
+void Dali::_sample(uint8_t busishigh) {
+  //clock update
+  uint32_t t = _tick + 1;
+  DALI_STORE(_tick, t);
+  
+  switch(DALI_LOAD_ACQUIRE(busstate)) {
+  case IDLE:
+    if(emupending && busishigh && (int32_t)(t - emureply) >= 0) {
+      //gear emulation: send the backward frame, txhbdata was filled by _emu_frame()
+      emupending = 0;
+      txhbcnt = 0;
+      txspcnt = 0;
+      txcollision = 0;
+      DALI_STORE(emulatency, t + 1 - emuend);
+      DALI_STORE_RELEASE(busstate, TX);
+      break;
+    }
+    if(busishigh) {
+      uint8_t i = idlecnt;
+      if(i != 0xff) DALI_STORE(idlecnt, i + 1);
+      break;
+    }
+    //set busstate = RX, unless tx() just started a transmission
+    if(!_rx_start(t)) break;
+    //fall-thru to RX
+  case RX:
+    //store the run length of the previous level on each edge, check for reception of 2 stop bits
+    if(busishigh) {
+      if(rxlow) {
+        if(rxlow >= RX_HALFBIT_TICKS) DALI_STORE(rxhalfbit, 1);
+        if(rxown) _rx_run(rxlow);
+        if(DALI_LOAD(emuon)) {
+          _emu_run(1, rxlow);
+          emurise = t;
+        }
+      }
+      rxlow = 0;
+      rxidle++;
+      if(rxidle >= 2 * DALI_OVERSAMPLE) _rx_end(t); //4 half bits
+    }else{
+      if(rxidle) {
+        if(rxown) _rx_run(rxidle);
+        if(DALI_LOAD(emuon)) _emu_run(0, rxidle);
+      }
+      rxidle = 0;
+      //a frame or collision is low for a few ms at most: longer means the bus lost power (system failure)
+      if(++rxlow >= DALI_BUS_DOWN_TICKS) _bus_down(t);
+    }
+    break;
+  case BUSDOWN:
+    if(!busishigh) {
+      rxidle = 0;
+    }else if(++rxidle >= DALI_BUS_UP_TICKS) {
+      _bus_up(t);
+    }
+    break;
+  case TX:
+    if(txhbcnt >= txhblen && txspcnt == 0) {
+      //all bits transmitted (the last stop half bit for its full time), go back to IDLE
+      DALI_STORE(txendtick, t);
+      _set_busstate_idle();
+      DALI_TRACE_PUT(DALI_EV_TX_END, t, 0, 0, 0);
+    }else{
+      //check for collisions (transmitting high but bus is low)      
+      if( (
+            txcollisionhandling == DALI_TX_COLLISSION_ON //handle all
+            || (txcollisionhandling == DALI_TX_COLLISSION_AUTO && txhblen != 2+8+4) //handle only if not transmitting 8 bits (2+8+4 half bits)
+          ) && (txhigh && !busishigh)  //transmitting high, but bus is low 
+          && txspcnt >= 1 && txspcnt <= DALI_OVERSAMPLE / 4 ) // second half of the half bit, after the bus settled
+      {
+        if(txcollision != 0xFF) txcollision++;
+        txspcnt = 0;
+        DALI_STORE(txendtick, t);
+        DALI_STORE_RELEASE(busstate, COLLISION_TX);
+        DALI_TRACE_PUT(DALI_EV_TX_COLLISION, t, txhbcnt, 0, 0);
+        return;      
+      }
+    
+      //send data bits (MSB first) to bus every DALI_OVERSAMPLE/2 sample times
+      if(txspcnt == 0) {
+        if(txhbcnt == 0) {
+          DALI_STORE(txstarttick, t);
+          DALI_TRACE_PUT(DALI_EV_TX_START, t, txhblen, 0, 0);
+        }
+        //send bit
+        uint8_t pos = txhbcnt >> 3;
+        uint8_t bitmask = 1 << (7 - (txhbcnt & 0x7));
+        if( txhbdata[pos] & bitmask ) {
+          bus_set_low();
+          txhigh = 0;  
+        }else{        
+          bus_set_high();
+          txhigh = 1;
+        }
+        //update half bit counter
+        txhbcnt++; 
+        //next transmit in DALI_OVERSAMPLE/2 sample times
+        txspcnt = DALI_OVERSAMPLE / 2;
+      }
+      txspcnt--;
+    }
+    break;    
+  case COLLISION_TX:
+    //keep bus low for 4 TE
+    bus_set_low();
+    txspcnt++;
+    if(txspcnt >= 2 * DALI_OVERSAMPLE) _set_busstate_idle();
+    break;  
+  }
+}
+
+
+//number of leading zero bits
+static inline uint8_t _clz8(uint8_t v) {
+#ifdef __GNUC__
+  return v ? __builtin_clz(v) - 8 * (sizeof(unsigned int) - 1) : 8;
+#else
+  uint8_t n = 0;
+  while(n < 8 && !(v & 0x80)) {
+    v <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+//len samples of one level, the first one at tick _tick+1. Idle, receive and bus down take the whole run at once up to
+//the sample where the state changes, transmit and a pending emulated backward frame go sample by sample. Returns the
+//number of samples consumed
+uint32_t Dali::_run(uint8_t busishigh, uint32_t len) {
+  uint32_t t = _tick + 1; //tick of the first sample
+  uint32_t c = len;
+  switch(DALI_LOAD_ACQUIRE(busstate)) {
+  case IDLE:
+    if(emupending) break;
+    if(busishigh) {
+      uint32_t i = idlecnt + len;
+      DALI_STORE(idlecnt, i < 0xff ? i : 0xff);
+      DALI_STORE(_tick, t + c - 1);
+      return c;
+    }
+    if(!_rx_start(t)) break; //tx() just started a transmission
+    //fall-thru to RX
+  case RX:
+    if(busishigh) {
+      if(rxlow) {
+        if(rxlow >= RX_HALFBIT_TICKS) DALI_STORE(rxhalfbit, 1);
+        if(rxown) _rx_run(rxlow);
+        if(DALI_LOAD(emuon)) {
+          _emu_run(1, rxlow);
+          emurise = t;
+        }
+      }
+      rxlow = 0;
+      uint8_t need = 2 * DALI_OVERSAMPLE - rxidle;
+      if(len < need) {
+        rxidle += len;
+      }else{
+        c = need;
+        rxidle = 2 * DALI_OVERSAMPLE;
+        DALI_STORE(_tick, t + c - 1);
+        _rx_end(t + c - 1);
+      }
+    }else{
+      if(rxidle) {
+        if(rxown) _rx_run(rxidle);
+        if(DALI_LOAD(emuon)) _emu_run(0, rxidle);
+      }
+      rxidle = 0;
+      uint16_t need = DALI_BUS_DOWN_TICKS - rxlow;
+      if(len < need) {
+        rxlow += len;
+      }else{
+        c = need;
+        rxlow = DALI_BUS_DOWN_TICKS;
+        DALI_STORE(_tick, t + c - 1);
+        _bus_down(t + c - 1);
+      }
+    }
+    DALI_STORE(_tick, t + c - 1);
+    return c;
+  case BUSDOWN:
+    if(!busishigh) {
+      rxidle = 0;
+    }else{
+      uint8_t need = DALI_BUS_UP_TICKS - rxidle;
+      if(len < need) {
+        rxidle += len;
+      }else{
+        c = need;
+        DALI_STORE(_tick, t + c - 1);
+        _bus_up(t + c - 1);
+      }
+    }
+    DALI_STORE(_tick, t + c - 1);
+    return c;
+  }
+  _sample(busishigh);
+  return 1;
+}
+
+//packed bus samples (see rx_samples() in qqqDALI.h), instead of timer()
+uint32_t Dali::rx_samples(const uint8_t *buf, uint32_t pos, uint32_t n) {
+  uint8_t stop = (DALI_LOAD_ACQUIRE(rxstate) != COMPLETED); //return after a frame was stored, for rx()
+  while(pos < n) {
+    uint8_t s = DALI_LOAD(busstate);
+    if(!(pos & 7) && ((s == IDLE && !emupending) || s == BUSDOWN)) {
+      //idle bus, or bus down: whole bytes of one level at once, and 4 bytes per compare
+      uint8_t v = buf[pos >> 3];
+      if(v == 0x00 || (v == 0xFF && s == BUSDOWN)) {
+        uint32_t e = pos + 8;
+        while(e + 32 <= n) {
+          const uint8_t *b = buf + (e >> 3);
+          if((b[0] ^ v) | (b[1] ^ v) | (b[2] ^ v) | (b[3] ^ v)) break;
+          e += 32;
+        }
+        while(e + 8 <= n && buf[e >> 3] == v) e += 8;
+        if(e > n) e = n;
+        pos += _run(!v, e - pos);
+        continue;
+      }
+    }
+    //one run of equal samples within the byte: 1 to 8 samples per step
+    uint8_t x = buf[pos >> 3] << (pos & 7);
+    uint8_t low = x >> 7;
+    uint8_t r = _clz8(low ? ~x : x);
+    uint8_t left = 8 - (pos & 7);
+    if(r > left) r = left;
+    if(r > n - pos) r = n - pos;
+    pos += _run(!low, r);
+    if(stop && DALI_LOAD(rxstate) == COMPLETED) break;
+  }
+  return pos;
+}
+
+//manchester code of a nibble, MSB first: bit value 1 -> half bits 10 (low, high), bit value 0 -> 01 (high, low)
+static const uint8_t _man_nibble[16] = {
+  0x55, 0x56, 0x59, 0x5A, 0x65, 0x66, 0x69, 0x6A, 0x95, 0x96, 0x99, 0x9A, 0xA5, 0xA6, 0xA9, 0xAA
+};
+
+//encode frame as half bit stream: start bit (10), data bits, 2 stop bits (0000)
+uint8_t Dali::encode_hb(const uint8_t *data, uint8_t bitlen, uint8_t *hb) {
+  uint16_t acc = 0x2; //start bit
+  uint8_t accbits = 2;
+  uint8_t pos = 0;
+  for(uint8_t i=0; i<bitlen; i+=4) {
+    acc = (acc << 8) | _man_nibble[(i & 4 ? data[i>>3] : data[i>>3] >> 4) & 0xF];
+    accbits += 8;
+    if(bitlen - i < 4) {
+      //partial last nibble: drop the half bits after the last data bit
+      uint8_t drop = 2 * (4 - (bitlen - i));
+      acc >>= drop;
+      accbits -= drop;
+    }
+    while(accbits >= 8) {
+      accbits -= 8;
+      hb[pos++] = acc >> accbits;
+    }
+  }
+  //stop bits
+  acc <<= 4;
+  accbits += 4;
+  while(accbits >= 8) {
+    accbits -= 8;
+    hb[pos++] = acc >> accbits;
+  }
+  if(accbits) hb[pos] = acc << (8 - accbits);
+  return 2 + 2 * bitlen + 4;
+}
+
+//encode frame as bus level changes: the half bits where the half bit stream changes value
+uint8_t Dali::encode_edges(const uint8_t *data, uint8_t bitlen, uint8_t *edges) {
+  uint8_t hb[DALI_TX_HB_BYTES];
+  uint8_t hblen = encode_hb(data, bitlen, hb);
+  uint8_t n = 0;
+  uint8_t prev = 0; //bus released before the frame
+  for(uint8_t i=0; i<hblen; i+=8) {
+    uint8_t b = hb[i>>3];
+    uint8_t c = b ^ ((b >> 1) | (prev << 7)); //bit set: half bit differs from the one before
+    prev = b & 1;
+    for(uint8_t j=i; c; j++, c<<=1) {
+      edges[n] = j; //branch free: keep the entry only if the bit is set
+      n += c >> 7;
+    }
+  }
+  return n;
+}
+
+uint8_t Dali::hb_collision(const uint8_t *hbtx, const uint8_t *hbrx, uint8_t hblen) {
+  for(uint8_t i=0; i<hblen; i+=8) {
+    uint8_t c = ~hbtx[i>>3] & hbrx[i>>3]; //released, but bus low
+    if(hblen - i < 8) c &= 0xFF << (8 - (hblen - i));
+    if(c) {
+      uint8_t j = i;
+      while(!(c & 0x80)) {
+        c <<= 1;
+        j++;
+      }
+      return j;
+    }
+  }
+  return 0xFF;
+}
+
+//non-blocking transmit
+//transmit if bus is IDLE, without checking hold off times, sends start+stop bits
+uint8_t Dali::tx(uint8_t *data, uint8_t bitlen) {
+  if(bitlen > 32) return DALI_RESULT_FRAME_TOO_LONG;
+  if(DALI_LOAD(emuon)) return DALI_RESULT_BUS_NOT_IDLE; //gear emulation owns the transmitter
+  //from IDLE timer() can only go to RX, which does not touch the transmit buffer
+  if(DALI_LOAD_ACQUIRE(busstate) != IDLE) return DALI_RESULT_BUS_NOT_IDLE;
+
+  //fill the transmit buffer, timer() only reads it after busstate changed to TX
+  uint8_t hb[DALI_TX_HB_BYTES];
+  uint8_t hblen = encode_hb(data, bitlen, hb);
+  for(uint8_t i=0; i<(hblen+7)/8; i++) txhbdata[i] = hb[i];
+  txhblen = hblen;
+
+  //setup tx vars
+  txhbcnt = 0;
+  txspcnt = 0;
+  txcollision = 0;
+
+  //publish, fails if timer() started receiving in the mean time
+  if(!_dali_cas(&busstate, IDLE, TX)) return DALI_RESULT_BUS_NOT_IDLE;
+  //timer() does not touch rxstate during TX, drop a received frame which was not read
+  DALI_STORE_RELEASE(rxstate, EMPTY);
+  return DALI_OK;
+}
+
+uint8_t Dali::tx_state() {
+  //timer() only changes txcollision in TX, and leaves TX with a release store
+  if(DALI_LOAD_ACQUIRE(busstate) == TX) return DALI_RESULT_TRANSMITTING;
+  if(txcollision) {
+    txcollision = 0;
+    return DALI_RESULT_COLLISION;
+  }  
+  return DALI_OK;
+}  
+  
+
+
+
+//-------------------------------------------------------------------
+//clock recovering manchester decode (DALI_DECODER_TRACK)
+/*
+The samples are converted to a list of edges (bus level changes). Every edge gets a half bit position: the falling
+edge of the start bit is 0, its rising edge 1. Data bit k has half bits 2+2k and 3+2k, with an edge in the middle
+(odd position). After an edge at a bit boundary (even position) the next edge is the next mid bit edge. After a mid
+bit edge it is either at the next bit boundary (same bit value follows, then the mid bit edge follows) or at the next
+mid bit (other bit value follows): the choice with the smaller squared distance of this and the next edge to their
+predicted times is taken.
+
+The prediction follows the transmitter clock: edge time = phase + position * half bit time, least squares fitted to
+all edges decoded so far. Rising edges have their own phase, so a late or early bus release (asymmetric rise/fall)
+does not move the decisions; until there are enough rising edges the asymmetry is assumed to be 0. Averaging over the
+edges recovers the half bit time to a fraction of a sample. Decoding stops with an error
+on an edge more than 5/8 half bit off its prediction (collision, noise), or when the half bit time is off by more 
+than 25%. A pulse of 1 sample is ignored, a pulse of 2 samples is dropped when the edges after it fit better
+without it (glitch).
+*/
+#define DEC_T(samples) ((int32_t)(samples) * 1024) //times in 1/1024 samples
+#define DEC_TE_NOM DEC_T(DALI_OVERSAMPLE / 2)     //nominal half bit time
+#define DEC_BITS_MAX 32
+#define DEC_EDGES_MAX DALI_TX_EDGES_MAX
+#define DEC_LOOKAHEAD 2   //edges after the decision that are included in its cost
+#define DEC_TE_WEIGHT 8   //weight (in half bits squared) of te_prior in the half bit time fit
+#define DEC_ASYM_WEIGHT 2 //weight (in edges) of the assumption that rise and fall are symmetric
+#define DEC_GLITCH 2       //longest pulse (samples) which may be dropped as glitch, the shortest half bit is more than 2 samples
+#define DEC_ERR_RETRY 24  //largest edge error in 1/64 half bit above which rx() tries other clock guesses
+
+//run length of rxdata entry k
+static inline uint8_t _dec_run(const uint8_t *runs, uint8_t k) {
+  return (k & 1 ? runs[k >> 1] >> 4 : runs[k >> 1] & 0x0F);
+}
+
+#ifdef DALI_DECODER_TRACK
+
+//edge list of the received run lengths: sample index of the edges, edges[0] is the falling edge of the start bit at
+//sample 0, the bus is high after the last run
+//filter: ignore pulses of a single sample (the shortest half bit is more than 2 samples)
+//returns the number of edges, 0 if more than DEC_EDGES_MAX
+uint8_t Dali::_man_edges(const uint8_t *runs, uint8_t nrun, uint16_t *edges, uint8_t filter) {
+  if(nrun > DALI_RX_RUNS_MAX || !(nrun & 1)) return 0; //too many runs, or the bus does not end high
+  uint8_t n = 1;
+  uint16_t t = 0;
+  edges[0] = 0;
+  for(uint8_t k = 0; k < nrun; k++) {
+    t += _dec_run(runs, k);
+    if(filter && k + 1 < nrun && _dec_run(runs, k + 1) == 1) {
+      //the next level lasts a single sample: the level continues
+      t++;
+      k++;
+      continue;
+    }
+    if(n >= DEC_EDGES_MAX) return 0;
+    edges[n++] = t;
+  }
+  return n;
+}
+
+//least squares fit of the edge times: falling edges at c + p*te, rising edges at c + a + p*te
+struct DaliDecFit {
+  uint8_t n[2];    //number of edges [0]: falling, [1]: rising
+  uint16_t sp[2];  //sum of positions
+  uint32_t spp[2]; //sum of positions squared
+  uint16_t st[2];  //sum of times (samples)
+  int32_t stp[2];  //sum of position*time
+  int32_t sxx[2];  //sum of (p-mean)^2, in 1/8
+  int32_t sxy[2];  //sum of (p-mean)*(t-mean), in 1/8 samples
+  int32_t te_prior, te, c, a; //times in 1/1024 samples
+
+  void begin(int32_t te_prior) {
+    for(uint8_t g = 0; g < 2; g++) {
+      n[g] = sp[g] = spp[g] = st[g] = stp[g] = sxx[g] = sxy[g] = 0;
+    }
+    n[0] = 1; //start bit falling edge at position 0, time 0
+    this->te_prior = te = te_prior;
+    c = a = 0;
+  }
+
+  int32_t pred(uint8_t rising, uint8_t p) {
+    return c + (rising ? a : 0) + te * p;
+  }
+
+  //add edge, refit. The half bit time is fitted per polarity, pulled towards te_prior
+  void add(uint8_t rising, uint8_t p, uint16_t t) {
+    uint8_t g = rising;
+    n[g]++;
+    sp[g] += p;
+    spp[g] += p * p;
+    st[g] += t;
+    stp[g] += (int32_t)p * t;
+    sxx[g] = ((int32_t)n[g] * spp[g] - (int32_t)sp[g] * sp[g]) * 8 / n[g];
+    sxy[g] = ((int32_t)n[g] * stp[g] - (int32_t)sp[g] * st[g]) * 8 / n[g];
+    te = (DEC_T(sxy[0] + sxy[1]) + 8 * DEC_TE_WEIGHT * te_prior) / (sxx[0] + sxx[1] + 8 * DEC_TE_WEIGHT);
+    int32_t r0 = DEC_T(st[0]) - te * sp[0];
+    int32_t r1 = DEC_T(st[1]) - te * sp[1];
+    c = (r0 * (n[1] + DEC_ASYM_WEIGHT) + r1 * DEC_ASYM_WEIGHT) / (n[0] * n[1] + (n[0] + n[1]) * DEC_ASYM_WEIGHT);
+    a = (r1 - n[1] * c) / (n[1] + DEC_ASYM_WEIGHT);
+  }
+};
+
+static uint32_t _dec_sq(int32_t err) {
+  if(err < 0) err = -err;
+  if(err > DEC_T(16)) err = DEC_T(16);
+  return (uint32_t)err * err;
+}
+
+//smallest sum of squared errors of edges k..k+depth-1, with the edge before k at position p
+static uint32_t _dec_cost(DaliDecFit &fit, const uint16_t *edges, uint8_t ne, uint8_t k, uint8_t p, uint8_t depth) {
+  if(depth == 0 || k >= ne) return 0;
+  uint8_t rising = k & 1;
+  int32_t t = DEC_T(edges[k]);
+  uint32_t c1 = _dec_sq(t - fit.pred(rising, p + 1)) + _dec_cost(fit, edges, ne, k + 1, p + 1, depth - 1);
+  if(!(p & 1)) return c1; //after a bit boundary the next edge is mid bit
+  uint32_t c2 = _dec_sq(t - fit.pred(rising, p + 2)) + _dec_cost(fit, edges, ne, k + 1, p + 2, depth - 1);
+  return (c1 < c2 ? c1 : c2);
+}
+
+//decode edge list
+//te_prior: expected half bit time in 1/1024 samples, errmax: returns the largest edge error in 1/64 half bit
+//returns bitlen of decoded data, or 0 on collision/timing error
+uint8_t Dali::_man_decode_track(const uint16_t *edges, uint8_t ne, uint8_t *ddata, int32_t te_prior, uint8_t *errmax) {
+  DaliDecFit fit;
+  fit.begin(te_prior);
+  uint8_t p = 0; //half bit position of the last edge
+  uint8_t bitlen = 0;
+  *errmax = 0;
+  for(uint8_t k = 1; k < ne; k++) {
+    uint8_t rising = k & 1;
+    int32_t t = DEC_T(edges[k]);
+    uint8_t pn = p + 1;
+    if(p & 1) {
+      //after a mid bit edge: bit boundary or mid bit, whichever fits this and the next edges better
+      uint32_t cost1 = _dec_sq(t - fit.pred(rising, p + 1)) + _dec_cost(fit, edges, ne, k + 1, p + 1, DEC_LOOKAHEAD);
+      uint32_t cost2 = _dec_sq(t - fit.pred(rising, p + 2)) + _dec_cost(fit, edges, ne, k + 1, p + 2, DEC_LOOKAHEAD);
+      if(cost2 < cost1) pn++;
+    }
+    int32_t err = t - fit.pred(rising, pn);
+    if(err < 0) err = -err;
+    if(k + 1 < ne && edges[k + 1] - edges[k] <= DEC_GLITCH) {
+      //short pulse: drop it (glitch) if the edges after it fit better without it, at the end of the frame if it does not fit
+      uint32_t keep = _dec_sq(err) + _dec_cost(fit, edges, ne, k + 1, pn, DEC_LOOKAHEAD);
+      uint32_t drop = _dec_cost(fit, edges, ne, k + 2, p, DEC_LOOKAHEAD);
+      if(drop < keep && (k + 2 < ne || 8 * err > 5 * fit.te)) {
+        k++;
+        continue;
+      }
+    }
+    if(8 * err > 5 * fit.te) return 0;
+    if(64 * err > *errmax * fit.te) *errmax = 64 * err / fit.te;
+
+    //half bits before this edge have the previous level, bit value = level of the second half bit
+    for(uint8_t q = p; q < pn; q++) {
+      if((q & 1) && q >= 3) {
+        if(bitlen >= DEC_BITS_MAX) return 0;
+        if((bitlen & 7) == 0) ddata[bitlen >> 3] = 0;
+        ddata[bitlen >> 3] |= rising ? 0 : 1 << (7 - (bitlen & 7));
+        bitlen++;
+      }
+    }
+    fit.add(rising, pn, edges[k]);
+    if(4 * fit.te < 3 * DEC_TE_NOM || 4 * fit.te > 5 * DEC_TE_NOM) return 0;
+    p = pn;
+  }
+  //the last edge is rising, in the middle of a bit: the bit ends high
+  if(p < 3) return 0;
+  if(p & 1) {
+    if(bitlen >= DEC_BITS_MAX) return 0;
+    if((bitlen & 7) == 0) ddata[bitlen >> 3] = 0;
+    ddata[bitlen >> 3] |= 1 << (7 - (bitlen & 7));
+    bitlen++;
+  }
+  return bitlen;
+}
+#endif //DALI_DECODER_TRACK
+
+#ifdef DALI_DECODER_FIXED
+#define DEC_FIXED_BYTES 48 //samples of the longest frame: 32 bits of a transmitter 20% slow
+//-------------------------------------------------------------------
+//manchester decode, fixed step (DALI_DECODER_FIXED)
+/*
+
+Prefectly matched transmitter and sampling: 8 samples per bit        
+---------+   +---+   +-------+       +-------+   +------------------------
+         |   |   |   |       |       |       |   |
+         +---+   +---+       +-------+       +---+
+sample-> 012345670123456701234567012345670123456701234567012345670
+sync->   ^       ^       ^       ^       ^       ^       ^       ^
+decode-> start   1       1       0       1       0       stop    stop
+
+
+slow transmitter: 9 samples per bit
+---------+   +----+    +--------+        +--------+   +------------------------
+         |   |    |    |        |        |        |   |
+         +---+    +----+        +--------+        +---+
+sample-> 0123456780123456780123456780123456780123456780123456780123456780
+sync->   ^        ^        ^        ^        ^        ^        ^        ^
+decode-> start    1        1        0        1        0        stop     stop
+
+*/
+
+//run lengths to samples (MSB first, 1: high) for the fixed step decoder, followed by the high stop bits. The samples
+//are cut off at (size-1)*8, the last byte is padding for _man_sample()
+//returns number of samples
+uint16_t Dali::_man_samples(const uint8_t *runs, uint8_t nrun, uint8_t *edata, uint8_t size) {
+  if(nrun > DALI_RX_RUNS_MAX) return 0;
+  for(uint8_t i = 0; i < size; i++) edata[i] = 0xFF;
+  uint16_t max = (size - 1) * 8;
+  uint16_t t = 0;
+  for(uint8_t k = 0; k < nrun; k++) {
+    uint8_t r = _dec_run(runs, k);
+    if(!(k & 1)) {
+      for(uint16_t i = t; i < t + r && i < max; i++) edata[i >> 3] &= ~(0x80 >> (i & 7));
+    }
+    t += r;
+  }
+  t += 2 * DALI_OVERSAMPLE; //stop bits
+  return (t < max ? t : max);
+}
+
+//compute weight for a 8 bit sample i
+uint8_t Dali::_man_weight(uint8_t i) {
+  int8_t w = 0;
+  w += ((i>>7) & 1) ? 1 : -1;
+  w += ((i>>6) & 1) ? 2 : -2; //put more weight in middle
+  w += ((i>>5) & 1) ? 2 : -2; //put more weight in middle
+  w += ((i>>4) & 1) ? 1 : -1;
+  w -= ((i>>3) & 1) ? 1 : -1;
+  w -= ((i>>2) & 1) ? 2 : -2; //put more weight in middle
+  w -= ((i>>1) & 1) ? 2 : -2; //put more weight in middle
+  w -= ((i>>0) & 1) ? 1 : -1;
+  //w at this point: 
+  //w = -12 perfect manchester encoded value 1 
+  //... 
+  //w =  -2 very weak value 1
+  //w =   0 unknown (all samples high or low)
+  //... 
+  //w =  12 perfect manchester encoded value 0
+
+  w *= 2;
+  if(w<0) w = -w + 1;  
+  return w;
+}       
+
+//call with bitpos <= DEC_FIXED_BYTES*8-16;
+uint8_t Dali::_man_sample(uint8_t *edata, uint16_t bitpos, uint8_t *stop_coll) {
+  uint8_t pos = bitpos>>3;
+  uint8_t shift = bitpos & 0x7;
+  uint8_t sample = (edata[pos] << shift) | (edata[pos+1] >> (8-shift));
+
+  //stop bit: received high (non-asserted) bus for last 8 samples
+  if(sample == 0xFF) *stop_coll = 1;
+    
+  //collision: received low (asserted) bus for last 8 samples
+  if(sample == 0x00) *stop_coll = 2;
+    
+  return sample;
+}
+
+
+//decode 8 times oversampled encoded data
+//returns bitlen of decoded data, or 0 on collision
+uint8_t Dali::_man_decode(uint8_t *edata, uint16_t ebitlen, uint8_t *ddata) {
+  uint8_t dbitlen = 0;
+  uint16_t ebitpos = 1;
+  while(ebitpos+1<ebitlen) { 
+    uint8_t stop_coll = 0;
+    //weight at nominal oversample rate
+    uint8_t sample = _man_sample(edata, ebitpos, &stop_coll);    
+    uint8_t weightmax = _man_weight(sample); //weight of maximum
+    uint8_t pmax = 8; //position of maximum
+
+    //weight at nominal oversample rate - 1
+    sample = _man_sample(edata, ebitpos - 1, &stop_coll);
+    uint8_t w = _man_weight(sample);   
+    if( weightmax < w) { //when equal keep pmax=8, the nominal oversample baud rate
+      weightmax = w;
+      pmax = 7;
+    }
+
+    //weight at nominal oversample rate + 1
+    sample = _man_sample(edata, ebitpos + 1, &stop_coll);
+    w = _man_weight(sample);    
+    if( weightmax < w ) { //when equal keep previous value
+      weightmax = w;
+      pmax = 9;
+    }
+
+    //handle stop/collision
+    if(stop_coll==1) break; //stop
+    if(stop_coll==2) return 0; //collison
+
+    //store mancheter bit
+    if(dbitlen > DALI_RX_BITS_MAX) return 0; //too long
+    if(dbitlen > 0) { //ignore start bit
+      uint8_t bytepos = (dbitlen - 1) >> 3;
+      uint8_t bitpos = (dbitlen - 1) & 0x7;
+      if(bitpos == 0) ddata[bytepos] = 0; //empty data before storing first bit
+      ddata[bytepos] = (ddata[bytepos] << 1) | (weightmax & 1); //get databit from bit0 of weight
+    }
+    dbitlen++;
+    ebitpos += pmax; //jump to next mancheter bit, skipping over number of samples with max weight   
+  }
+  if(dbitlen>1) dbitlen--;
+  return dbitlen;  
+}
+#endif
+
+//non-blocking receive, 
+//returns 0 empty, 1 if busy receiving, 2 decode error, >2 number of bits received
+uint8_t Dali::rx(uint8_t *ddata) {
+  switch(DALI_LOAD_ACQUIRE(rxstate)) {
+  case EMPTY: return 0;
+  case RECEIVING: return 1;
+  case COMPLETED: 
+    //the main context owns rxdata and rxpos until rxstate is set to EMPTY after decoding
+#ifdef DALI_DECODER_FIXED
+    uint8_t edata[DEC_FIXED_BYTES];
+    uint16_t elen = _man_samples((uint8_t*)rxdata,rxpos,edata,DEC_FIXED_BYTES);
+    uint8_t dlen = _man_decode(edata,elen,ddata);
+#else
+    uint16_t edges[DEC_EDGES_MAX];
+    uint8_t ne = _man_edges((uint8_t*)rxdata,rxpos,edges,1);
+    uint8_t errmax;
+    uint8_t dlen = _man_decode_track(edges,ne,ddata,DEC_TE_NOM,&errmax);
+    if(!dlen || errmax > DEC_ERR_RETRY) {
+      //the first decisions are taken before the clock is known: if edges are far off their prediction, 
+      //decode again assuming faster and slower transmitters, and keep the best fit
+      static const int32_t te_alt[4] = {DEC_TE_NOM * 10 / 11, DEC_TE_NOM * 11 / 10, DEC_TE_NOM * 5 / 6, DEC_TE_NOM * 6 / 5};
+      for(uint8_t k = 0; k < 4; k++) {
+        uint8_t d[DEC_BITS_MAX / 8], e;
+        uint8_t len = _man_decode_track(edges,ne,d,te_alt[k],&e);
+        if(len && (!dlen || e < errmax)) {
+          for(uint8_t i = 0; i < (len + 7) / 8; i++) ddata[i] = d[i];
+          dlen = len;
+          errmax = e;
+        }
+      }
+    }
+    if(!dlen) {
+      //a glitch which splits a half bit in single samples: decode without the single sample filter
+      ne = _man_edges((uint8_t*)rxdata,rxpos,edges,0);
+      dlen = _man_decode_track(edges,ne,ddata,DEC_TE_NOM,&errmax);
+    }
+#endif
+
+    DALI_TRACE_PUT(DALI_EV_RX_DECODE, tick(), dlen, dlen ? ddata[0] : 0, rxpos);
+    DALI_STORE_RELEASE(rxstate, EMPTY);
+    
+    if(dlen<3) return 2;
+    return dlen;
+  }
+  return 0; //should not get here
+}
+
+
+//=================================================================
+// HIGH LEVEL FUNCTIONS
+//=================================================================
+
+//blocking send - wait until successful send or timeout
+uint8_t Dali::tx_wait(uint8_t* data, uint8_t bitlen, uint16_t timeout_ms) {
+  if(bitlen>32) return DALI_RESULT_DATA_TOO_LONG;
+  uint32_t start_tick = tick();
+  uint32_t timeout_ticks = us_to_ticks((uint32_t)timeout_ms * 1000);
+  while(1) {
+    //wait for the settling time and transmit, a frame on the bus in between (for example the rest of a backward frame
+    //transact() returned early on) restarts the settling time
+    while(DALI_LOAD(idlecnt) < settle || tx(data,bitlen) != DALI_OK){
+      if(wait_hook) wait_hook();
+      //Serial.print('w');
+      if(tick() - start_tick > timeout_ticks) return DALI_RESULT_TIMEOUT;
+    }
+    //wait for completion
+    uint8_t rv;
+    while(1) {
+      if(wait_hook) wait_hook();
+      rv = tx_state();
+      if(rv != DALI_RESULT_TRANSMITTING) break;
+      if(tick() - start_tick > timeout_ticks) return DALI_RESULT_TIMEOUT;
+    }
+    //exit if transmit was ok, a backward frame or the reply window follows
+    if(rv == DALI_OK) {
+      settle = DALI_SETTLE_BWD_TICKS;
+      return DALI_OK;
+    }
+    //not ok (for example collision) - retry until timeout
+  }
+  return DALI_RESULT_TIMEOUT;
+}
+
+//blocking transmit 2 byte command, receive 1 byte reply (if a reply was sent)
+//returns >=0 with reply byte
+//returns <0 with negative result code
+int16_t Dali::tx_wait_rx(uint8_t cmd0, uint8_t cmd1, uint16_t timeout_ms) {
+  uint8_t data[2];
+  data[0] = cmd0; 
+  data[1] = cmd1;
+  return transport->transact(data, 16, timeout_ms);
+}
+
+//run the high level functions over another frame transport
+void Dali::begin(DaliTransport *transport) {
+  this->transport = transport;
+}
+
+//sample engine frame transport: blocking transmit, then receive 1 byte reply (if a reply was sent)
+//returns >=0 with reply byte
+//returns <0 with negative result code
+int16_t Dali::transact(uint8_t *data, uint8_t bitlen, uint16_t timeout_ms) {
+  uint8_t format = reply_format(data, bitlen);
+  DALI_TRACE_PUT(DALI_EV_FORWARD, tick(), bitlen, data[0], bitlen > 8 ? data[1] : 0);
+  int16_t rv = tx_wait(data, bitlen, timeout_ms);
+  if(rv) {
+    rv = -rv;
+  }else if(format == DALI_REPLY_NONE) {
+    //no gear answers: the next forward frame may follow after the settling time, without waiting out the reply window
+    settle = DALI_SETTLE_FWD_TICKS;
+    rv = -DALI_RESULT_NO_REPLY;
+  }else{
+    rv = _rx_reply(format);
+  }
+  DALI_TRACE_PUT(DALI_EV_RESULT, tick(), rv, rv >> 8, format);
+  return rv;
+}
+
+//wait for the backward frame after a forward frame was sent, format: DALI_REPLY_xxx
+//returns >=0 with reply byte, <0 with negative result code
+int16_t Dali::_rx_reply(uint8_t format) {
+  //wait up to 10 ms after the forward frame for start of reply, additional 15ms for receive to complete
+  int16_t rv;
+  uint8_t rxdata[8]; //decoded frame, max 32 bits (DALI_RX_BITS_MAX bits with DALI_DECODER_FIXED)
+  uint32_t rx_start_tick = tx_end_tick();
+  uint32_t rx_timeout_ticks = RX_REPLY_START_TICKS;
+  while(1) {
+    if(wait_hook) wait_hook();
+    rv = rx(rxdata);
+    //any activity is YES: return once the bus was low for a start bit half bit, without waiting for the frame and
+    //decoding it. A glitch is not a reply: a frame of glitches only is dropped and the reply window runs on. The rest
+    //of the backward frame is dropped, tx_wait() waits for its end before the next forward frame
+    if(rv >= 1 && format == DALI_REPLY_YES) {
+      if(DALI_LOAD(rxhalfbit)) return 0xFF;
+      if(rv >= 2) rv = 0;
+    }
+    switch( rv ) {
+      case 0: break; //nothing received yet, wait
+      case 1: rx_timeout_ticks = RX_REPLY_END_TICKS; break; //extend timeout, wait for RX completion
+      case 2: return -DALI_RESULT_COLLISION; //report collision
+      default: 
+        if(rv==8) 
+          return rxdata[0];
+        else
+          return -DALI_RESULT_INVALID_REPLY;
+    }
+    if(tick() - rx_start_tick >= rx_timeout_ticks) return -DALI_RESULT_NO_REPLY; //the reply window closed
+  }
+  return -DALI_RESULT_NO_REPLY; //should not get here
+}
+
+
+//reply format of the backward frame to a forward frame, DALI_REPLY_NONE if gear do not answer it
+//same rules as DaliCommand<CMD>::reply (qqqDALI_cmd.h): application extended commands follow IEC62386-207
+uint8_t Dali::reply_format(const uint8_t *data, uint8_t bitlen) {
+  if(bitlen != 16) return DALI_REPLY_ANY; //control device commands (24 bit) are not classified
+  uint8_t a = data[0];
+  uint8_t b = data[1];
+  if(a >= 0xA1 && a <= 0xCB && (a & 1)) {
+    //special commands
+    if(a == (DALI_COMPARE & 0xFF) || a == (DALI_VERIFY_SHORT_ADDRESS & 0xFF)) return DALI_REPLY_YES;
+    if(a == (DALI_WRITE_MEMORY_LOCATION & 0xFF)) return DALI_REPLY_ANY;
+    return DALI_REPLY_NONE;
+  }
+  if(!(a & 1)) return DALI_REPLY_NONE; //DAPC
+  if(b < DALI_QUERY_STATUS || (b >= DALI_REFERENCE_SYSTEM_POWER && b < DALI_QUERY_GEAR_TYPE)) return DALI_REPLY_NONE; //commands
+  switch(b) {
+    case DALI_QUERY_CONTROL_GEAR_PRESENT:
+    case DALI_QUERY_LAMP_FAILURE:
+    case DALI_QUERY_LAMP_POWER_ON:
+    case DALI_QUERY_LIMIT_ERROR:
+    case DALI_QUERY_RESET_STATE:
+    case DALI_QUERY_MISSING_SHORT_ADDRESS:
+    case DALI_QUERY_POWER_FAILURE:
+    case DALI_QUERY_CONTROL_GEAR_FAILURE:
+      return DALI_REPLY_YES;
+  }
+  return DALI_REPLY_ANY;
+}
+
+//check YAAAAAA: 0000 0000 to 0011 1111 adr, 0100 0000 to 0100 1111 group, x111 1111 broadcast
+uint8_t Dali::_check_yaaaaaa(uint8_t yaaaaaa) {
+  return (yaaaaaa<=0b01001111 || yaaaaaa==0b01111111 || yaaaaaa==0b11111111);
+}
+
+void Dali::set_level(uint8_t level, uint8_t adr) {
+  if(_check_yaaaaaa(adr)) tx_wait_rx(adr<<1,level);
+}
+
+int16_t Dali::cmd(uint16_t cmd, uint8_t arg) {
+  //Serial.print("dali_cmd[");Serial.print(cmd,HEX);Serial.print(",");Serial.print(arg,HEX);Serial.print(")");
+  uint8_t cmd0,cmd1;
+  if(cmd & 0x0100) {
+    //special commands: MUST NOT have YAAAAAAX pattern for cmd
+    //Serial.print(" SPC");
+    if(!_check_yaaaaaa(cmd>>1)) {
+      cmd0 = cmd;
+      cmd1 = arg;
+    }else{
+      return -DALI_RESULT_INVALID_CMD;
+    }
+  }else{
+    //regular commands: MUST have YAAAAAA pattern for arg
+
+    //Serial.print(" REG");
+    if(_check_yaaaaaa(arg)) { 
+      cmd0 = arg<<1|1;
+      cmd1 = cmd;
+    }else{
+      return -DALI_RESULT_INVALID_CMD;
+    }
+  }
+  _dtr_track(cmd, arg);
+  if(cmd & 0x0200) {
+    //Serial.print(" REPEAT");
+    tx_wait_rx(cmd0, cmd1);
+  }
+  int16_t rv = tx_wait_rx(cmd0, cmd1);
+  //Serial.print(" rv=");Serial.println(rv);
+  return rv;
+}
+
+
+uint8_t Dali::set_operating_mode(uint8_t v, uint8_t adr) {
+  return _set_value(DALI_SET_OPERATING_MODE, DALI_QUERY_OPERATING_MODE, v, adr);
+}
+
+uint8_t Dali::set_max_level(uint8_t v, uint8_t adr) {
+  return _set_value(DALI_SET_MAX_LEVEL, DALI_QUERY_MAX_LEVEL, v, adr);
+}
+
+uint8_t Dali::set_min_level(uint8_t v, uint8_t adr) {
+  return _set_value(DALI_SET_MIN_LEVEL, DALI_QUERY_MIN_LEVEL, v, adr);
+}
+
+
+uint8_t Dali::set_system_failure_level(uint8_t v, uint8_t adr) {
+  return _set_value(DALI_SET_SYSTEM_FAILURE_LEVEL, DALI_QUERY_SYSTEM_FAILURE_LEVEL, v, adr);
+}
+
+uint8_t Dali::set_power_on_level(uint8_t v, uint8_t adr) {
+  return _set_value(DALI_SET_POWER_ON_LEVEL, DALI_QUERY_POWER_ON_LEVEL, v, adr);
+}
+
+//set a parameter value, returns 0 on success
+uint8_t Dali::_set_value(uint16_t setcmd, uint16_t getcmd, uint8_t v, uint8_t adr) {
+  int16_t current_v = cmd(getcmd,adr); //get current parameter value
+  if(current_v == v) return 0;
+  cmd(DALI_DATA_TRANSFER_REGISTER0,v); //store value in DTR
+  int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR0,adr); //get DTR value
+  if(dtr != v) return 1;
+  cmd(setcmd,adr); //set parameter value = DTR
+  current_v = cmd(getcmd,adr); //get current parameter value
+  if(current_v != v) return 2;
+  return 0;
+}
+
+
+
+
+//======================================================================
+// Byte stream transport
+//======================================================================
+void DaliStreamTransport::begin(int16_t (*read_byte)(), void (*write_bytes)(const uint8_t *data, uint8_t len), uint32_t (*micros)()) {
+  this->read_byte = read_byte;
+  this->write_bytes = write_bytes;
+  this->micros = micros;
+  lastus = micros();
+  while(read_byte() >= 0); //flush stale input
+}
+
+//accumulate micros() into ticks, handles micros() rollover
+uint32_t DaliStreamTransport::tick() {
+  uint32_t us = micros();
+  usacc += us - lastus;
+  lastus = us;
+  uint32_t t = Dali::us_to_ticks(usacc);
+  ticks += t;
+  usacc -= Dali::ticks_to_us(t);
+  return ticks;
+}
+
+int16_t DaliStreamTransport::transact(uint8_t *data, uint8_t bitlen, uint16_t timeout_ms) {
+  if(bitlen > 32) return -DALI_RESULT_DATA_TOO_LONG;
+  uint8_t buf[3+4];
+  uint8_t len = (bitlen + 7) >> 3;
+  seq++;
+  buf[0] = DALI_STREAM_SYNC_REQ;
+  buf[1] = seq;
+  buf[2] = bitlen;
+  for(uint8_t i=0; i<len; i++) buf[3+i] = data[i];
+  write_bytes(buf, 3+len);
+
+  //receive DALI_STREAM_SYNC_REP, seq, status, data - skip replies to older requests
+  uint32_t start_tick = tick();
+  uint32_t timeout_ticks = Dali::us_to_ticks((uint32_t)timeout_ms * 1000);
+  uint8_t pos = 0;
+  while(1) {
+    int16_t c = read_byte();
+    if(c < 0) {
+      if(tick() - start_tick > timeout_ticks) return -DALI_RESULT_TIMEOUT;
+      continue;
+    }
+    if(pos == 0 && c != DALI_STREAM_SYNC_REP) continue;
+    buf[pos++] = c;
+    if(pos == 2 && buf[1] != seq) pos = 0;
+    if(pos < 4) continue;
+    switch(buf[2]) {
+      case DALI_STREAM_REPLY: return buf[3];
+      case DALI_STREAM_NO_REPLY: return -DALI_RESULT_NO_REPLY;
+      case DALI_STREAM_COLLISION: return -DALI_RESULT_COLLISION;
+      case DALI_STREAM_INVALID_REPLY: return -DALI_RESULT_INVALID_REPLY;
+    }
+    return -DALI_RESULT_BUS_NOT_IDLE;
+  }
+}
+
+//adapter side: build the 4 byte reply for request seq from a transact() result, returns reply length
+uint8_t DaliStreamTransport::build_reply(uint8_t seq, int16_t rv, uint8_t *buf) {
+  buf[0] = DALI_STREAM_SYNC_REP;
+  buf[1] = seq;
+  buf[3] = 0;
+  if(rv >= 0) {
+    buf[2] = DALI_STREAM_REPLY;
+    buf[3] = rv;
+  }else if(rv == -DALI_RESULT_NO_REPLY) {
+    buf[2] = DALI_STREAM_NO_REPLY;
+  }else if(rv == -DALI_RESULT_COLLISION) {
+    buf[2] = DALI_STREAM_COLLISION;
+  }else if(rv == -DALI_RESULT_INVALID_REPLY) {
+    buf[2] = DALI_STREAM_INVALID_REPLY;
+  }else{
+    buf[2] = DALI_STREAM_BUS_ERROR;
+  }
+  return 4;
+}
+
+
+//======================================================================
+// Commissioning short addresses
+//======================================================================
+
+//Sets the slave Note 1 to the INITIALISE status for15 minutes.
+//Commands 259 to 270 are enabled only for a slave in this
+//status.
+
+//set search address
+void Dali::set_searchaddr(uint32_t adr) {
+  send_special<DALI_SEARCHADDRH>(adr>>16);
+  send_special<DALI_SEARCHADDRM>(adr>>8);
+  send_special<DALI_SEARCHADDRL>(adr);
+}
+
+//set search address, but set only changed bytes (takes less time)
+void Dali::set_searchaddr_diff(uint32_t adr_new,uint32_t adr_current) {
+  if( (uint8_t)(adr_new>>16) !=  (uint8_t)(adr_current>>16) ) send_special<DALI_SEARCHADDRH>(adr_new>>16);
+  if( (uint8_t)(adr_new>>8)  !=  (uint8_t)(adr_current>>8)  ) send_special<DALI_SEARCHADDRM>(adr_new>>8);
+  if( (uint8_t)(adr_new)     !=  (uint8_t)(adr_current)     ) send_special<DALI_SEARCHADDRL>(adr_new);
+}
+
+//Is the random address smaller or equal to the search address?
+//as more than one device can reply, the reply gets garbled
+uint8_t Dali::compare() {
+  compare_cnt++;
+  for(uint8_t i = 0; ; i++) {
+    //compare is true if we received any activity on the bus as reply (transact() returns after the start bit half bit).
+    //sometimes the reply is not registered... so only accept compare_retry+1 times 'no reply' as a real false compare
+    int16_t rv = send_special<DALI_COMPARE>(0x00);
+    if(rv >= 0 || rv == -DALI_RESULT_COLLISION || rv == -DALI_RESULT_INVALID_REPLY) {
+      if(i) compare_retry_yes++;
+      return 1;
+    }
+    if(i >= compare_retry) return 0;
+    compare_retries++;
+  }
+}
+
+//The slave shall store the received 6-bit address (AAAAAA) as a short address if it is selected.
+void Dali::program_short_address(uint8_t shortadr) {
+  send_special<DALI_PROGRAM_SHORT_ADDRESS>((shortadr << 1) | 0x01);
+}
+
+//What is the short address of the slave being selected?
+uint8_t Dali::query_short_address() {
+  return send_special<DALI_QUERY_SHORT_ADDRESS>(0x00) >> 1;
+}
+
+//find addr with binary search, returns 0x1000000 if no gear is left in the search
+uint32_t Dali::find_addr() {
+  uint32_t adr = 0x800000;
+  uint32_t addsub = 0x400000;
+  uint32_t adr_last = 0xFFFFFF;
+  set_searchaddr(adr_last);
+  if(!compare()) return 0x1000000; //no gear left: one compare instead of a full search
+  
+  while(addsub) {
+    set_searchaddr_diff(adr,adr_last);
+    adr_last = adr;
+    //Serial.print("cmpadr=");
+    //Serial.print(adr,HEX);
+    uint8_t cmp = compare(); //returns 1 if searchadr > adr
+    //Serial.print("cmp ");
+    //Serial.print(adr,HEX);
+    //Serial.print(" = ");
+    //Serial.println(cmp);
+    if(cmp) adr-=addsub; else adr+=addsub;
+    addsub >>= 1;
+  }
+  set_searchaddr_diff(adr,adr_last);
+  adr_last = adr;
+  if(!compare()) {
+    adr++;
+    set_searchaddr_diff(adr,adr_last);
+  }
+  return adr;
+}
+
+//init_arg=11111111 : all without short address
+//init_arg=00000000 : all 
+//init_arg=0AAAAAA1 : only for this shortadr
+//returns number of new short addresses assigned
+uint8_t Dali::commission(uint8_t init_arg) {
+  uint8_t cnt = 0;
+  uint8_t miss = 0;
+  uint8_t arr[64];
+  uint8_t sa;
+  for(sa=0; sa<64; sa++) arr[sa]=0;
+
+  //start commissioning
+  cmd(DALI_INITIALISE,init_arg);
+  cmd(DALI_RANDOMISE,0x00);
+  //need 100ms pause after RANDOMISE, scan takes care of this...
+
+  //find used short addresses (run always, seems to work better than without...)
+  for(sa = 0; sa<64; sa++) {
+    int16_t rv = cmd(DALI_QUERY_STATUS,sa);
+    if(rv>=0) {
+      if(init_arg!=0b00000000) arr[sa]=1; //remove address from list if not in "all" mode
+    }
+  }
+
+  //find random addresses and assign unused short addresses
+  while(1) {
+    uint32_t adr = find_addr();
+    if(adr>0xffffff) break; //no more random addresses found -> exit
+
+    //find first unused short address
+    for(sa=0; sa<64; sa++) {
+      if(arr[sa]==0) break;
+    }
+    if(sa>=64) break; //all 64 short addresses assigned -> exit
+
+    //assign short address and check it: after a missed COMPARE reply the search ends above the random address of
+    //the gear, no gear is selected and the short address stays free, the gear is found again by the next search
+    program_short_address(sa);
+    if(cmd(DALI_VERIFY_SHORT_ADDRESS,(sa << 1) | 0x01) != 0xFF) {
+      if(++miss >= 8) break; //gear which do not take a short address: give up instead of searching forever
+      continue;
+    }
+
+    //mark short address as used
+    arr[sa] = 1;
+    cnt++;
+
+    //remove the device from the search
+    cmd(DALI_WITHDRAW,0x00);
+  }
+
+  //terminate the DALI_INITIALISE command
+  cmd(DALI_TERMINATE,0x00);
+  return cnt;
+}
+
+//add new gear: only gear without short address are initialised and randomised, the short addresses are taken from
+//the free bits of *used (bit n = short address n in use) and each assignment is checked with VERIFY SHORT ADDRESS.
+//*used is updated with the new short addresses.
+//returns number of new short addresses assigned
+uint8_t Dali::commission_new(uint64_t *used) {
+  //start commissioning, gear with a short address keep their random address
+  cmd(DALI_INITIALISE,0xFF);
+  _randomise();
+  uint8_t cnt = _assign_found(used);
+
+  //terminate the DALI_INITIALISE command
+  cmd(DALI_TERMINATE,0x00);
+  return cnt;
+}
+
+//find short addresses with more than one gear: QUERY RANDOM ADDRESS (H, and L if H got a clean reply) collides or
+//gets an invalid reply. Gear with the same random address (for example never randomised: 0xFFFFFF) are not found.
+//*used is set to the short addresses with gear
+//returns the duplicate short addresses (bit n = short address n)
+uint64_t Dali::scan_duplicate_addr(uint64_t *used) {
+  uint64_t dup = 0;
+  *used = 0;
+  for(uint8_t sa = 0; sa<64; sa++) {
+    int16_t rv = cmd(DALI_QUERY_RANDOM_ADDRESS_H,sa);
+    if(rv >= 0) rv = cmd(DALI_QUERY_RANDOM_ADDRESS_L,sa);
+    if(rv == -DALI_RESULT_NO_REPLY) continue;
+    *used |= (uint64_t)1 << sa;
+    if(rv == -DALI_RESULT_COLLISION || rv == -DALI_RESULT_INVALID_REPLY) dup |= (uint64_t)1 << sa;
+  }
+  return dup;
+}
+
+//give all but one of the gear with short address sa a free short address from *used: only these gear are
+//initialised (INITIALISE 0AAAAAA1) and randomised, the first one found keeps sa. *used is updated
+//returns number of gear which got a new short address
+uint8_t Dali::repair_duplicate_addr(uint8_t sa, uint64_t *used) {
+  uint8_t cnt = 0;
+  *used |= (uint64_t)1 << sa;
+  cmd(DALI_INITIALISE,(sa << 1) | 0x01);
+  _randomise();
+  if(find_addr() <= 0xffffff) {
+    cmd(DALI_WITHDRAW,0x00); //keeps sa
+    cnt = _assign_found(used);
+  }
+  cmd(DALI_TERMINATE,0x00);
+  return cnt;
+}
+
+//RANDOMISE the gear in the INITIALISE state, and wait until they have their random address
+void Dali::_randomise() {
+  cmd(DALI_RANDOMISE,0x00);
+  uint32_t t = tick(); //the random address is ready 100ms after RANDOMISE
+  while(tick() - t < DALI_MS_TO_TICKS(100)) {
+    if(wait_hook) wait_hook();
+  }
+}
+
+//search the gear in the INITIALISE state and give each one the first free short address of *used, checked with
+//VERIFY SHORT ADDRESS. *used is updated
+//returns number of short addresses assigned
+uint8_t Dali::_assign_found(uint64_t *used) {
+  uint8_t cnt = 0;
+  uint8_t sa = 0;
+  while(1) {
+    uint32_t adr = find_addr();
+    if(adr>0xffffff) break; //no more random addresses found -> exit
+
+    //find first unused short address
+    while(sa<64 && ((*used >> sa) & 1)) sa++;
+    if(sa>=64) break; //all 64 short addresses assigned -> exit
+
+    //assign short address and check it, the gear still in the search do not have this short address
+    uint8_t retry = 2;
+    while(retry) {
+      program_short_address(sa);
+      if(cmd(DALI_VERIFY_SHORT_ADDRESS,(sa << 1) | 0x01) == 0xFF) break;
+      retry--;
+    }
+    *used |= (uint64_t)1 << sa; //also when it did not verify: the gear may have taken it
+    if(retry) cnt++;
+
+    //remove the device from the search
+    cmd(DALI_WITHDRAW,0x00);
+  }
+  return cnt;
+}
+
+//======================================================================
+// Memory
+//======================================================================
+uint8_t Dali::set_dtr0(uint8_t value, uint8_t adr) {
+  uint8_t retry=3;
+  while(retry) {
+    cmd(DALI_DATA_TRANSFER_REGISTER0,value); //store value in DTR
+    int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR0,adr); //get DTR value
+    if(dtr == value) return 0;
+    retry--;    
+  }
+  return 1;
+}
+
+uint8_t Dali::set_dtr1(uint8_t value, uint8_t adr) {
+  uint8_t retry=3;
+  while(retry) {
+    cmd(DALI_DATA_TRANSFER_REGISTER1,value); //store value in DTR
+    int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR1,adr); //get DTR value
+    if(dtr == value) return 0;
+    retry--;    
+  }
+  return 1;
+}
+
+uint8_t Dali::set_dtr2(uint8_t value, uint8_t adr) {
+  uint8_t retry=3;
+  while(retry) {
+    cmd(DALI_DATA_TRANSFER_REGISTER2,value); //store value in DTR
+    int16_t dtr = cmd(DALI_QUERY_CONTENT_DTR2,adr); //get DTR value
+    if(dtr == value) return 0;
+    retry--;    
+  }
+  return 1;
+}
+
+//keep track of the DTR contents, DTR loads are broadcast so all gear hold the same value, 
+//unless a command changed the DTR of some of the gear
+void Dali::_dtr_track(uint16_t cmd, uint8_t arg) {
+  switch(cmd) {
+    case DALI_DATA_TRANSFER_REGISTER0: dtrval[0] = arg; dtrvalid |= 1; dtrseq++; return;
+    case DALI_DATA_TRANSFER_REGISTER1: dtrval[1] = arg; dtrvalid |= 2; dtrseq++; return;
+    case DALI_DATA_TRANSFER_REGISTER2: dtrval[2] = arg; dtrvalid |= 4; dtrseq++; return;
+    case DALI_READ_MEMORY_LOCATION: //increments DTR0 of the addressed gear
+    case DALI_WRITE_MEMORY_LOCATION:
+    case DALI_WRITE_MEMORY_LOCATION_NO_REPLY:
+    case DALI_STORE_ACTUAL_LEVEL_IN_THE_DTR0:
+      dtrvalid &= ~1;
+      dtrseq++;
+      return;
+  }
+  //device type specific queries and stores (for example DT8 QUERY COLOUR VALUE) can return data in DTRs
+  if(!(cmd & 0x0100) && (cmd & 0xFF) >= 240) {
+    dtrvalid = 0;
+    dtrseq++;
+  }
+}
+
+void Dali::dtr_invalidate() {
+  dtrvalid = 0;
+  dtrseq++;
+}
+
+uint8_t Dali::dtr_seq() {
+  return dtrseq;
+}
+
+uint8_t Dali::set_dtr_diff(uint8_t dtr, uint8_t value) {
+  static const uint16_t dtrcmd[3] = {DALI_DATA_TRANSFER_REGISTER0, DALI_DATA_TRANSFER_REGISTER1, DALI_DATA_TRANSFER_REGISTER2};
+  if(dtr > 2) return 0;
+  if((dtrvalid & (1 << dtr)) && dtrval[dtr] == value) return 0;
+  cmd(dtrcmd[dtr], value);
+  return 1;
+}
+
+int16_t Dali::dtr_known(uint8_t dtr) {
+  if(dtr > 2 || !(dtrvalid & (1 << dtr))) return -1;
+  return dtrval[dtr];
+}
+
+//read len memory locations from the current DTR0 of the gear on, DTR0 of the gear increments with every read,
+//returns number of bytes read (stops at the first location without reply) or negative DALI_RESULT_xxx
+int16_t Dali::read_memory_next(uint8_t adr, uint8_t *data, uint8_t len) {
+  uint8_t n = 0;
+  while(n < len) {
+    int16_t rv = cmd(DALI_READ_MEMORY_LOCATION, adr);
+    if(rv == -DALI_RESULT_NO_REPLY) break;
+    if(rv < 0) return rv;
+    data[n++] = rv;
+  }
+  return n;
+}
+
+int16_t Dali::read_memory(uint8_t adr, uint8_t bank, uint8_t loc, uint8_t *data, uint8_t len) {
+  set_dtr_diff(1, bank);
+  set_dtr_diff(0, loc);
+  return read_memory_next(adr, data, len);
+}
+
+int16_t Dali::read_memory_bank(uint8_t bank, uint8_t adr, uint8_t *data, uint16_t size) {
+  if(size == 0) return 0;
+  //location 0 holds the last accessible location, continue from there without loading DTR0 again
+  int16_t rv = read_memory(adr, bank, 0, data, 1);
+  if(rv <= 0) return (rv == 0 ? -DALI_RESULT_NO_REPLY : rv);
+  uint16_t len = (uint16_t)data[0] + 1;
+  if(len > size) len = size;
+  rv = read_memory_next(adr, data + 1, len - 1);
+  DALI_TRACE_PUT(DALI_EV_MEMORY, tick(), bank, adr, rv < 0 ? 0xFF : rv + 1);
+  if(rv < 0) return rv;
+  len = rv + 1;
+  return len;
+}
+
+
+//======================================================================
@@ -0,0 +1,197 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Typed commands (included by qqqDALI.h, needs C++11)
+
+The command is a template argument (any DALI_xxx command define), its
+traits (special, send twice, reply, DTR use) are derived at compile time.
+Addresses have their own types, so the forward frame is encoded at compile
+time and sending needs no validation:
+
+  dali.send<DALI_QUERY_STATUS>(DaliShort<3>());        //frame 0x07 0x90
+  dali.send<DALI_OFF>(DaliGroup<2>());
+  dali.send<DALI_SET_MAX_LEVEL>(DaliBroadcast(), 200); //loads DTR0 (if needed), sends twice
+  dali.send<DALI_QUERY_ACTUAL_LEVEL>(DaliShortAdr(i)); //short address known at runtime
+  dali.send_special<DALI_SEARCHADDRH>(0x12);
+  dali.dapc(DaliGroup<0>(), 254);
+
+These fail to compile:
+
+  dali.send<DALI_COMPARE>(DaliBroadcast());  //special command has no address
+  dali.send<DALI_SET_MAX_LEVEL>(DaliShort<1>()); //command uses DTR0, value missing
+  dali.send<DALI_OFF>(DaliShort<1>(), 5);    //command does not use DTR0
+  dali.send<DALI_OFF>(3);                    //not an address type
+  DaliShort<64>()                            //out of range
+  DaliShortAdr(64)                           //out of range constant (GCC)
+
+A DaliShortAdr or DaliGroupAdr out of range at runtime is an invalid
+address: send() and dapc() return -DALI_RESULT_INVALID_CMD, as cmd() does.
+
+Return value as cmd(): reply byte, or negative DALI_RESULT_xxx. Commands
+without reply return DALI_OK when no reply was received.
+
+Application extended commands (224-255) follow the IEC62386-207 (DT6) set in
+qqqDALI.h: 224-236 are commands, 237-255 are queries.
+###########################################################################*/
+#ifndef qqqDALI_cmd_h
+#define qqqDALI_cmd_h
+
+//-------------------------------------------------
+//ADDRESS TYPES
+//all address types have value() which returns the 7 bit YAAAAAA address as used by cmd(), and valid()
+template<uint8_t N> struct DaliShort {
+  static_assert(N < 64, "short address is 0..63");
+  constexpr uint8_t value() const { return N; }
+  constexpr bool valid() const { return true; }
+};
+
+template<uint8_t G> struct DaliGroup {
+  static_assert(G < 16, "group is 0..15");
+  constexpr uint8_t value() const { return 64 + G; }
+  constexpr bool valid() const { return true; }
+};
+
+struct DaliBroadcast {
+  constexpr uint8_t value() const { return 0x7F; }
+  constexpr bool valid() const { return true; }
+};
+
+//short address or group known at runtime: out of range is DALI_ADR_INVALID instead of wrapping to another gear. A
+//constant out of range does not compile: in a constant expression, and with GCC when the call is inlined
+#define DALI_ADR_INVALID 0xFF //not a YAAAAAA address
+#ifdef __GNUC__
+uint8_t _dali_adr_out_of_range() __attribute__((error("short address is 0..63, group is 0..15")));
+#define DALI_ADR_OUT_OF_RANGE(n) (__builtin_constant_p(n) ? _dali_adr_out_of_range() : DALI_ADR_INVALID)
+#else
+#define DALI_ADR_OUT_OF_RANGE(n) DALI_ADR_INVALID
+#endif
+
+struct DaliShortAdr {
+  explicit constexpr DaliShortAdr(int n) : v(n >= 0 && n < 64 ? n : DALI_ADR_OUT_OF_RANGE(n)) {}
+  constexpr uint8_t value() const { return v; }
+  constexpr bool valid() const { return v != DALI_ADR_INVALID; }
+  uint8_t v;
+};
+
+struct DaliGroupAdr {
+  explicit constexpr DaliGroupAdr(int g) : v(g >= 0 && g < 16 ? 64 + g : DALI_ADR_OUT_OF_RANGE(g)) {}
+  constexpr uint8_t value() const { return v; }
+  constexpr bool valid() const { return v != DALI_ADR_INVALID; }
+  uint8_t v;
+};
+
+template<class A> struct DaliIsAddress { static constexpr bool value = false; };
+template<uint8_t N> struct DaliIsAddress< DaliShort<N> > { static constexpr bool value = true; };
+template<uint8_t G> struct DaliIsAddress< DaliGroup<G> > { static constexpr bool value = true; };
+template<> struct DaliIsAddress<DaliBroadcast> { static constexpr bool value = true; };
+template<> struct DaliIsAddress<DaliShortAdr> { static constexpr bool value = true; };
+template<> struct DaliIsAddress<DaliGroupAdr> { static constexpr bool value = true; };
+
+//-------------------------------------------------
+//COMMAND TRAITS
+template<uint16_t CMD> struct DaliCommand {
+  static constexpr uint8_t opcode = CMD & 0xFF;
+  static constexpr bool special = (CMD & 0x0100) != 0;
+  static constexpr bool twice = (CMD & 0x0200) != 0;
+
+  //gear send a backward frame
+  static constexpr bool reply = special
+    ? (CMD == DALI_COMPARE || CMD == DALI_VERIFY_SHORT_ADDRESS || CMD == DALI_QUERY_SHORT_ADDRESS || CMD == DALI_WRITE_MEMORY_LOCATION)
+    : (opcode >= 144 && !(opcode >= 224 && opcode < 237));
+
+  //DTRs read by the command (bit n: DTRn)
+  static constexpr uint8_t dtr_in = special
+    ? ((CMD == DALI_WRITE_MEMORY_LOCATION || CMD == DALI_WRITE_MEMORY_LOCATION_NO_REPLY) ? 3 : 0)
+    : ((opcode >= 42 && opcode <= 48) || (opcode >= 64 && opcode <= 79) || opcode == 35 || opcode == 36
+      || opcode == 128 || opcode == 227 || opcode == 228) ? 1
+    : (opcode == 197 ? 3 : 0);
+
+  //DTRs changed by the command, the DTR shadow of these is invalidated (same rules as cmd())
+  static constexpr uint8_t dtr_out = special
+    ? ((CMD == DALI_WRITE_MEMORY_LOCATION || CMD == DALI_WRITE_MEMORY_LOCATION_NO_REPLY) ? 1 : 0)
+    : ((opcode == 33 || opcode == 197) ? 1 : (opcode >= 240 ? 7 : 0));
+
+  //DTR load: the data byte is the new DTR content
+  static constexpr int8_t dtr_load = CMD == DALI_DATA_TRANSFER_REGISTER0 ? 0
+    : CMD == DALI_DATA_TRANSFER_REGISTER1 ? 1
+    : CMD == DALI_DATA_TRANSFER_REGISTER2 ? 2 : -1;
+};
+
+//pre-encoded forward frame of an addressed command
+template<uint16_t CMD, class A> struct DaliFrame {
+  static_assert(DaliIsAddress<A>::value, "not a DALI address type");
+  static constexpr uint16_t value(A adr) { return (uint16_t)((adr.value() << 1) | 1) << 8 | DaliCommand<CMD>::opcode; }
+};
+
+//-------------------------------------------------
+//Dali member templates
+template<uint16_t CMD, class A> inline int16_t Dali::send(A adr) {
+  typedef DaliCommand<CMD> C;
+  static_assert(DaliIsAddress<A>::value, "adr must be DaliShort<n>, DaliGroup<n>, DaliBroadcast, DaliShortAdr or DaliGroupAdr");
+  static_assert(!C::special, "special command: use send_special<CMD>(data)");
+  static_assert(!(C::dtr_in & 1) || (C::dtr_in & 2), "command uses DTR0: use send<CMD>(adr, value)");
+  if(!adr.valid()) return -DALI_RESULT_INVALID_CMD;
+  const uint16_t f = DaliFrame<CMD, A>::value(adr);
+  if(C::dtr_out) {
+    dtrvalid &= ~C::dtr_out;
+    dtrseq++;
+  }
+  if(C::twice) tx_wait_rx(f >> 8, f & 0xFF);
+  int16_t rv = tx_wait_rx(f >> 8, f & 0xFF);
+  if(!C::reply && rv == -DALI_RESULT_NO_REPLY) return DALI_OK;
+  return rv;
+}
+
+template<uint16_t CMD, class A> inline int16_t Dali::send(A adr, uint8_t dtr0) {
+  static_assert(DaliCommand<CMD>::dtr_in == 1, "command does not use DTR0 (only): use send<CMD>(adr)");
+  if(!adr.valid()) return -DALI_RESULT_INVALID_CMD;
+  set_dtr_diff(0, dtr0);
+  typedef DaliCommand<CMD> C;
+  const uint16_t f = DaliFrame<CMD, A>::value(adr);
+  if(C::twice) tx_wait_rx(f >> 8, f & 0xFF);
+  int16_t rv = tx_wait_rx(f >> 8, f & 0xFF);
+  if(!C::reply && rv == -DALI_RESULT_NO_REPLY) return DALI_OK;
+  return rv;
+}
+
+template<uint16_t CMD> inline int16_t Dali::send_special(uint8_t data) {
+  typedef DaliCommand<CMD> C;
+  static_assert(C::special, "addressed command: use send<CMD>(adr)");
+  if(C::dtr_load >= 0) {
+    dtrval[C::dtr_load] = data;
+    dtrvalid |= 1 << C::dtr_load;
+    dtrseq++;
+  }
+  if(C::dtr_out) {
+    dtrvalid &= ~C::dtr_out;
+    dtrseq++;
+  }
+  if(C::twice) tx_wait_rx(C::opcode, data);
+  int16_t rv = tx_wait_rx(C::opcode, data);
+  if(!C::reply && rv == -DALI_RESULT_NO_REPLY) return DALI_OK;
+  return rv;
+}
+
+template<class A> inline int16_t Dali::dapc(A adr, uint8_t level) {
+  static_assert(DaliIsAddress<A>::value, "adr must be DaliShort<n>, DaliGroup<n>, DaliBroadcast, DaliShortAdr or DaliGroupAdr");
+  if(!adr.valid()) return -DALI_RESULT_INVALID_CMD;
+  int16_t rv = tx_wait_rx(adr.value() << 1, level);
+  if(rv == -DALI_RESULT_NO_REPLY) return DALI_OK;
+  return rv;
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_daylight.h"
+#include <math.h>
+
+void DaliDaylight::begin(Dali *dali) {
+  this->dali = dali;
+  deadband_permille = 50;
+  gain_permille = 500;
+  sensor_bits = 10;
+  level_min = 1;
+  level_max = 254;
+  budget_permille = 100;
+  period_min_ms = 1000;
+  period_max_ms = 8000;
+  frames = 0;
+  bus_ticks = 0;
+  cnt = 0;
+  next_tick = dali->tick();
+}
+
+int8_t DaliDaylight::add_zone(uint8_t adr, uint8_t sensor, uint8_t instance, uint16_t setpoint) {
+  if(cnt >= DALI_DAYLIGHT_ZONES) return -1;
+  DaliDaylightZone *p = &z[cnt];
+  p->adr = adr;
+  p->sensor = sensor;
+  p->instance = instance;
+  p->setpoint = (setpoint ? setpoint : 1);
+  p->value = 0;
+  p->value_tick = dali->tick();
+  p->out = 5000;
+  p->level = 0xFF;
+  p->pending = 0;
+  p->period = Dali::us_to_ticks(period_min_ms * 1000);
+  p->next_query = p->value_tick; //query right away
+  p->queries = 0;
+  p->dapcs = 0;
+  p->latency = 0;
+  p->latency_max = 0;
+  return cnt++;
+}
+
+void DaliDaylight::set_setpoint(uint8_t zone, uint16_t setpoint) {
+  if(zone >= cnt) return;
+  z[zone].setpoint = (setpoint ? setpoint : 1);
+  z[zone].period = Dali::us_to_ticks(period_min_ms * 1000);
+  z[zone].next_query = dali->tick();
+}
+
+void DaliDaylight::input(uint8_t zone, uint16_t value) {
+  if(zone >= cnt) return;
+  z[zone].value = value;
+  z[zone].value_tick = dali->tick();
+  _regulate(&z[zone]);
+}
+
+const DaliDaylightZone *DaliDaylight::zone(uint8_t zone) {
+  return zone < cnt ? &z[zone] : 0;
+}
+
+//IEC62386-102: light = 10^((level-1)/(253/3) - 1) percent, level 1 is 0.1%, 254 is 100%
+uint8_t DaliDaylight::level_of(uint16_t out) {
+  if(out <= 10) return 1;
+  if(out >= 10000) return 254;
+  return 254 + (int16_t)floorf(log10f(out / 10000.0f) * (253 / 3.0f) + 0.5f);
+}
+
+uint16_t DaliDaylight::light_of(uint8_t level) {
+  if(level == 0) return 0;
+  return (uint16_t)(powf(10, (level - 254) * (3 / 253.0f)) * 10000 + 0.5f);
+}
+
+//sensor value after a new reading, correct the output outside the deadband
+void DaliDaylight::_regulate(DaliDaylightZone *p) {
+  int32_t e = (int32_t)p->setpoint - p->value;
+  if((uint32_t)(e < 0 ? -e : e) * 1000 > (uint32_t)deadband_permille * p->setpoint) {
+    int32_t out = p->out + e * gain_permille * 10 / p->setpoint;
+    int32_t lo = light_of(level_min), hi = light_of(level_max);
+    p->out = (out < lo ? lo : (out > hi ? hi : out)); //no windup beyond the level range
+  }
+  p->pending = (level_of(p->out) != p->level);
+}
+
+uint8_t DaliDaylight::_dapc(DaliDaylightZone *p) {
+  p->level = level_of(p->out);
+  p->pending = 0;
+  dali->set_level(p->level, p->adr);
+  p->dapcs++;
+  p->latency = dali->tick() - p->value_tick;
+  if(p->latency > p->latency_max) p->latency_max = p->latency;
+  return 1;
+}
+
+int32_t DaliDaylight::_query(DaliDaylightZone *p) {
+  uint8_t data[3] = {(uint8_t)((p->sensor << 1) | 1), p->instance, DALI_QUERY_INPUT_VALUE};
+  int16_t rv = dali->transport->transact(data, 24, 500);
+  p->queries++;
+  if(rv < 0) return rv;
+  uint16_t v = rv << 8;
+  if(sensor_bits > 8) {
+    data[2] = DALI_QUERY_INPUT_VALUE_LATCH;
+    rv = dali->transport->transact(data, 24, 500);
+    p->queries++;
+    if(rv < 0) return rv;
+    v |= rv;
+  }
+  return v >> (16 - (sensor_bits > 16 ? 16 : sensor_bits));
+}
+
+uint8_t DaliDaylight::update() {
+  uint32_t now = dali->tick();
+  if((int32_t)(now - next_tick) < 0) return 0;
+
+  //the oldest new value which asks for another level (input()), else the most overdue sensor query
+  DaliDaylightZone *p = 0;
+  for(uint8_t i = 0; i < cnt; i++) {
+    if(z[i].pending && (!p || (int32_t)(z[i].value_tick - p->value_tick) < 0)) p = &z[i];
+  }
+  uint8_t n = 0;
+  if(p) {
+    n = _dapc(p);
+  }else{
+    for(uint8_t i = 0; i < cnt; i++) {
+      if(z[i].sensor == DALI_DAYLIGHT_EVENT || (int32_t)(now - z[i].next_query) < 0) continue;
+      if(!p || (int32_t)(z[i].next_query - p->next_query) < 0) p = &z[i];
+    }
+    if(!p) return 0;
+    uint32_t q0 = p->queries;
+    int32_t v = _query(p);
+    n = p->queries - q0;
+    uint32_t period_min = Dali::us_to_ticks(period_min_ms * 1000);
+    if(v >= 0) {
+      p->value = v;
+      p->value_tick = dali->tick();
+      _regulate(p);
+      //back to the short period when the light left the deadband, double it while it stays inside
+      uint32_t e = (v > p->setpoint ? v - p->setpoint : p->setpoint - v);
+      if(e * 1000 > (uint32_t)deadband_permille * p->setpoint) {
+        p->period = period_min;
+      }else{
+        uint32_t period_max = Dali::us_to_ticks(period_max_ms * 1000);
+        p->period = (p->period * 2 > period_max ? period_max : p->period * 2);
+      }
+      if(p->pending) n += _dapc(p);
+    }
+    p->next_query = now + (p->period > period_min ? p->period : period_min);
+  }
+
+  //bus time budget
+  uint32_t d = dali->tick() - now;
+  frames += n;
+  bus_ticks += d;
+  next_tick = now + (budget_permille ? d * 1000 / budget_permille : d);
+  return n;
+}
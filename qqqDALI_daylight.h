@@ -0,0 +1,124 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Constant illuminance (daylight harvesting) control with a bounded frame rate
+
+Each zone regulates the gear at one address (usually a group) on the value
+of one light sensor: a DALI-2 input device (IEC62386-103/-304) which is
+queried, or any sensor whose values the application passes to input(), for
+example from the event messages of a sensor. The regulator is an integral
+controller on the light output, linear light in 1/10000 of the maximum,
+which is converted to the logarithmic arc power level for the DAPC frame:
+
+  out += gain_permille/1000 * (setpoint - value) / setpoint
+
+It only corrects when the sensor value is outside the deadband around the
+setpoint, and sends a group DAPC only when the level changes. Keep the
+deadband above 3%: one arc power level is 2.8% light, a narrower band
+toggles between two levels. gain_permille relates the error to the maximum
+artificial light: with the lamps at full output giving K sensor units, the
+loop converges without overshoot for gain_permille * K / setpoint < 1000.
+
+Call update() from loop(). A call sends the sensor query of the most
+overdue zone, and right after it the DAPC if the value calls for a new
+level, or the DAPC of a zone with a new input() value. The frames are
+spaced so that the controller uses at most budget_permille of the bus time;
+the spacing follows the bus time the frames actually took, so traffic of
+other controllers slows it down as well. A zone is queried every
+period_min_ms while its light changes, the period doubles up to
+period_max_ms while it stays within the deadband. When the zones together
+want more than the budget, every period stretches.
+
+Sensor query: QUERY INPUT VALUE to the instance, and for more than 8 bits
+of resolution QUERY INPUT VALUE LATCH for the next byte (IEC62386-103:
+the input value is MSB aligned, the first query latches the rest).
+
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_daylight_h
+#define qqqDALI_daylight_h
+
+#include "qqqDALI.h"
+
+#ifndef DALI_DAYLIGHT_ZONES
+#define DALI_DAYLIGHT_ZONES 8
+#endif
+
+#define DALI_DAYLIGHT_EVENT 0xFF //sensor address of a zone which gets its values from input()
+
+//IEC62386-103 instance commands: 24 bit frame of device address (0AAAAAA1), instance byte (instance number), opcode
+#define DALI_QUERY_INPUT_VALUE 0x8C
+#define DALI_QUERY_INPUT_VALUE_LATCH 0x8D
+
+struct DaliDaylightZone {
+  uint8_t adr;          //gear of the zone, as set_level(): short address, 64+group or 0xFF broadcast
+  uint8_t sensor;       //short address of the light sensor (control device), DALI_DAYLIGHT_EVENT: input()
+  uint8_t instance;     //instance number of the light sensor
+  uint16_t setpoint;    //sensor value to hold
+
+  uint16_t value;       //last sensor value
+  uint32_t value_tick;  //dali->tick() at which it was read or received
+  uint16_t out;         //regulator output, light in 1/10000 of the maximum
+  uint8_t level;        //level last sent, 0xFF: none yet
+  uint8_t pending;      //out asks for another level
+  uint32_t period;      //ticks between sensor queries
+  uint32_t next_query;  //tick of the next sensor query
+
+  uint32_t queries;     //sensor query frames sent
+  uint32_t dapcs;       //DAPC frames sent
+  uint32_t latency;     //sensor value to the end of the DAPC frame, ticks, of the last DAPC
+  uint32_t latency_max;
+};
+
+class DaliDaylight {
+public:
+  void begin(Dali *dali);
+  uint8_t update(); //call from loop(), returns number of frames sent
+
+  int8_t add_zone(uint8_t adr, uint8_t sensor, uint8_t instance, uint16_t setpoint); //returns zone number, -1 if all zones are used
+  void set_setpoint(uint8_t zone, uint16_t setpoint);
+  void input(uint8_t zone, uint16_t value); //sensor value from an event or another source (main context)
+  const DaliDaylightZone *zone(uint8_t zone); //NULL if zone is out of range
+
+  uint16_t deadband_permille; //no correction while the value is within this share of the setpoint (default 50 = 5%)
+  uint16_t gain_permille;     //error share corrected per step, relative to the maximum light (default 500)
+  uint8_t sensor_bits;        //resolution of the sensor value, 8 (one query) to 16 (default 10)
+  uint8_t level_min;          //lowest level the zones dim to (default 1)
+  uint8_t level_max;          //highest level (default 254)
+  uint16_t budget_permille;   //max share of bus time used by the controller (default 100 = 10%)
+  uint32_t period_min_ms;     //sensor query period while the light changes (default 1000)
+  uint32_t period_max_ms;     //max sensor query period while it stays within the deadband (default 8000, max 4000000)
+
+  uint32_t frames;    //total frames sent
+  uint32_t bus_ticks; //total bus time used
+
+  static uint8_t level_of(uint16_t out); //arc power level of a light output in 1/10000 of the maximum (IEC62386-102 curve)
+  static uint16_t light_of(uint8_t level); //light output of an arc power level, 1/10000 of the maximum
+
+private:
+  Dali *dali;
+  DaliDaylightZone z[DALI_DAYLIGHT_ZONES];
+  uint8_t cnt;
+  uint32_t next_tick; //earliest tick for the next frame (bus time budget)
+
+  int32_t _query(DaliDaylightZone *p); //sensor value or negative DALI_RESULT_xxx
+  void _regulate(DaliDaylightZone *p);
+  uint8_t _dapc(DaliDaylightZone *p);
+};
+
+#endif
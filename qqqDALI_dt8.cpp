@@ -0,0 +1,294 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_dt8.h"
+
+void DaliDT8::begin(Dali *dali) {
+  this->dali = dali;
+  frames = 0;
+  present = 0;
+  for(uint8_t g=0; g<16; g++) group[g] = 0;
+  invalidate();
+}
+
+void DaliDT8::invalidate(uint8_t adr) {
+  for(uint8_t i=0; i<DALI_DT8_CACHE_SIZE; i++) {
+    if(adr == 0xFF || adr == i) cache[i].valid = cache[i].tmp_valid = 0;
+  }
+}
+
+void DaliDT8::set_present(uint64_t mask) {
+  present = mask;
+}
+
+void DaliDT8::set_group(uint8_t g, uint64_t members) {
+  if(g < 16) group[g] = members;
+}
+
+//gear addressed by a short, group or broadcast address, 0 if unknown
+uint64_t DaliDT8::_members(uint8_t adr) {
+  if(adr < 64) return (uint64_t)1 << adr;
+  if(adr < 80) return group[adr - 64];
+  return present;
+}
+
+//the colour temperature of gear i after the next ACTIVATE is mirek: the temporary colour if one is loaded, else the
+//active one (ACTIVATE without temporary colour changes nothing)
+uint8_t DaliDT8::_tc_is(uint8_t i, uint16_t mirek) {
+  if(i >= DALI_DT8_CACHE_SIZE) return 0;
+  cache_entry *e = &cache[i];
+  if(e->tmp_valid) return (e->tmp_valid & 1) && e->tmp_tc == mirek;
+  return (e->valid & 1) && e->tc == mirek;
+}
+
+//level of RGBWAF channel ch of gear i after the next ACTIVATE, -1 if unknown
+int16_t DaliDT8::_level(uint8_t i, uint8_t ch) {
+  if(i >= DALI_DT8_CACHE_SIZE) return -1;
+  cache_entry *e = &cache[i];
+  if(e->tmp_valid & 1) return -1; //a temporary Tc: the gear leaves RGBWAF
+  if(e->tmp_valid & (2 << ch)) return e->tmp_rgbwaf[ch];
+  if(e->valid & (2 << ch)) return e->rgbwaf[ch];
+  return -1;
+}
+
+//any gear in m with a temporary colour
+uint8_t DaliDT8::_staged(uint64_t m) {
+  for(uint8_t i=0; i<DALI_DT8_CACHE_SIZE; i++) {
+    if(((m >> i) & 1) && cache[i].tmp_valid) return 1;
+  }
+  return 0;
+}
+
+//send ACTIVATE, the temporary colours of the addressed gear become the active ones
+uint8_t DaliDT8::_activate(uint8_t adr) {
+  uint32_t f0 = frames;
+  _ext(DALI_DT8_ACTIVATE, adr);
+  uint64_t m = (adr == 0xFF ? ~(uint64_t)0 : _members(adr));
+  for(uint8_t i=0; i<DALI_DT8_CACHE_SIZE; i++) {
+    cache_entry *e = &cache[i];
+    if(!((m >> i) & 1) || !e->tmp_valid) continue;
+    if(e->tmp_valid & 1) {
+      e->tc = e->tmp_tc;
+      e->valid = 1; //one active colour type: the RGBWAF levels are no longer known
+    }else{
+      e->valid &= ~1; //the gear leaves Tc
+      for(uint8_t ch=0; ch<6; ch++) {
+        if(!(e->tmp_valid & (2 << ch))) continue;
+        e->rgbwaf[ch] = e->tmp_rgbwaf[ch];
+        e->valid |= 2 << ch;
+      }
+    }
+    e->tmp_valid = 0;
+  }
+  return frames - f0;
+}
+
+int16_t DaliDT8::_cmd(uint16_t cmd, uint8_t adr) {
+  frames += (cmd & 0x0200 ? 2 : 1);
+  return dali->cmd(cmd, adr);
+}
+
+//application extended command
+int16_t DaliDT8::_ext(uint16_t cmd, uint8_t adr) {
+  _cmd(DALI_ENABLE_DEVICE_TYPE_X, 8);
+  return _cmd(cmd, adr);
+}
+
+void DaliDT8::_dtr(uint8_t dtr, uint8_t value) {
+  frames += dali->set_dtr_diff(dtr, value);
+}
+
+uint8_t DaliDT8::set_tc(uint8_t adr, uint16_t mirek, uint8_t activate) {
+  uint64_t m = _members(adr);
+
+  //skip if all addressed gear already have this colour after the next ACTIVATE, only ACTIVATE if it is loaded as
+  //temporary colour
+  uint8_t need = (m == 0); //unknown members: always send
+  for(uint8_t i=0; i<64 && !need; i++) {
+    if(((m >> i) & 1) && !_tc_is(i, mirek)) need = 1;
+  }
+  if(!need) return (activate && _staged(m) ? _activate(adr) : 0);
+
+  uint32_t f0 = frames;
+  _dtr(0, mirek & 0xFF);
+  _dtr(1, mirek >> 8);
+  _ext(DALI_DT8_SET_TEMPORARY_COLOUR_TEMPERATURE, adr);
+
+  for(uint8_t i=0; i<DALI_DT8_CACHE_SIZE; i++) {
+    if(!((m >> i) & 1)) continue;
+    cache[i].tmp_tc = mirek;
+    cache[i].tmp_valid = 1; //a temporary value of one colour type drops those of the other
+  }
+  if(activate) _activate(adr);
+  return frames - f0;
+}
+
+uint8_t DaliDT8::set_rgbwaf(uint8_t adr, const uint8_t *rgbwaf, uint8_t activate) {
+  uint64_t m = _members(adr);
+
+  //find changed channels
+  uint8_t changed = 0; //bit n: rgbwaf[n] differs for one or more of the addressed gear
+  for(uint8_t ch=0; ch<6; ch++) {
+    if(rgbwaf[ch] == DALI_DT8_MASK) continue;
+    if(m == 0) changed |= 1 << ch;
+    for(uint8_t i=0; i<64; i++) {
+      if(((m >> i) & 1) && _level(i, ch) != rgbwaf[ch]) {
+        changed |= 1 << ch;
+        break;
+      }
+    }
+  }
+  if(!changed) return (activate && _staged(m) ? _activate(adr) : 0);
+
+  //send only the changed triplets, unchanged channels in a triplet are sent as MASK, or as their
+  //cached level if the DTR already holds that (saves the DTR load)
+  uint32_t f0 = frames;
+  for(uint8_t t=0; t<2; t++) {
+    if(!((changed >> (3*t)) & 7)) continue;
+    for(uint8_t j=0; j<3; j++) {
+      uint8_t ch = 3*t + j;
+      uint8_t v = DALI_DT8_MASK;
+      if((changed >> ch) & 1) {
+        v = rgbwaf[ch];
+      }else if(m && dali->dtr_known(j) >= 0 && dali->dtr_known(j) != DALI_DT8_MASK) {
+        v = dali->dtr_known(j);
+        for(uint8_t i=0; i<64; i++) {
+          if(((m >> i) & 1) && _level(i, ch) != v) {
+            v = DALI_DT8_MASK;
+            break;
+          }
+        }
+      }
+      _dtr(j, v);
+    }
+    _ext(t == 0 ? DALI_DT8_SET_TEMPORARY_RGB_DIMLEVEL : DALI_DT8_SET_TEMPORARY_WAF_DIMLEVEL, adr);
+  }
+
+  for(uint8_t i=0; i<DALI_DT8_CACHE_SIZE; i++) {
+    if(!((m >> i) & 1)) continue;
+    cache[i].tmp_valid &= ~1; //a temporary value of one colour type drops those of the other
+    for(uint8_t ch=0; ch<6; ch++) {
+      if(!((changed >> ch) & 1)) continue;
+      cache[i].tmp_rgbwaf[ch] = rgbwaf[ch];
+      cache[i].tmp_valid |= 2 << ch;
+    }
+  }
+  if(activate) _activate(adr);
+  return frames - f0;
+}
+
+uint8_t DaliDT8::activate(uint8_t adr) {
+  return _activate(adr);
+}
+
+static uint8_t _popcount64(uint64_t v) {
+  uint8_t n = 0;
+  while(v) {
+    v &= v - 1;
+    n++;
+  }
+  return n;
+}
+
+uint8_t DaliDT8::set_tc_mask(uint64_t mask, uint16_t mirek) {
+  //gear which need the update, also those with the colour loaded as temporary colour: they need the ACTIVATE
+  uint64_t todo = 0;
+  for(uint8_t i=0; i<64; i++) {
+    if(!((mask >> i) & 1)) continue;
+    if(!_tc_is(i, mirek) || _staged((uint64_t)1 << i)) todo |= (uint64_t)1 << i;
+  }
+  if(!todo) return 0;
+
+  //all gear on the bus: broadcast
+  if(present && (present & ~mask) == 0) return set_tc(0xFF, mirek);
+
+  //cover with the largest groups which lie completely inside mask, then short addresses
+  //(gear in a group which already have the colour get it again, this is harmless and saves frames)
+  uint32_t f0 = frames;
+  uint16_t used_groups = 0;
+  uint64_t used_gear = 0;
+  while(todo) {
+    int8_t best = -1;
+    uint8_t bestcnt = 1; //a group must cover at least 2 gear to beat a short address
+    for(uint8_t g=0; g<16; g++) {
+      if(!group[g] || (group[g] & ~mask)) continue;
+      uint8_t cnt = _popcount64(group[g] & todo);
+      if(cnt > bestcnt) {
+        best = g;
+        bestcnt = cnt;
+      }
+    }
+    if(best >= 0) {
+      set_tc(64 + best, mirek, 0);
+      todo &= ~group[best];
+      used_groups |= 1 << best;
+    }else{
+      uint8_t i = 0;
+      while(!((todo >> i) & 1)) i++;
+      set_tc(i, mirek, 0);
+      todo &= ~((uint64_t)1 << i);
+      used_gear |= (uint64_t)1 << i;
+    }
+  }
+  //one broadcast ACTIVATE, unless gear outside mask have a temporary colour of an activate=0 call which must not
+  //start now: then ACTIVATE the groups and short addresses used
+  if(!_staged(~mask)) {
+    _activate(0xFF);
+  }else{
+    for(uint8_t g=0; g<16; g++) {
+      if((used_groups >> g) & 1) _activate(64 + g);
+    }
+    for(uint8_t i=0; i<64; i++) {
+      if((used_gear >> i) & 1) _activate(i);
+    }
+  }
+  return frames - f0;
+}
+
+int16_t DaliDT8::query_colour_status(uint8_t adr) {
+  return _ext(DALI_DT8_QUERY_COLOUR_STATUS, adr);
+}
+
+int32_t DaliDT8::query_tc(uint8_t adr) {
+  _dtr(0, DALI_DT8_COLOUR_VALUE_TC);
+  int16_t msb = _ext(DALI_DT8_QUERY_COLOUR_VALUE, adr);
+  if(msb < 0) return msb;
+  int16_t lsb = _cmd(DALI_QUERY_CONTENT_DTR0, adr);
+  if(lsb < 0) return lsb;
+  return ((uint16_t)msb << 8) | lsb;
+}
+
+uint8_t DaliDT8::scan() {
+  uint8_t cnt = 0;
+  present = 0;
+  for(uint8_t g=0; g<16; g++) group[g] = 0;
+  for(uint8_t sa=0; sa<64; sa++) {
+    if(_cmd(DALI_QUERY_STATUS, sa) < 0) continue;
+    present |= (uint64_t)1 << sa;
+    cnt++;
+    int16_t g0 = _cmd(DALI_QUERY_GROUPS_0_7, sa);
+    int16_t g1 = _cmd(DALI_QUERY_GROUPS_8_15, sa);
+    uint16_t g = (g0 < 0 ? 0 : g0) | (g1 < 0 ? 0 : g1 << 8);
+    for(uint8_t i=0; i<16; i++) {
+      if((g >> i) & 1) group[i] |= (uint64_t)1 << sa;
+    }
+  }
+  return cnt;
+}
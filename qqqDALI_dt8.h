@@ -0,0 +1,128 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Device Type 8 (IEC62386-209) colour control
+
+Colour values are loaded as temporary values through DTR0/DTR1/DTR2, each
+application extended command is preceded by ENABLE_DEVICE_TYPE_X(8), and
+ACTIVATE starts the transition.
+
+DaliDT8 keeps a per-gear cache of the active colour and of the temporary
+colour loaded with activate=0, which becomes the active one with the next
+ACTIVATE. An update is skipped for gear which already have the colour, and
+DTR loads are skipped when the DTR already holds the value
+(Dali::set_dtr_diff). Updates for a set of gear
+are sent to broadcast or group addresses where the group members are all
+part of the set.
+
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_dt8_h
+#define qqqDALI_dt8_h
+
+#include "qqqDALI.h"
+
+//number of short addresses with a colour cache entry (20 bytes each), reduce on small micro controllers
+#ifndef DALI_DT8_CACHE_SIZE
+#define DALI_DT8_CACHE_SIZE 64
+#endif
+
+//DT8 application extended commands, send with ENABLE_DEVICE_TYPE_X(8) directly before
+#define DALI_DT8_SET_TEMPORARY_X_COORDINATE 224 //224 DT8 - Store DTR1:DTR0 as temporary x-coordinate
+#define DALI_DT8_SET_TEMPORARY_Y_COORDINATE 225 //225 DT8 - Store DTR1:DTR0 as temporary y-coordinate
+#define DALI_DT8_ACTIVATE 226 //226 DT8 - Start transition to the temporary colour values
+#define DALI_DT8_SET_TEMPORARY_COLOUR_TEMPERATURE 231 //231 DT8 - Store DTR1:DTR0 as temporary colour temperature Tc (mirek)
+#define DALI_DT8_SET_TEMPORARY_PRIMARY_N_DIMLEVEL 234 //234 DT8 - Store DTR1:DTR0 as temporary dimlevel of primary N (N in DTR2)
+#define DALI_DT8_SET_TEMPORARY_RGB_DIMLEVEL 235 //235 DT8 - Store DTR0, DTR1, DTR2 as temporary red, green, blue dimlevel
+#define DALI_DT8_SET_TEMPORARY_WAF_DIMLEVEL 236 //236 DT8 - Store DTR0, DTR1, DTR2 as temporary white, amber, freecolour dimlevel
+#define DALI_DT8_SET_TEMPORARY_RGBWAF_CONTROL 237 //237 DT8 - Store DTR0 as temporary RGBWAF control
+#define DALI_DT8_COPY_REPORT_TO_TEMPORARY 238 //238 DT8 - Copy the report colour values to the temporary colour values
+#define DALI_DT8_QUERY_GEAR_FEATURES_STATUS 247 //247 DT8 - Returns gear features/status
+#define DALI_DT8_QUERY_COLOUR_STATUS 248 //248 DT8 - Returns colour status
+#define DALI_DT8_QUERY_COLOUR_TYPE_FEATURES 249 //249 DT8 - Returns colour type features
+#define DALI_DT8_QUERY_COLOUR_VALUE 250 //250 DT8 - Returns MSB of colour value selected by DTR0, LSB is stored in DTR0
+#define DALI_DT8_QUERY_RGBWAF_CONTROL 251 //251 DT8 - Returns RGBWAF control
+#define DALI_DT8_QUERY_ASSIGNED_COLOUR 252 //252 DT8 - Returns assigned colour of channel in DTR0
+#define DALI_DT8_QUERY_EXTENDED_VERSION_NUMBER 255 //255 DT8 - Returns 2
+
+//DTR0 selectors for DALI_DT8_QUERY_COLOUR_VALUE
+#define DALI_DT8_COLOUR_VALUE_X 0
+#define DALI_DT8_COLOUR_VALUE_Y 1
+#define DALI_DT8_COLOUR_VALUE_TC 2
+
+//colour status bits (DALI_DT8_QUERY_COLOUR_STATUS)
+#define DALI_DT8_STATUS_XY_OUT_OF_RANGE 0x01
+#define DALI_DT8_STATUS_TC_OUT_OF_RANGE 0x02
+#define DALI_DT8_STATUS_AUTO_CALIBRATION_RUNNING 0x04
+#define DALI_DT8_STATUS_AUTO_CALIBRATION_SUCCESS 0x08
+#define DALI_DT8_STATUS_XY_ACTIVE 0x10
+#define DALI_DT8_STATUS_TC_ACTIVE 0x20
+#define DALI_DT8_STATUS_PRIMARY_N_ACTIVE 0x40
+#define DALI_DT8_STATUS_RGBWAF_ACTIVE 0x80
+
+#define DALI_DT8_MASK 0xFF //RGBWAF channel level 'MASK': leave channel unchanged
+
+class DaliDT8 {
+public:
+  void begin(Dali *dali);
+
+  //set colour of a short address (0-63), group (64+g) or broadcast (0xFF)
+  //activate=0 only loads the temporary values, call activate() later to apply several changes at once
+  //returns number of frames sent, 0 if all addressed gear already have the colour
+  uint8_t set_tc(uint8_t adr, uint16_t mirek, uint8_t activate=1);
+  uint8_t set_rgbwaf(uint8_t adr, const uint8_t *rgbwaf, uint8_t activate=1); //rgbwaf[6]: red, green, blue, white, amber, freecolour, DALI_DT8_MASK to leave unchanged
+  uint8_t activate(uint8_t adr=0xFF);
+
+  //set colour of all gear in mask (bit n = short address n), using broadcast/group addressing where possible
+  uint8_t set_tc_mask(uint64_t mask, uint16_t mirek);
+
+  int16_t query_colour_status(uint8_t adr); //returns DALI_DT8_STATUS_xxx bits or negative DALI_RESULT_xxx
+  int32_t query_tc(uint8_t adr); //returns actual colour temperature in mirek, or negative DALI_RESULT_xxx
+
+  //topology, used to resolve group/broadcast updates in the cache
+  void     set_present(uint64_t mask); //gear present on the bus (bit n = short address n)
+  void     set_group(uint8_t group, uint64_t members); //members of group 0-15
+  uint8_t  scan(); //find present gear and their groups with queries, returns number of gear found
+  void     invalidate(uint8_t adr=0xFF); //forget cached colour of short address, or all
+
+  uint32_t frames; //number of frames sent
+
+private:
+  Dali *dali;
+  struct cache_entry {
+    uint16_t tc;       //active colour temperature
+    uint8_t rgbwaf[6]; //active RGBWAF levels
+    uint8_t valid;     //bit0: tc valid, bit1..6: rgbwaf[0..5] valid
+    uint16_t tmp_tc;   //temporary colour loaded with activate=0, not activated yet
+    uint8_t tmp_rgbwaf[6];
+    uint8_t tmp_valid; //as valid, 0: no temporary colour
+  } cache[DALI_DT8_CACHE_SIZE];
+  uint64_t present;
+  uint64_t group[16];
+
+  uint64_t _members(uint8_t adr);
+  uint8_t _tc_is(uint8_t i, uint16_t mirek);
+  int16_t _level(uint8_t i, uint8_t ch);
+  uint8_t _staged(uint64_t m);
+  uint8_t _activate(uint8_t adr);
+  int16_t _cmd(uint16_t cmd, uint8_t adr);
+  int16_t _ext(uint16_t cmd, uint8_t adr);
+  void _dtr(uint8_t dtr, uint8_t value);
+};
+
+#endif
@@ -0,0 +1,251 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_gear.h"
+
+#define TWICE_TICKS DALI_MS_TO_TICKS(100) //send twice commands: second frame within 100 ms
+
+//memory bank 0 (IEC62386-102 ed2), used when there is no memory_bank hook
+static const uint8_t bank0[27] = {
+  0x1A,                               //last accessible location
+  0x00,                               //reserved
+  0x00,                               //last accessible memory bank
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //GTIN
+  0x01, 0x00,                         //firmware version
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, //identification number
+  0x01, 0x00,                         //hardware version
+  0x08, 0x08, 0xFF,                   //101, 102, 103 version (2.0, 2.0, not implemented)
+  0x00, 0x01, 0x00                    //logical control device units, logical control gear units, unit index
+};
+
+void DaliGear::init(uint8_t shortadr, uint32_t randomadr, uint8_t device_type) {
+  this->shortadr = shortadr;
+  this->randomadr = randomadr & 0xFFFFFF;
+  this->device_type = device_type;
+  min_level = 1;
+  max_level = 254;
+  power_on_level = 254;
+  failure_level = 254;
+  level = power_on_level;
+  fade = 0x07;
+  groups = 0;
+  for(uint8_t i=0; i<16; i++) scene[i] = 0xFF;
+  for(uint8_t i=0; i<3; i++) dtr[i] = 0;
+  lamp_failure = 0;
+  power_failure = 1;
+  searchadr = 0xFFFFFF;
+  initialise = 0;
+  withdrawn = 0;
+  enabled_dt = 0xFF;
+  seed = randomadr * 2654435761u + 1;
+}
+
+void DaliGearEmu::begin(Dali *dali, DaliGear *gear, uint8_t cnt, uint16_t reply_delay_us) {
+  this->dali = dali;
+  this->gear = gear;
+  this->cnt = cnt;
+  memory_bank = 0;
+  frames = 0;
+  replies = 0;
+  collisions = 0;
+  last0 = 0;
+  last1 = 0;
+  lasttick = dali->tick() - TWICE_TICKS - 1;
+  dali->emulate(this, reply_delay_us);
+}
+
+void DaliGearEmu::end() {
+  dali->emulate(0);
+}
+
+uint8_t DaliGearEmu::frame(const uint8_t *data, uint8_t bitlen, uint8_t *reply_or, uint8_t *reply_and) {
+  if(bitlen != 16) return 0; //backward frames of other gear, control device frames
+  frames++;
+  uint32_t now = dali->tick();
+  uint8_t a = data[0];
+  uint8_t b = data[1];
+  uint8_t twice = (a == last0 && b == last1 && now - lasttick <= TWICE_TICKS);
+  last0 = a;
+  last1 = b;
+  lasttick = (twice ? now - TWICE_TICKS - 1 : now); //a third frame is a new first one
+
+  uint8_t n = 0;
+  for(uint8_t i=0; i<cnt; i++) {
+    int16_t r = _frame(&gear[i], a, b, twice);
+    if(r < 0) continue;
+    *reply_or |= r;
+    *reply_and &= r;
+    n++;
+  }
+  if(n) {
+    replies++;
+    if(*reply_or != *reply_and) collisions++;
+  }
+  return n;
+}
+
+void DaliGearEmu::_set_level(DaliGear *p, uint8_t v) {
+  if(v == 0xFF) return; //MASK
+  p->power_failure = 0;
+  if(v == 0) p->level = 0;
+  else p->level = (v < p->min_level ? p->min_level : (v > p->max_level ? p->max_level : v));
+}
+
+int16_t DaliGearEmu::_frame(DaliGear *p, uint8_t a, uint8_t b, uint8_t twice) {
+  p->enabled_dt = 0xFF; //only valid for the next command
+
+  //special commands
+  if(a >= 0xA1 && a <= 0xCB && (a & 1)) {
+    uint8_t sel = p->initialise && !p->withdrawn && p->randomadr == p->searchadr;
+    switch(a) {
+      case 0xA1: p->initialise = 0; p->withdrawn = 0; break; //TERMINATE
+      case 0xA3: p->dtr[0] = b; break; //DTR0
+      case 0xA5: //INITIALISE: all gear, gear without short address, or one short address
+        if(twice && (b == 0x00 || (b == 0xFF && p->shortadr == 0xFF) || ((b & 0x81) == 0x01 && (b >> 1) == p->shortadr))) {
+          p->initialise = 1;
+          p->withdrawn = 0;
+        }
+        break;
+      case 0xA7: //RANDOMISE
+        if(twice && p->initialise) {
+          p->seed = (p->seed ^ dali->tick()) * 1103515245u + 12345u;
+          p->randomadr = (p->seed >> 4) & 0xFFFFFF;
+        }
+        break;
+      case 0xA9: return (p->initialise && !p->withdrawn && p->randomadr <= p->searchadr) ? 0xFF : -1; //COMPARE
+      case 0xAB: if(sel) p->withdrawn = 1; break; //WITHDRAW
+      case 0xB1: p->searchadr = (p->searchadr & 0x00FFFF) | ((uint32_t)b << 16); break;
+      case 0xB3: p->searchadr = (p->searchadr & 0xFF00FF) | ((uint16_t)b << 8); break;
+      case 0xB5: p->searchadr = (p->searchadr & 0xFFFF00) | b; break;
+      case 0xB7: if(sel) p->shortadr = (b == 0xFF ? 0xFF : (b >> 1) & 0x3F); break; //PROGRAM SHORT ADDRESS
+      case 0xB9: return (p->initialise && (b & 0x81) == 0x01 && p->shortadr == (b >> 1)) ? 0xFF : -1; //VERIFY SHORT ADDRESS
+      case 0xBB: return sel ? (p->shortadr == 0xFF ? 0xFF : (p->shortadr << 1) | 1) : -1; //QUERY SHORT ADDRESS
+      case 0xC1: p->enabled_dt = b; break; //ENABLE DEVICE TYPE
+      case 0xC3: p->dtr[1] = b; break; //DTR1
+      case 0xC5: p->dtr[2] = b; break; //DTR2
+    }
+    return -1;
+  }
+
+  //addressing
+  uint8_t hit;
+  if((a & 0xFE) == 0xFE) hit = 1; //broadcast
+  else if((a & 0xFE) == 0xFC) hit = (p->shortadr == 0xFF); //broadcast unaddressed
+  else if(!(a & 0x80)) hit = (p->shortadr == (a >> 1));
+  else if((a & 0xE0) == 0x80) hit = (p->groups >> ((a >> 1) & 0xF)) & 1;
+  else hit = 0;
+  if(!hit) return -1;
+
+  if(!(a & 1)) {
+    _set_level(p, b); //DAPC
+    return -1;
+  }
+
+  //arc power commands
+  if(b < 32) {
+    uint8_t l = p->level;
+    switch(b) {
+      case 0: p->level = 0; p->power_failure = 0; break; //OFF
+      case 1: case 3: if(l && l < p->max_level) p->level = l + 1; break; //UP, STEP UP
+      case 2: case 4: if(l > p->min_level) p->level = l - 1; break; //DOWN, STEP DOWN
+      case 5: _set_level(p, p->max_level); break; //RECALL MAX LEVEL
+      case 6: _set_level(p, p->min_level); break; //RECALL MIN LEVEL
+      case 7: p->level = (l <= p->min_level ? 0 : l - 1); break; //STEP DOWN AND OFF
+      case 8: p->level = (l == 0 ? p->min_level : (l < p->max_level ? l + 1 : l)); break; //ON AND STEP UP
+      default:
+        if(b >= 16) _set_level(p, p->scene[b & 0xF]); //GO TO SCENE
+    }
+    return -1;
+  }
+
+  //configuration commands, executed when received twice
+  if(b < 144) {
+    if(!twice) return -1;
+    uint8_t d = p->dtr[0];
+    if(b == 32) { //RESET
+      p->level = 254;
+      p->min_level = 1;
+      p->max_level = 254;
+      p->power_on_level = 254;
+      p->failure_level = 254;
+      p->fade = 0x07;
+      p->groups = 0;
+      for(uint8_t i=0; i<16; i++) p->scene[i] = 0xFF;
+      p->searchadr = 0xFFFFFF;
+    }
+    else if(b == 33) p->dtr[0] = p->level; //STORE ACTUAL LEVEL IN DTR0
+    else if(b == 42) p->max_level = (d < p->min_level ? p->min_level : (d > 254 ? 254 : d));
+    else if(b == 43) p->min_level = (d < 1 ? 1 : (d > p->max_level ? p->max_level : d));
+    else if(b == 44) p->failure_level = d;
+    else if(b == 45) p->power_on_level = d;
+    else if(b == 46) p->fade = (p->fade & 0x0F) | ((d > 15 ? 15 : d) << 4);
+    else if(b == 47) p->fade = (p->fade & 0xF0) | (d > 15 ? 15 : (d ? d : 1));
+    else if(b >= 64 && b < 80) p->scene[b & 0xF] = d; //SET SCENE
+    else if(b >= 80 && b < 96) p->scene[b & 0xF] = 0xFF; //REMOVE FROM SCENE
+    else if(b >= 96 && b < 112) p->groups |= 1 << (b & 0xF); //ADD TO GROUP
+    else if(b >= 112 && b < 128) p->groups &= ~(1 << (b & 0xF)); //REMOVE FROM GROUP
+    else if(b == 128) { //SET SHORT ADDRESS
+      if(d == 0xFF) p->shortadr = 0xFF;
+      else if((d & 0x81) == 0x01) p->shortadr = d >> 1;
+    }
+    return -1;
+  }
+
+  if(b >= 224) return -1; //application extended commands (after ENABLE DEVICE TYPE) are not emulated
+
+  //queries
+  switch(b) {
+    case 144: //QUERY STATUS
+      return (p->lamp_failure ? 0x02 : 0) | (p->level ? 0x04 : 0) | (p->shortadr == 0xFF ? 0x40 : 0) | (p->power_failure ? 0x80 : 0);
+    case 145: return 0xFF; //QUERY CONTROL GEAR PRESENT
+    case 146: return p->lamp_failure ? 0xFF : -1;
+    case 147: return p->level ? 0xFF : -1; //QUERY LAMP POWER ON
+    case 150: return p->shortadr == 0xFF ? 0xFF : -1; //QUERY MISSING SHORT ADDRESS
+    case 151: return 8; //QUERY VERSION NUMBER: 2.0
+    case 152: return p->dtr[0];
+    case 153: return p->device_type;
+    case 154: return 1; //QUERY PHYSICAL MINIMUM
+    case 155: return p->power_failure ? 0xFF : -1;
+    case 156: return p->dtr[1];
+    case 157: return p->dtr[2];
+    case 158: return 0; //QUERY OPERATING MODE
+    case 160: return p->level;
+    case 161: return p->max_level;
+    case 162: return p->min_level;
+    case 163: return p->power_on_level;
+    case 164: return p->failure_level;
+    case 165: return p->fade;
+    case 167: return 0xFE; //QUERY NEXT DEVICE TYPE: one device type
+    case 192: return p->groups & 0xFF;
+    case 193: return p->groups >> 8;
+    case 194: return (p->randomadr >> 16) & 0xFF;
+    case 195: return (p->randomadr >> 8) & 0xFF;
+    case 196: return p->randomadr & 0xFF;
+    case 197: { //READ MEMORY LOCATION: bank DTR1, location DTR0, DTR0 increments
+      const uint8_t *m = (memory_bank ? memory_bank(p - gear, p->dtr[1]) : (p->dtr[1] == 0 ? bank0 : 0));
+      if(!m) return -1;
+      uint8_t loc = p->dtr[0];
+      if(loc < 0xFF) p->dtr[0] = loc + 1;
+      return loc <= m[0] ? m[loc] : -1;
+    }
+  }
+  if(b >= 176 && b < 192) return p->scene[b & 0xF]; //QUERY SCENE LEVEL
+  return -1;
+}
@@ -0,0 +1,112 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Control gear emulation, for test fixtures and stand-ins for real drivers
+
+DaliGearEmu turns a Dali instance into one or more virtual control gear
+(IEC62386-102 subset). timer() decodes each forward frame itself, at the
+end of its stop bits, and the gear execute it right there in the
+interrupt. The backward frame starts a fixed delay after the end of the
+forward frame (reply_delay_us, default DALI_EMU_REPLY_DELAY_US), on the
+tick: the latency does not depend on the main loop.
+Dali::emu_latency_ticks() holds the latency of the last backward frame.
+
+Several virtual gear answering the same query are sent as one backward
+frame, the way a real bus merges them: bits where the answers differ are
+low for the whole bit, which the controller sees as a collision.
+
+Supported:
+- DAPC, OFF, UP/DOWN/STEP UP/STEP DOWN (one step, levels change at once:
+  no fading), RECALL MAX/MIN, STEP DOWN AND OFF, ON AND STEP UP,
+  GO TO SCENE
+- configuration commands (send twice within 100 ms): RESET, STORE ACTUAL
+  LEVEL IN DTR0, max/min/system failure/power on level, fade time/rate,
+  scenes, groups, SET SHORT ADDRESS
+- queries: status, levels, DTR0-2, device type, groups, scenes, random
+  address, READ MEMORY LOCATION (memory_bank hook, bank 0 built in)
+- commissioning: INITIALISE, RANDOMISE, COMPARE, WITHDRAW, SEARCHADDR,
+  PROGRAM/VERIFY/QUERY SHORT ADDRESS, TERMINATE
+Not supported: device type specific commands, WRITE MEMORY LOCATION, the
+15 minute INITIALISE timeout.
+
+The gear state is changed in interrupt context: the main loop may read
+single fields (for example level) at any time, but should not write them
+while the emulation runs.
+
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_gear_h
+#define qqqDALI_gear_h
+
+#include "qqqDALI.h"
+
+struct DaliGear {
+  uint8_t shortadr;       //0-63, 0xFF: none
+  uint32_t randomadr;     //24 bit random address
+  uint8_t level;          //actual level
+  uint8_t min_level;
+  uint8_t max_level;
+  uint8_t power_on_level;
+  uint8_t failure_level;  //system failure level
+  uint8_t fade;           //fade time (high nibble), fade rate (low nibble)
+  uint16_t groups;        //bit n: member of group n
+  uint8_t scene[16];      //scene levels, 0xFF: MASK
+  uint8_t dtr[3];
+  uint8_t device_type;
+  uint8_t lamp_failure;   //set by the application
+  uint8_t power_failure;  //set at power up, cleared by the first arc power command
+
+  //commissioning
+  uint32_t searchadr;
+  uint8_t initialise;     //INITIALISE received, special commissioning commands are accepted
+  uint8_t withdrawn;
+  uint8_t enabled_dt;     //ENABLE DEVICE TYPE for the next command, 0xFF: none
+  uint32_t seed;          //RANDOMISE
+
+  void init(uint8_t shortadr, uint32_t randomadr, uint8_t device_type=6); //power up defaults
+};
+
+class DaliGearEmu : public DaliFrameHandler {
+public:
+  //emulate cnt gear (the array must stay valid) on dali: call after dali.begin()
+  void begin(Dali *dali, DaliGear *gear, uint8_t cnt, uint16_t reply_delay_us=DALI_EMU_REPLY_DELAY_US);
+  void end();
+
+  //memory bank contents of a gear (location 0: last accessible location), NULL if the bank is not implemented.
+  //Called in interrupt context. NULL (default): bank 0 only, the same for all gear
+  const uint8_t *(*memory_bank)(uint8_t gear, uint8_t bank);
+
+  volatile uint32_t frames;     //forward frames received
+  volatile uint32_t replies;    //backward frames sent
+  volatile uint32_t collisions; //backward frames in which virtual gear answered differently
+
+  //DaliFrameHandler, called by timer()
+  uint8_t frame(const uint8_t *data, uint8_t bitlen, uint8_t *reply_or, uint8_t *reply_and);
+
+private:
+  Dali *dali;
+  DaliGear *gear;
+  uint8_t cnt;
+  uint8_t last0, last1;   //previous forward frame, for send twice commands
+  uint32_t lasttick;
+
+  int16_t _frame(DaliGear *p, uint8_t a, uint8_t b, uint8_t twice); //returns backward frame or -1
+  void _set_level(DaliGear *p, uint8_t v);
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_health.h"
+
+void DaliHealth::begin(Dali *dali) {
+  this->dali = dali;
+  event_hook = 0;
+  checks = (1 << DALI_HEALTH_LAMP) | (1 << DALI_HEALTH_GEAR);
+  budget_permille = 50;
+  interval_min_ms = 1000;
+  interval_max_ms = 60000;
+  present = 0;
+  for(uint8_t g=0; g<16; g++) group[g] = 0;
+  for(uint8_t c=0; c<DALI_HEALTH_CHECKS; c++) failmask[c] = 0;
+  for(uint8_t i=0; i<64; i++) dt6status[i] = 0;
+  queries = 0;
+  bus_ticks = 0;
+  phase = 0;
+  interval = 0; //start the first sweep right away
+  sweep_tick = dali->tick();
+  next_tick = sweep_tick;
+}
+
+void DaliHealth::set_present(uint64_t mask) {
+  present = mask;
+}
+
+void DaliHealth::set_group(uint8_t g, uint64_t members) {
+  if(g < 16) group[g] = members;
+}
+
+uint64_t DaliHealth::_present() {
+  return present ? present : ~(uint64_t)0;
+}
+
+uint8_t DaliHealth::status(uint8_t adr, uint8_t check) {
+  if(adr >= 64 || check >= DALI_HEALTH_CHECKS) return 0;
+  if(check == DALI_HEALTH_DT6) return dt6status[adr];
+  return (failmask[check] >> adr) & 1;
+}
+
+uint64_t DaliHealth::failed(uint8_t check) {
+  if(check >= DALI_HEALTH_CHECKS) return 0;
+  return failmask[check];
+}
+
+//query the current check, returns 0 if all addressed gear are ok, >0 if one or more failed, or negative DALI_RESULT_xxx on bus errors
+int16_t DaliHealth::_query(uint8_t adr) {
+  int16_t rv;
+  if(check == DALI_HEALTH_DT6) {
+    dali->cmd(DALI_ENABLE_DEVICE_TYPE_X, 6);
+    rv = dali->cmd(DALI_QUERY_FAILURE_STATUS, adr);
+  }else{
+    rv = dali->cmd(check == DALI_HEALTH_LAMP ? DALI_QUERY_LAMP_FAILURE : DALI_QUERY_CONTROL_GEAR_FAILURE, adr);
+  }
+  if(rv == -DALI_RESULT_NO_REPLY) return 0;
+  //several gear replied at once (YES/NO checks only, DT6 is queried by short address): one or more of them failed
+  if(rv == -DALI_RESULT_COLLISION || rv == -DALI_RESULT_INVALID_REPLY) return 0xFF;
+  if(rv < 0) return rv;
+  if(check == DALI_HEALTH_DT6) return rv;
+  return 1;
+}
+
+void DaliHealth::_set(uint8_t adr, uint8_t status) {
+  uint64_t bit = (uint64_t)1 << adr;
+  if(check == DALI_HEALTH_DT6) {
+    if(dt6status[adr] == status) return;
+    dt6status[adr] = status;
+  }else{
+    status = (status ? 1 : 0);
+    if(((failmask[check] >> adr) & 1) == status) return;
+  }
+  if(status) failmask[check] |= bit; else failmask[check] &= ~bit;
+  changed = 1;
+  if(event_hook) event_hook(adr, check, status);
+}
+
+void DaliHealth::_set_mask(uint64_t mask, uint8_t status) {
+  for(uint8_t i=0; i<64; i++) {
+    if((mask >> i) & 1) _set(i, status);
+  }
+}
+
+//advance to the next enabled check, or end the sweep
+void DaliHealth::_next_check() {
+  while(++check < DALI_HEALTH_CHECKS) {
+    if(!((checks >> check) & 1)) continue;
+    if(check != DALI_HEALTH_DT6) {
+      phase = 1;
+      return;
+    }
+    //every LED gear answers QUERY FAILURE STATUS, also when ok: a broadcast or group query collides. Query by short
+    //address the gear flagged by the YES/NO checks of this sweep, and the gear with a DT6 failure to see it cleared.
+    uint64_t m = _present();
+    if(checks & ((1 << DALI_HEALTH_LAMP) | (1 << DALI_HEALTH_GEAR))) {
+      uint64_t flagged = failmask[DALI_HEALTH_DT6];
+      if((checks >> DALI_HEALTH_LAMP) & 1) flagged |= failmask[DALI_HEALTH_LAMP];
+      if((checks >> DALI_HEALTH_GEAR) & 1) flagged |= failmask[DALI_HEALTH_GEAR];
+      m &= flagged;
+    }
+    if(m) {
+      done = 0;
+      todo_group = 0;
+      todo_short = m;
+      phase = 2;
+      return;
+    }
+  }
+  phase = 0;
+  uint32_t ms = interval_min_ms;
+  if(!changed && interval) {
+    ms = Dali::ticks_to_us(interval) / 1000 * 2;
+    if(ms > interval_max_ms) ms = interval_max_ms;
+  }
+  interval = Dali::us_to_ticks(ms * 1000);
+}
+
+uint8_t DaliHealth::update() {
+  uint32_t now = dali->tick();
+  if((int32_t)(now - next_tick) < 0) return 0;
+
+  //start a sweep
+  if(phase == 0) {
+    if(now - sweep_tick < interval) return 0;
+    check = 0xFF;
+    changed = 0;
+    _next_check();
+    if(phase == 0) return 0; //no checks enabled
+    sweep_tick = now;
+  }
+
+  uint8_t adr = 0xFF;
+  uint8_t g = 0;
+  if(phase == 2) {
+    if(todo_group) {
+      while(!((todo_group >> g) & 1)) g++;
+      adr = 64 + g;
+    }else{
+      adr = 0;
+      while(!((todo_short >> adr) & 1)) adr++;
+    }
+  }
+
+  int16_t rv = _query(adr);
+  uint32_t d = dali->tick() - now;
+  queries++;
+  bus_ticks += d;
+  uint16_t budget = (budget_permille == 0 || budget_permille > 1000 ? 1000 : budget_permille);
+  next_tick = now + d * 1000 / budget;
+  if(rv < 0) return 1; //bus error: retry later
+
+  uint64_t p = _present();
+  if(phase == 1) {
+    if(rv == 0) {
+      _set_mask(p, 0);
+      _next_check();
+      return 1;
+    }
+    //someone failed: drill down by the groups which cover at least 2 gear, then by short address
+    done = 0;
+    todo_group = 0;
+    uint64_t covered = 0;
+    for(uint8_t i=0; i<16; i++) {
+      uint64_t m = group[i] & p & ~covered;
+      if(!(m & (m - 1))) continue; //less than 2 new gear
+      todo_group |= 1 << i;
+      covered |= m;
+    }
+    todo_short = p & ~covered;
+    phase = 2;
+  }else if(adr >= 64) {
+    todo_group &= ~(1 << g);
+    uint64_t m = group[g] & p & ~done;
+    if(rv == 0) {
+      _set_mask(m, 0);
+      done |= m;
+    }else{
+      todo_short |= m;
+    }
+  }else{
+    uint64_t bit = (uint64_t)1 << adr;
+    todo_short &= ~bit;
+    done |= bit;
+    _set(adr, rv);
+  }
+  if(!todo_group && !todo_short) _next_check();
+  return 1;
+}
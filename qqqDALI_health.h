@@ -0,0 +1,99 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Background lamp and control gear failure monitor
+
+Call update() from loop(), it sends at most one query per call. A sweep
+starts with one broadcast query per check: no reply means no gear has a
+failure, a reply or collision means one or more gear failed. Only then the
+monitor drills down, first with group queries, then with short address
+queries for the members of the groups which replied.
+
+The DT6 check is by short address only: every LED gear answers QUERY
+FAILURE STATUS with a value (0 when ok), so a broadcast would collide. It
+queries the gear flagged by the lamp or gear check of the same sweep, and
+gear with a DT6 failure until it is cleared. Without the lamp and gear
+checks it queries every present gear.
+
+Queries are spaced so that the monitor uses at most budget_permille of the
+bus time. After a sweep with a status change the next sweep starts after
+interval_min_ms, the interval doubles up to interval_max_ms for every sweep
+without changes.
+
+Changes are reported through event_hook, once per gear and check.
+
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_health_h
+#define qqqDALI_health_h
+
+#include "qqqDALI.h"
+
+//checks
+#define DALI_HEALTH_LAMP 0   //DALI_QUERY_LAMP_FAILURE
+#define DALI_HEALTH_GEAR 1   //DALI_QUERY_CONTROL_GEAR_FAILURE (DALI-2)
+#define DALI_HEALTH_DT6 2    //DALI_QUERY_FAILURE_STATUS of LED gear (IEC62386-207), status is the failure status byte, by short address
+#define DALI_HEALTH_CHECKS 3
+
+class DaliHealth {
+public:
+  void begin(Dali *dali);
+  uint8_t update(); //call from loop(), returns 1 if a query was sent
+
+  //called when the status of a gear changes, status 0: ok, else failed (DT6: failure status bits)
+  void (*event_hook)(uint8_t adr, uint8_t check, uint8_t status);
+
+  uint8_t checks;            //enabled checks, bit n = DALI_HEALTH_xxx n (default: lamp and gear)
+  uint16_t budget_permille;  //max share of bus time used by the monitor (default 50 = 5%)
+  uint32_t interval_min_ms;  //sweep interval after a status change (default 1000)
+  uint32_t interval_max_ms;  //max sweep interval while nothing changes (default 60000, max 4000000)
+
+  //topology, without it all 64 short addresses are queried when drilling down
+  void set_present(uint64_t mask); //gear present on the bus (bit n = short address n)
+  void set_group(uint8_t group, uint64_t members); //members of group 0-15
+
+  uint8_t status(uint8_t adr, uint8_t check); //last known status, 0: ok
+  uint64_t failed(uint8_t check); //short addresses with a failure (bit n = short address n)
+  uint32_t queries;   //number of queries sent
+  uint32_t bus_ticks; //bus time used by the queries
+
+private:
+  Dali *dali;
+  uint64_t present;
+  uint64_t group[16];
+  uint64_t failmask[DALI_HEALTH_CHECKS];
+  uint8_t dt6status[64];
+
+  uint8_t check;       //check of the current sweep step
+  uint8_t phase;       //0: idle, 1: broadcast, 2: drill down
+  uint16_t todo_group; //groups still to query
+  uint64_t todo_short; //short addresses still to query
+  uint64_t done;       //short addresses with a known status in this sweep
+  uint8_t changed;     //a status changed in this sweep
+  uint32_t interval;   //current sweep interval in ticks
+  uint32_t sweep_tick; //start of the current sweep
+  uint32_t next_tick;  //earliest tick for the next query (bus time budget)
+
+  uint64_t _present();
+  int16_t _query(uint8_t adr);
+  void _set(uint8_t adr, uint8_t status);
+  void _set_mask(uint64_t mask, uint8_t status);
+  void _next_check();
+};
+
+#endif
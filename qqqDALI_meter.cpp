@@ -0,0 +1,263 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_meter.h"
+#include <math.h>
+
+static const uint8_t banks[DALI_METER_BANKS] = {202, 203, 205};
+
+struct DaliMeterField {
+  uint8_t bank;      //index in banks[]
+  uint8_t loc;       //first (most significant) byte
+  uint8_t len;       //number of bytes
+  uint8_t scale_loc; //location of the scale factor (signed power of ten), 0: none
+  int8_t exp;        //fixed power of ten
+  int8_t offset;     //added after scaling
+};
+
+//in location order per bank, so that a quantity can continue where the previous one ended
+static const DaliMeterField fields[DALI_METER_QUANTITIES] = {
+  {0, 0x05, 6, 0x04,  0,   0}, //ACTIVE_ENERGY
+  {0, 0x0C, 4, 0x0B,  0,   0}, //ACTIVE_POWER
+  {1, 0x05, 6, 0x04,  0,   0}, //APPARENT_ENERGY
+  {1, 0x0C, 4, 0x0B,  0,   0}, //APPARENT_POWER
+  {2, 0x04, 4, 0,     0,   0}, //OPERATING_TIME
+  {2, 0x0B, 2, 0,    -1,   0}, //SUPPLY_VOLTAGE
+  {2, 0x0E, 1, 0,    -2,   0}, //POWER_FACTOR
+  {2, 0x1B, 1, 0,     0, -60}, //TEMPERATURE
+};
+
+static uint64_t _unknown(uint8_t len) {
+  return ((uint64_t)1 << (8 * len)) - 1;
+}
+
+void DaliMeter::begin(Dali *dali) {
+  this->dali = dali;
+  value_hook = 0;
+  quantities = (1 << DALI_METER_ACTIVE_ENERGY) | (1 << DALI_METER_ACTIVE_POWER);
+  budget_permille = 50;
+  interval_ms = 60000;
+  present = 0;
+  for(uint8_t i=0; i<DALI_METER_SIZE; i++) {
+    g[i].available = 0;
+    for(uint8_t k=0; k<DALI_METER_QUANTITIES; k++) {
+      g[i].scale[k] = 0;
+      g[i].raw[k] = _unknown(fields[k].len);
+      g[i].tick[k] = 0;
+    }
+  }
+  rescan();
+  cycles = 0;
+  cycle_frames = 0;
+  cycle_bus_ticks = 0;
+  frames = 0;
+  bus_ticks = 0;
+  q = 0xFF;
+  interval = 0; //start the first cycle right away
+  cycle_tick = dali->tick();
+  next_tick = cycle_tick;
+  seq = dali->dtr_seq();
+}
+
+void DaliMeter::set_present(uint64_t mask) {
+  present = mask;
+}
+
+void DaliMeter::rescan() {
+  for(uint8_t i=0; i<DALI_METER_SIZE; i++) g[i].probed = 0;
+}
+
+const DaliMeterGear *DaliMeter::gear(uint8_t adr) {
+  if(adr >= DALI_METER_SIZE) return 0;
+  return &g[adr];
+}
+
+float DaliMeter::value(uint8_t adr, uint8_t quantity) {
+  if(adr >= DALI_METER_SIZE || quantity >= DALI_METER_QUANTITIES) return NAN;
+  const DaliMeterGear *p = &g[adr];
+  if(!((p->available >> quantity) & 1) || p->raw[quantity] == _unknown(fields[quantity].len)) return NAN;
+  float v = p->raw[quantity];
+  for(int8_t e=p->scale[quantity]; e>0; e--) v *= 10;
+  for(int8_t e=p->scale[quantity]; e<0; e++) v /= 10;
+  return v + fields[quantity].offset;
+}
+
+int16_t DaliMeter::_cmd(uint16_t cmd, uint8_t arg) {
+  int16_t rv = dali->cmd(cmd, arg);
+  frames++;
+  c_frames++;
+  seq = dali->dtr_seq();
+  return rv;
+}
+
+//sequential read from the current DTR0 of the gear, returns number of bytes read or negative DALI_RESULT_xxx
+int16_t DaliMeter::_read(uint8_t adr, uint8_t *data, uint8_t len) {
+  uint8_t n = 0;
+  while(n < len) {
+    int16_t rv = _cmd(DALI_READ_MEMORY_LOCATION, adr);
+    if(rv == -DALI_RESULT_NO_REPLY) break;
+    if(rv < 0) return rv;
+    data[n++] = rv;
+  }
+  return n;
+}
+
+//broadcast DTR1 = bank and DTR0 = loc, skips the DTRs which all gear hold already
+void DaliMeter::_load_dtr(uint8_t bank, uint8_t loc) {
+  uint8_t n = dali->set_dtr_diff(1, bank);
+  n += dali->set_dtr_diff(0, loc);
+  frames += n;
+  c_frames += n;
+  seq = dali->dtr_seq();
+}
+
+//read the last accessible location and the scale factors of bank b
+int16_t DaliMeter::_probe(uint8_t adr, uint8_t b) {
+  uint8_t len = 1;
+  for(uint8_t k=0; k<DALI_METER_QUANTITIES; k++) {
+    if(fields[k].bank == b && fields[k].scale_loc >= len) len = fields[k].scale_loc + 1;
+  }
+  uint8_t buf[16];
+  _load_dtr(banks[b], 0);
+  int16_t n = _read(adr, buf, len);
+  //every gear holds location 0 now, and adr is somewhere further
+  synced = 0;
+  read_ok = 0;
+  if(n < 0) return n;
+
+  DaliMeterGear *p = &g[adr];
+  p->probed |= 1 << b;
+  for(uint8_t k=0; k<DALI_METER_QUANTITIES; k++) {
+    const DaliMeterField *f = &fields[k];
+    if(f->bank != b) continue;
+    //n == 0: bank not implemented (or no gear)
+    if(n > 0 && f->loc + f->len - 1 <= buf[0] && (!f->scale_loc || f->scale_loc < n)) {
+      p->available |= 1 << k;
+      p->scale[k] = f->exp + (f->scale_loc ? (int8_t)buf[f->scale_loc] : 0);
+    }else{
+      p->available &= ~(1 << k);
+    }
+  }
+  return n;
+}
+
+//read quantity q of gear adr
+int16_t DaliMeter::_read_value(uint8_t adr) {
+  const DaliMeterField *f = &fields[q];
+  uint64_t bit = (uint64_t)1 << adr;
+  if(seq != dali->dtr_seq()) {
+    //other code loaded DTRs or read memory since the last read
+    synced = 0;
+    read_ok = 0;
+  }
+  if(!(synced & bit)) {
+    _load_dtr(banks[f->bank], f->loc);
+    synced = ~(uint64_t)0;
+    read_ok = 0;
+  }
+  uint8_t buf[8];
+  int16_t n = _read(adr, buf, f->len);
+  synced &= ~bit;
+  DaliMeterGear *p = &g[adr];
+  if(n == 0) {
+    p->probed &= ~(1 << f->bank); //gear or bank gone: probe it again next cycle
+    return n;
+  }
+  if(n != f->len) return n; //bus error or short read: keep the last value
+  read_ok |= bit;
+
+  uint64_t raw = 0;
+  for(uint8_t i=0; i<f->len; i++) raw = (raw << 8) | buf[i];
+  p->raw[q] = raw;
+  p->tick[q] = dali->tick();
+  if(value_hook && raw != _unknown(f->len)) value_hook(adr, q, value(adr, q), p->tick[q]);
+  return n;
+}
+
+//find the next gear from adr on which has quantity q or was not probed yet, returns 0 if none
+uint8_t DaliMeter::_next_gear() {
+  uint64_t p = present ? present : ~(uint64_t)0;
+  uint8_t b = fields[q].bank;
+  for(; adr<DALI_METER_SIZE && adr<64; adr++) {
+    if(!((p >> adr) & 1)) continue;
+    if(!((g[adr].probed >> b) & 1) || ((g[adr].available >> q) & 1)) return 1;
+  }
+  return 0;
+}
+
+//advance to the next enabled quantity, or end the cycle
+void DaliMeter::_next_quantity() {
+  uint8_t prev = q;
+  uint8_t n = (q == 0xFF ? 0 : q + 1);
+  while(n < DALI_METER_QUANTITIES && !((quantities >> n) & 1)) n++;
+  if(n >= DALI_METER_QUANTITIES) {
+    q = 0xFF;
+    cycles++;
+    cycle_frames = c_frames;
+    cycle_bus_ticks = c_ticks;
+    interval = Dali::us_to_ticks(interval_ms * 1000);
+    return;
+  }
+  //gear which read the previous quantity completely hold the start of the next one if it follows directly
+  const DaliMeterField *a = &fields[prev == 0xFF ? n : prev];
+  const DaliMeterField *b = &fields[n];
+  if(prev != 0xFF && a->bank == b->bank && a->loc + a->len == b->loc) {
+    synced = read_ok;
+  }else{
+    synced = 0;
+  }
+  read_ok = 0;
+  q = n;
+  adr = 0;
+}
+
+uint8_t DaliMeter::update() {
+  uint32_t now = dali->tick();
+  if((int32_t)(now - next_tick) < 0) return 0;
+
+  //start a cycle
+  if(q == 0xFF) {
+    if(now - cycle_tick < interval) return 0;
+    if(!quantities) return 0;
+    cycle_tick = now;
+    c_frames = 0;
+    c_ticks = 0;
+    _next_quantity();
+  }
+  while(!_next_gear()) {
+    _next_quantity();
+    if(q == 0xFF) return 0; //cycle complete
+  }
+
+  uint32_t f0 = frames;
+  if(!((g[adr].probed >> fields[q].bank) & 1)) {
+    //read the value in the next call, if the gear has it
+    if(_probe(adr, fields[q].bank) < 0) adr++;
+  }else{
+    _read_value(adr);
+    adr++;
+  }
+  uint32_t d = dali->tick() - now;
+  bus_ticks += d;
+  c_ticks += d;
+  uint16_t budget = (budget_permille == 0 || budget_permille > 1000 ? 1000 : budget_permille);
+  next_tick = now + d * 1000 / budget;
+  return frames - f0;
+}
@@ -0,0 +1,135 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Background energy and diagnostics metering (DALI-2 memory banks)
+
+Reads the energy reporting banks of IEC62386-252 and the control gear
+diagnostics bank of IEC62386-253:
+
+  quantity          bank location     unit    scale
+  ACTIVE_ENERGY     202  0x05-0x0A    Wh      10^(location 0x04)
+  ACTIVE_POWER      202  0x0C-0x0F    W       10^(location 0x0B)
+  APPARENT_ENERGY   203  0x05-0x0A    VAh     10^(location 0x04)
+  APPARENT_POWER    203  0x0C-0x0F    VA      10^(location 0x0B)
+  OPERATING_TIME    205  0x04-0x07    s
+  SUPPLY_VOLTAGE    205  0x0B-0x0C    0.1 Vrms
+  POWER_FACTOR      205  0x0E         0.01
+  TEMPERATURE       205  0x1B         degree C + 60
+Multi byte values are MSB first, all bytes 0xFF means unknown.
+
+Each gear is probed once per bank: the last accessible location and the
+scale factors are read and kept. After that a metering cycle only reads the
+counters themselves. A cycle goes quantity by quantity, and for each
+quantity gear by gear: DTR1 (bank) and DTR0 (location) are loaded once by
+broadcast, READ MEMORY LOCATION then only increments DTR0 of the gear that
+is read, so all other gear still hold the start location. When the next
+quantity starts where the previous one ended (in the same bank), DTR0 is
+not loaded at all. Per gear a cycle costs one frame per counter byte.
+DTR loads by other code are noticed through Dali::dtr_seq(), the DTRs are
+then loaded again before the next read.
+
+Call update() from loop(). Each call reads at most one value of one gear
+(all its bytes back to back, so that gear which latch multi byte values on
+the first byte return a consistent value), and the reads are spaced so
+that the poller uses at most budget_permille of the bus time. Cycles start
+interval_ms apart. Values are published through value_hook with the tick
+at which they were read; cycle_frames and cycle_bus_ticks hold the cost of
+the last complete cycle.
+
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_meter_h
+#define qqqDALI_meter_h
+
+#include "qqqDALI.h"
+
+//number of short addresses with a meter entry (112 bytes each), reduce on small micro controllers
+#ifndef DALI_METER_SIZE
+#define DALI_METER_SIZE 64
+#endif
+
+//quantities
+#define DALI_METER_ACTIVE_ENERGY 0   //Wh, IEC62386-252 bank 202
+#define DALI_METER_ACTIVE_POWER 1    //W, bank 202
+#define DALI_METER_APPARENT_ENERGY 2 //VAh, bank 203
+#define DALI_METER_APPARENT_POWER 3  //VA, bank 203
+#define DALI_METER_OPERATING_TIME 4  //s, IEC62386-253 bank 205
+#define DALI_METER_SUPPLY_VOLTAGE 5  //Vrms, bank 205
+#define DALI_METER_POWER_FACTOR 6    //bank 205
+#define DALI_METER_TEMPERATURE 7     //degree C, bank 205
+#define DALI_METER_QUANTITIES 8
+
+#define DALI_METER_BANKS 3 //202, 203, 205
+
+struct DaliMeterGear {
+  uint8_t available; //bit n: quantity n is available
+  uint8_t probed;    //bit n: bank n (202, 203, 205) was probed
+  int8_t scale[DALI_METER_QUANTITIES];  //power of ten of the raw value
+  uint64_t raw[DALI_METER_QUANTITIES];  //value as read from the bank, all ones if unknown
+  uint32_t tick[DALI_METER_QUANTITIES]; //dali->tick() at which raw was read
+};
+
+class DaliMeter {
+public:
+  void begin(Dali *dali);
+  uint8_t update(); //call from loop(), returns number of frames sent
+
+  //called for every value read (not for unknown values)
+  void (*value_hook)(uint8_t adr, uint8_t quantity, float value, uint32_t tick);
+
+  uint8_t quantities;        //enabled quantities, bit n = DALI_METER_xxx n (default: active energy and power)
+  uint16_t budget_permille;  //max share of bus time used by the poller (default 50 = 5%)
+  uint32_t interval_ms;      //time between the starts of metering cycles (default 60000, max 4000000)
+
+  void set_present(uint64_t mask); //gear present on the bus (bit n = short address n), default: all 64 are probed
+  void rescan(); //probe all gear again in the next cycle (for example after commissioning)
+
+  const DaliMeterGear *gear(uint8_t adr); //NULL if adr is out of range
+  float value(uint8_t adr, uint8_t quantity); //last scaled value, NAN if unknown or not available
+
+  uint32_t cycles;          //number of complete metering cycles
+  uint32_t cycle_frames;    //frames sent in the last complete cycle
+  uint32_t cycle_bus_ticks; //bus time used by the last complete cycle
+  uint32_t frames;          //total frames sent
+  uint32_t bus_ticks;       //total bus time used
+
+private:
+  Dali *dali;
+  uint64_t present;
+  DaliMeterGear g[DALI_METER_SIZE];
+
+  uint8_t q;            //quantity of the current cycle step, 0xFF: idle
+  uint8_t adr;          //next gear to read for quantity q
+  uint64_t synced;      //gear which hold the start location of q in DTR0 (and its bank in DTR1)
+  uint64_t read_ok;     //gear which read q completely (their DTR0 is at the end of q)
+  uint8_t seq;          //dali->dtr_seq() after the last frame of the poller
+  uint32_t cycle_tick;  //start of the current cycle
+  uint32_t interval;    //ticks from cycle_tick to the start of the next cycle
+  uint32_t next_tick;   //earliest tick for the next read (bus time budget)
+  uint32_t c_frames, c_ticks; //current cycle
+
+  int16_t _cmd(uint16_t cmd, uint8_t arg);
+  int16_t _read(uint8_t adr, uint8_t *data, uint8_t len);
+  void _load_dtr(uint8_t bank, uint8_t loc);
+  int16_t _probe(uint8_t adr, uint8_t b);
+  int16_t _read_value(uint8_t adr);
+  uint8_t _next_gear();
+  void _next_quantity();
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_restore.h"
+
+void DaliRestore::begin(Dali *dali) {
+  this->dali = dali;
+  inner = dali->transport;
+  dali->begin(this);
+  event_hook = 0;
+  restore_delay_ms = 100;
+  topo = 0;
+  for(uint8_t i=0; i<64; i++) level[i] = DALI_RESTORE_UNKNOWN;
+  for(uint8_t g=0; g<16; g++) group[g] = 0;
+  scene_ok = 0;
+  pending = 0;
+  restores = 0;
+  restore_frames = 0;
+  restore_ticks = 0;
+  dali->bus_events(); //discard old events
+}
+
+void DaliRestore::set_topology(DaliTopology *topo) {
+  this->topo = topo;
+  if(!topo) {
+    scene_ok = 0;
+    return;
+  }
+  for(uint8_t g=0; g<16; g++) group[g] = topo->group_members(g);
+  scene_ok = 0xFFFF;
+}
+
+uint32_t DaliRestore::tick() {
+  //dali's own sample engine: dali->tick() would come back here
+  if(inner == dali) return dali->_sample_tick();
+  return inner->tick();
+}
+
+int16_t DaliRestore::transact(uint8_t *data, uint8_t bitlen, uint16_t timeout_ms) {
+  if(bitlen == 16) _track(data[0], data[1]);
+  return inner->transact(data, bitlen, timeout_ms);
+}
+
+uint64_t DaliRestore::_targets(uint8_t a) {
+  if(!(a & 0x80)) return (uint64_t)1 << ((a >> 1) & 0x3F);
+  if((a & 0xE0) == 0x80) return group[(a >> 1) & 0xF];
+  if((a & 0xFE) == 0xFE) return ~(uint64_t)0;
+  return 0; //special command or broadcast unaddressed
+}
+
+int16_t DaliRestore::_scene_level(uint8_t adr, uint8_t scene) {
+  if(!topo || !((scene_ok >> scene) & 1)) return -1;
+  const DaliTopoGear *p = topo->gear(adr);
+  if(!p) return -1;
+  return p->scene[scene];
+}
+
+//follow the level of the gear addressed by a forward frame
+void DaliRestore::_track(uint8_t a, uint8_t b) {
+  uint64_t m = _targets(a);
+  if(!m) return;
+  if(!(a & 1)) {
+    //DAPC
+    if(b == 0xFF) return; //MASK: no change
+    for(uint8_t i=0; i<64; i++) if((m >> i) & 1) level[i] = b;
+    return;
+  }
+  if(b >= 16 && b < 32) {
+    //GO TO SCENE: gear without the scene (MASK) keep their level
+    for(uint8_t i=0; i<64; i++) {
+      if(!((m >> i) & 1)) continue;
+      int16_t s = _scene_level(i, b & 0xF);
+      if(s < 0) level[i] = DALI_RESTORE_UNKNOWN;
+      else if(s != 0xFF) level[i] = s;
+    }
+    return;
+  }
+  if(b >= 96 && b < 112) { group[b & 0xF] |= m; return; }   //ADD TO GROUP
+  if(b >= 112 && b < 128) { group[b & 0xF] &= ~m; return; } //REMOVE FROM GROUP
+  if(b >= 64 && b < 96) { scene_ok &= ~(1 << (b & 0xF)); return; } //SET SCENE, REMOVE FROM SCENE
+  uint8_t v;
+  switch(b) {
+    case 0: v = 0; break;     //OFF
+    case 5: v = 254; break;   //RECALL MAX LEVEL: DAPC 254 is limited to the max level
+    case 6: v = 1; break;     //RECALL MIN LEVEL: DAPC 1 is raised to the min level
+    case 32: v = 254; break;  //RESET
+    case 1: case 2: case 3: case 4: case 7: case 8: case 9: case 10: case 11:
+      v = DALI_RESTORE_UNKNOWN; //relative and continuous commands
+      break;
+    default:
+      return; //other commands do not change the level
+  }
+  for(uint8_t i=0; i<64; i++) if((m >> i) & 1) level[i] = v;
+}
+
+uint8_t DaliRestore::_send(uint8_t a, uint8_t b) {
+  uint8_t data[2] = {a, b};
+  inner->transact(data, 16, 500);
+  return 1;
+}
+
+//keep the candidate command a,b if it restores more gear than the best so far
+void DaliRestore::_best(uint64_t fix, uint8_t a, uint8_t b, uint8_t *best_gain, uint8_t *best_a, uint8_t *best_b, uint64_t *best_fix) {
+  uint8_t gain = 0;
+  for(uint64_t f=fix; f; f&=f-1) gain++;
+  if(gain <= *best_gain) return;
+  *best_gain = gain;
+  *best_a = a;
+  *best_b = b;
+  *best_fix = fix;
+}
+
+//restore plan: greedy cover with broadcast and group commands, then DAPC per gear
+uint8_t DaliRestore::restore() {
+  uint64_t present = (topo && topo->present ? topo->present : ~(uint64_t)0);
+  uint64_t todo = 0; //gear not at their level yet
+  for(uint8_t i=0; i<64; i++) {
+    if(((present >> i) & 1) && level[i] != DALI_RESTORE_UNKNOWN) todo |= (uint64_t)1 << i;
+  }
+  uint64_t known = todo; //gear with a level to restore, the others may take any level
+  uint8_t frames = 0;
+
+  while(todo) {
+    //candidates: scope 0-15 group, 16 broadcast; command DAPC v or GO TO SCENE n. A single gear is restored by DAPC
+    //to its short address, so a broadcast or group command must restore at least 2
+    uint8_t best_gain = 1, best_a = 0, best_b = 0;
+    uint64_t best_fix = 0;
+    for(uint8_t scope=0; scope<17; scope++) {
+      uint64_t m = (scope < 16 ? group[scope] : ~(uint64_t)0) & present;
+      if(!(m & todo)) continue;
+      uint8_t a = (scope < 16 ? 0x80 | (scope << 1) : 0xFE);
+
+      //DAPC: try the level of every gear still to restore in scope
+      uint64_t tried = 0;
+      for(uint8_t i=0; i<64; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        if(!(m & todo & bit) || (tried & bit)) continue;
+        uint8_t v = level[i];
+        uint64_t same = 0;
+        for(uint8_t k=0; k<64; k++) {
+          if(((m & known) >> k) & 1 && level[k] == v) same |= (uint64_t)1 << k;
+        }
+        tried |= same;
+        if(m & known & ~todo & ~same) continue; //would move restored gear away from their level
+        _best(same & todo, a, v, &best_gain, &best_a, &best_b, &best_fix);
+      }
+
+      //GO TO SCENE n: gear with MASK for the scene do not change
+      for(uint8_t n=0; n<16 && topo; n++) {
+        if(!((scene_ok >> n) & 1)) continue;
+        uint64_t fix = 0, broken = 0;
+        for(uint8_t k=0; k<64; k++) {
+          uint64_t kb = (uint64_t)1 << k;
+          if(!(m & known & kb)) continue;
+          int16_t s = _scene_level(k, n);
+          if(s == 0xFF) continue;
+          if(s == level[k]) fix |= kb; else broken |= kb;
+        }
+        if(broken & ~todo) continue;
+        _best(fix & todo, a | 1, 16 + n, &best_gain, &best_a, &best_b, &best_fix);
+      }
+    }
+    if(!best_fix) break;
+    frames += _send(best_a, best_b);
+    todo &= ~best_fix;
+  }
+
+  //the rest one by one
+  for(uint8_t i=0; i<64; i++) {
+    if((todo >> i) & 1) frames += _send(i << 1, level[i]);
+  }
+  return frames;
+}
+
+uint8_t DaliRestore::update() {
+  uint8_t ev = dali->bus_events();
+  if(ev & DALI_BUS_EVENT_DOWN) {
+    pending = 0;
+    if(event_hook) event_hook(DALI_BUS_EVENT_DOWN, dali->bus_down_tick());
+  }
+  if(ev & DALI_BUS_EVENT_UP) {
+    pending = 1;
+    up_tick = dali->bus_up_tick();
+    if(event_hook) event_hook(DALI_BUS_EVENT_UP, up_tick);
+  }
+  if(!pending || dali->bus_is_down()) return 0;
+  if(tick() - up_tick < Dali::us_to_ticks((uint32_t)restore_delay_ms * 1000)) return 0;
+  pending = 0;
+  uint8_t n = restore();
+  uint32_t now = tick();
+  restores++;
+  restore_frames = n;
+  restore_ticks = now - up_tick;
+  if(event_hook) event_hook(DALI_BUS_EVENT_RESTORED, now);
+  return n;
+}
@@ -0,0 +1,94 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Restore the light levels after a bus power failure
+
+When the bus is down for more than 500 ms, gear go to their system failure
+level, and stay there when the bus comes back. timer() detects the bus
+failure (Dali::bus_events()), DaliRestore then sends the last commanded
+levels again.
+
+begin() puts DaliRestore between Dali and its frame transport, so it sees
+every forward frame sent by the high level functions (set_level, cmd, send,
+other modules) and keeps the last commanded level of each short address:
+DAPC, OFF, RECALL MAX/MIN, GO TO SCENE (levels from the topology) and RESET.
+Relative commands (UP, DOWN, STEP ...) make the level unknown, such gear are
+not restored (but a group command for the others may move them). Commands sent while the bus is down are followed too, so the
+restore also applies them.
+
+The restore plan uses as few frames as it can: it repeatedly picks the
+broadcast or group command (DAPC or GO TO SCENE) which brings the most gear
+still to restore to their level, without moving gear which are already
+restored away from theirs. Gear left over get a DAPC each. With a topology
+(set_topology) the group memberships and scene levels are known, without it
+only groups seen in ADD TO GROUP commands are used.
+
+Call update() from loop(). restore_ticks holds the time from the bus coming
+up to the end of the last restore, restore_frames the frames it took.
+
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_restore_h
+#define qqqDALI_restore_h
+
+#include "qqqDALI.h"
+#include "qqqDALI_topology.h"
+
+#define DALI_RESTORE_UNKNOWN 0xFF //level not known: never commanded, or changed by a relative command
+#define DALI_BUS_EVENT_RESTORED 0x04 //event_hook(): levels restored after a bus failure
+
+class DaliRestore : public DaliTransport {
+public:
+  void begin(Dali *dali); //follow the frames sent by dali: call after dali.begin(), and after dali.begin(&transport) if used
+  uint8_t update(); //call from loop(), returns number of frames sent
+
+  //called on DALI_BUS_EVENT_DOWN, DALI_BUS_EVENT_UP (tick of the bus level change) and DALI_BUS_EVENT_RESTORED (tick at the end of the restore)
+  void (*event_hook)(uint8_t event, uint32_t tick);
+
+  uint16_t restore_delay_ms; //time after the bus came up before restoring (default 100), gear need a moment to power up
+  uint8_t restore();         //send the last commanded levels now, returns number of frames sent
+
+  //present gear, group members and scene levels (optional, the topology must stay valid while used)
+  void set_topology(DaliTopology *topo);
+
+  uint8_t level[64];       //last commanded level of each short address, DALI_RESTORE_UNKNOWN if not known
+  uint32_t restores;       //number of restores after a bus failure
+  uint32_t restore_frames; //frames sent by the last restore
+  uint32_t restore_ticks;  //bus up to the end of the last restore (includes restore_delay_ms)
+
+  //DaliTransport
+  int16_t transact(uint8_t *data, uint8_t bitlen, uint16_t timeout_ms);
+  uint32_t tick();
+
+private:
+  Dali *dali;
+  DaliTransport *inner; //transport of dali before begin()
+  DaliTopology *topo;
+  uint64_t group[16];   //group members, from the topology and ADD TO GROUP/REMOVE FROM GROUP
+  uint16_t scene_ok;    //bit n: topology scene n levels are valid (not changed by SET SCENE since)
+  uint8_t pending;      //bus came up, restore when restore_delay_ms passed
+  uint32_t up_tick;
+
+  uint64_t _targets(uint8_t a); //short addresses addressed by address byte a
+  void _track(uint8_t a, uint8_t b);
+  int16_t _scene_level(uint8_t adr, uint8_t scene); //level of scene in gear adr, 0xFF: MASK, -1: not known
+  uint8_t _send(uint8_t a, uint8_t b);
+  void _best(uint64_t fix, uint8_t a, uint8_t b, uint8_t *best_gain, uint8_t *best_a, uint8_t *best_b, uint64_t *best_fix);
+};
+
+#endif
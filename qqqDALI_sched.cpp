@@ -0,0 +1,304 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_sched.h"
+
+#define DAPC 0xFFFF //queue entry cmd of set_level()
+
+//queue handoff between cmd()/set_level() (interrupt, other thread or core) and update(): the producer fills the entry
+//and publishes it with a release store of qtail, update() loads qtail with acquire before reading the entry. Likewise
+//update() frees the entry with a release store of qhead after reading it. On AVR these are plain byte accesses with
+//a compiler barrier
+#if defined(__GNUC__)
+#define Q_LOAD(v) __atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define Q_LOAD_ACQUIRE(v) __atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+#define Q_STORE_RELEASE(v, x) __atomic_store_n(&(v), (x), __ATOMIC_RELEASE)
+#else
+#define Q_LOAD(v) (v)
+#define Q_LOAD_ACQUIRE(v) (v)
+#define Q_STORE_RELEASE(v, x) ((v) = (x))
+#endif
+
+void DaliScheduler::begin(Dali *dali) {
+  static const uint16_t budget[DALI_SCHED_CLASSES] = {1000, 500, 100, 1000};
+  static const uint32_t latency[DALI_SCHED_CLASSES] = {100, 1000, 5000, 10000};
+  this->dali = dali;
+  qhead = 0;
+  qtail = 0;
+  uint32_t now = dali->tick();
+  for(uint8_t c=0; c<DALI_SCHED_CLASSES; c++) {
+    budget_permille[c] = budget[c];
+    latency_ms[c] = latency[c];
+    steps[c] = 0;
+    bus_ticks[c] = 0;
+    wait_max[c] = 0;
+    late[c] = 0;
+    task[c] = 0;
+    next_tick[c] = now;
+  }
+}
+
+uint8_t DaliScheduler::_push(uint16_t cmd, uint8_t arg, uint8_t level, void (*done)(int16_t, uint32_t)) {
+  uint8_t t = Q_LOAD(qtail); //only the producer writes it
+  if((uint8_t)(t - Q_LOAD_ACQUIRE(qhead)) >= DALI_SCHED_QUEUE) return DALI_RESULT_BUS_NOT_IDLE;
+  Entry *e = &q[t & (DALI_SCHED_QUEUE - 1)];
+  e->cmd = cmd;
+  e->arg = arg;
+  e->level = level;
+  e->done = done;
+  e->tick = dali->tick();
+  Q_STORE_RELEASE(qtail, (uint8_t)(t + 1)); //publish
+  return DALI_OK;
+}
+
+uint8_t DaliScheduler::cmd(uint16_t cmd, uint8_t arg, void (*done)(int16_t rv, uint32_t latency)) {
+  return _push(cmd, arg, 0, done);
+}
+
+uint8_t DaliScheduler::set_level(uint8_t level, uint8_t adr, void (*done)(int16_t rv, uint32_t latency)) {
+  return _push(DAPC, adr, level, done);
+}
+
+void DaliScheduler::add(DaliTask *task, uint8_t cls) {
+  if(cls < 1 || cls >= DALI_SCHED_CLASSES || task->busy) return;
+  task->next = 0;
+  task->busy = 1;
+  DaliTask **p = &this->task[cls];
+  if(!*p) {
+    //the class was idle: it is due now, not since its last step
+    uint32_t now = dali->tick();
+    if((int32_t)(now - next_tick[cls]) > 0) next_tick[cls] = now;
+  }
+  while(*p) p = &(*p)->next;
+  *p = task;
+}
+
+void DaliScheduler::remove(DaliTask *task) {
+  for(uint8_t c=1; c<DALI_SCHED_CLASSES; c++) {
+    for(DaliTask **p = &this->task[c]; *p; p = &(*p)->next) {
+      if(*p == task) {
+        *p = task->next;
+        task->busy = 0;
+        return;
+      }
+    }
+  }
+}
+
+uint8_t DaliScheduler::_run_queued() {
+  uint8_t h = Q_LOAD(qhead); //only update() writes it, update() checked qtail with acquire
+  Entry *e = &q[h & (DALI_SCHED_QUEUE - 1)];
+  uint32_t start = dali->tick();
+  int16_t rv = DALI_OK;
+  if(e->cmd == DAPC) dali->set_level(e->level, e->arg); else rv = dali->cmd(e->cmd, e->arg);
+  uint32_t now = dali->tick();
+  uint32_t latency = now - e->tick;
+  void (*done)(int16_t, uint32_t) = e->done;
+  Q_STORE_RELEASE(qhead, (uint8_t)(h + 1)); //the entry is free again
+
+  uint32_t d = now - start;
+  steps[0]++;
+  bus_ticks[0] += d;
+  if(latency > wait_max[0]) wait_max[0] = latency;
+  if(latency > Dali::us_to_ticks(latency_ms[0] * 1000)) late[0]++;
+  uint16_t budget = (budget_permille[0] == 0 || budget_permille[0] > 1000 ? 1000 : budget_permille[0]);
+  next_tick[0] = start + d * 1000 / budget;
+  if(done) done(rv, latency);
+  return 1;
+}
+
+//one step of the first task of class cls, returns 1 if it used the bus
+uint8_t DaliScheduler::_run_step(uint8_t cls, uint32_t now) {
+  DaliTask *t = task[cls];
+  uint32_t wait = now - next_tick[cls];
+  uint8_t rv = t->step(dali);
+  if(rv == DALI_TASK_IDLE) {
+    next_tick[cls] = now; //waiting for itself, not for the bus
+    return 0;
+  }
+  uint32_t d = dali->tick() - now;
+  steps[cls]++;
+  bus_ticks[cls] += d;
+  if(wait > wait_max[cls]) wait_max[cls] = wait;
+  if(wait > Dali::us_to_ticks(latency_ms[cls] * 1000)) late[cls]++;
+  uint16_t budget = (budget_permille[cls] == 0 || budget_permille[cls] > 1000 ? 1000 : budget_permille[cls]);
+  next_tick[cls] = now + d * 1000 / budget;
+  if(rv == DALI_TASK_DONE) {
+    task[cls] = t->next;
+    t->busy = 0;
+    if(task[cls] && (int32_t)(dali->tick() - next_tick[cls]) > 0) next_tick[cls] = dali->tick();
+  }
+  return 1;
+}
+
+uint8_t DaliScheduler::update() {
+  uint32_t now = dali->tick();
+  if(Q_LOAD(qhead) != Q_LOAD_ACQUIRE(qtail) && (int32_t)(now - next_tick[0]) >= 0) return _run_queued();
+
+  //a class which waited past its latency target goes first, then the others by priority
+  uint8_t due = 0;
+  uint8_t first = 0;
+  for(uint8_t c=1; c<DALI_SCHED_CLASSES; c++) {
+    if(!task[c] || (int32_t)(now - next_tick[c]) < 0) continue;
+    due |= 1 << c;
+    if(!first && now - next_tick[c] > Dali::us_to_ticks(latency_ms[c] * 1000)) first = c;
+  }
+  if(first && _run_step(first, now)) return 1;
+  for(uint8_t c=1; c<DALI_SCHED_CLASSES; c++) {
+    if(c != first && ((due >> c) & 1) && _run_step(c, now)) return 1;
+  }
+  return 0;
+}
+
+//-------------------------------------------------------------------
+void DaliMemoryTask::begin(uint8_t bank, uint64_t mask, uint8_t *buf, uint8_t size) {
+  this->bank = bank;
+  todo = mask;
+  this->buf = buf;
+  this->size = size;
+  adr = 0xFF;
+  base = 0xFF;
+  frames = 0;
+}
+
+uint8_t DaliMemoryTask::step(Dali *dali) {
+  if(adr == 0xFF) {
+    if(!todo || !size) return DALI_TASK_DONE;
+    adr = 0;
+    while(!((todo >> adr) & 1)) adr++;
+    len = 1;
+    pos = 0;
+    retry = 2;
+  }
+
+  //DTR0 of the gear not read yet is base, unless other code loaded DTRs since the last read
+  if(dali->dtr_seq() != seq || (pos == 0 && base != 0)) {
+    frames += dali->set_dtr_diff(1, bank);
+    dali->cmd(DALI_DATA_TRANSFER_REGISTER0, pos);
+    frames++;
+    base = pos;
+  }
+  int16_t rv = dali->cmd(DALI_READ_MEMORY_LOCATION, adr);
+  frames++;
+  seq = dali->dtr_seq();
+
+  uint8_t end = 0;
+  if(rv >= 0) {
+    buf[pos] = rv;
+    if(pos == 0) len = (rv >= size ? size : rv + 1); //location 0: last accessible location
+    pos++;
+    end = (pos >= len);
+  }else if(rv == -DALI_RESULT_NO_REPLY) {
+    end = 1; //not implemented, or end of the bank
+  }else if(retry) {
+    retry--;
+    seq = dali->dtr_seq() - 1; //the gear may or may not have incremented DTR0: load it again
+  }else{
+    end = 1;
+  }
+  if(end) {
+    if(data_hook) data_hook(adr, bank, buf, pos);
+    todo &= ~((uint64_t)1 << adr);
+    adr = 0xFF;
+  }
+  return DALI_TASK_MORE;
+}
+
+//-------------------------------------------------------------------
+enum {CT_INITIALISE, CT_RANDOMISE, CT_WAIT, CT_FIRST, CT_SEARCH, CT_LAST, CT_PROGRAM, CT_WITHDRAW, CT_TERMINATE};
+
+void DaliCommissionTask::begin(uint64_t *used) {
+  this->used = used;
+  cnt = 0;
+  sa = 0;
+  state = CT_INITIALISE;
+}
+
+uint8_t DaliCommissionTask::step(Dali *dali) {
+  switch(state) {
+  case CT_INITIALISE: //gear with a short address keep their random address
+    dali->cmd(DALI_INITIALISE, 0xFF);
+    state = CT_RANDOMISE;
+    return DALI_TASK_MORE;
+  case CT_RANDOMISE:
+    dali->cmd(DALI_RANDOMISE, 0x00);
+    tick = dali->tick();
+    state = CT_WAIT;
+    return DALI_TASK_MORE;
+  case CT_WAIT: //the random address is ready 100ms after RANDOMISE
+    if(dali->tick() - tick < DALI_MS_TO_TICKS(100)) return DALI_TASK_IDLE;
+    state = CT_FIRST;
+    //fall-thru
+  case CT_FIRST: //is any gear left: one compare instead of a full search
+    adr_last = 0xFFFFFF;
+    dali->set_searchaddr(adr_last);
+    if(!dali->compare()) {
+      state = CT_TERMINATE;
+      return DALI_TASK_MORE;
+    }
+    adr = 0x800000;
+    addsub = 0x400000;
+    state = CT_SEARCH;
+    return DALI_TASK_MORE;
+  case CT_SEARCH: //binary search, one compare per step
+    dali->set_searchaddr_diff(adr, adr_last);
+    adr_last = adr;
+    if(dali->compare()) adr -= addsub; else adr += addsub;
+    addsub >>= 1;
+    if(!addsub) state = CT_LAST;
+    return DALI_TASK_MORE;
+  case CT_LAST:
+    dali->set_searchaddr_diff(adr, adr_last);
+    adr_last = adr;
+    if(!dali->compare()) {
+      adr++;
+      dali->set_searchaddr_diff(adr, adr_last);
+      adr_last = adr;
+    }
+    state = CT_PROGRAM;
+    return DALI_TASK_MORE;
+  case CT_PROGRAM: { //first free short address, checked: the gear still in the search do not have it
+    while(sa < 64 && ((*used >> sa) & 1)) sa++;
+    if(sa >= 64) break; //all 64 short addresses assigned
+    uint8_t retry = 2;
+    while(retry) {
+      dali->program_short_address(sa);
+      if(dali->cmd(DALI_VERIFY_SHORT_ADDRESS, (sa << 1) | 0x01) == 0xFF) break;
+      retry--;
+    }
+    *used |= (uint64_t)1 << sa; //also when it did not verify: the gear may have taken it
+    if(retry) cnt++;
+    state = CT_WITHDRAW;
+    return DALI_TASK_MORE;
+  }
+  case CT_WITHDRAW: //remove the gear from the search
+    dali->cmd(DALI_WITHDRAW, 0x00);
+    state = CT_FIRST;
+    return DALI_TASK_MORE;
+  }
+  //terminate the INITIALISE state
+  dali->cmd(DALI_TERMINATE, 0x00);
+  return DALI_TASK_DONE;
+}
+
+//-------------------------------------------------------------------
+uint8_t DaliPollTask::step(Dali *) {
+  return (poll && poll()) ? DALI_TASK_MORE : DALI_TASK_IDLE;
+}
@@ -0,0 +1,179 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Bus scheduler: interactive commands go ahead of background work
+
+Everything in Dali is a blocking chain of cmd() calls, so a button press
+has to wait until a running scan, memory read or commissioning loop
+returns. DaliScheduler runs long operations as tasks instead: a DaliTask
+does its work in steps, and each step sends one transaction (a query or
+command, a command sent twice, or the DTR loads and the frame which uses
+them) and returns. update() runs one queued interactive command or one
+step of a task per call, so an interactive command waits at most for the
+step in progress.
+
+Traffic classes, highest priority first:
+  DALI_SCHED_INTERACTIVE  commands queued with cmd() and set_level()
+  DALI_SCHED_COMMISSION   addressing (DaliCommissionTask)
+  DALI_SCHED_POLL         periodic polling (DaliPollTask around DaliHealth,
+                          DaliMeter, ...)
+  DALI_SCHED_BULK         bulk transfers (DaliMemoryTask)
+Each class has a bus time budget (budget_permille): after a step which
+took d ticks, the class waits until d*1000/budget_permille ticks have
+passed since the step started, like the background pollers space their
+queries. And a latency target (latency_ms): a background class whose next
+step has been waiting longer than its target goes ahead of the higher
+classes, so none of them starves. Interactive commands always go first,
+latency_ms of DALI_SCHED_INTERACTIVE only counts the late ones (late[]).
+
+Tasks of one class run one after the other, in the order they were added.
+A task must not send frames outside step(), and other code should send
+its commands through the queue while tasks run: a command in between two
+steps must not break the state a task relies on. Tasks which use DTRs
+notice DTR loads by other code through Dali::dtr_seq() and load them
+again; the addressing state of gear in INITIALISE (search address) is
+only changed by special commands.
+
+cmd() and set_level() only queue the command: they may be called from an
+interrupt (one producer), update() must run in the main context.
+
+Changelog:
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_sched_h
+#define qqqDALI_sched_h
+
+#include "qqqDALI.h"
+
+//traffic classes
+#define DALI_SCHED_INTERACTIVE 0
+#define DALI_SCHED_COMMISSION 1
+#define DALI_SCHED_POLL 2
+#define DALI_SCHED_BULK 3
+#define DALI_SCHED_CLASSES 4
+
+//DaliTask::step() return values
+#define DALI_TASK_DONE 0 //finished, the task is removed
+#define DALI_TASK_MORE 1 //sent frames, more to do
+#define DALI_TASK_IDLE 2 //nothing sent, nothing to do right now (waiting): the next class gets the bus
+
+//interactive command queue entries (power of 2)
+#ifndef DALI_SCHED_QUEUE
+#define DALI_SCHED_QUEUE 8
+#endif
+
+class DaliTask {
+public:
+  DaliTask() : busy(0), next(0) {}
+  virtual uint8_t step(Dali *dali) = 0; //send one transaction, returns DALI_TASK_xxx
+  uint8_t busy;         //added to a scheduler and not done yet
+private:
+  friend class DaliScheduler;
+  DaliTask *next;
+};
+
+class DaliScheduler {
+public:
+  void begin(Dali *dali);
+  uint8_t update(); //call from loop(), runs one interactive command or one task step, returns 1 if it used the bus
+
+  //queue an interactive command (same arguments as Dali::cmd() and Dali::set_level()), done is called from update() with
+  //the result and the ticks from queueing to completion. Returns 0, or DALI_RESULT_BUS_NOT_IDLE if the queue is full
+  uint8_t cmd(uint16_t cmd, uint8_t arg, void (*done)(int16_t rv, uint32_t latency)=0);
+  uint8_t set_level(uint8_t level, uint8_t adr=0xFF, void (*done)(int16_t rv, uint32_t latency)=0);
+
+  void add(DaliTask *task, uint8_t cls); //run task in class cls, after the tasks already in it
+  void remove(DaliTask *task); //stop a task between two steps
+
+  uint16_t budget_permille[DALI_SCHED_CLASSES]; //max share of bus time (default 1000, 500, 100, 1000)
+  uint32_t latency_ms[DALI_SCHED_CLASSES];      //latency target (default 100, 1000, 5000, 10000)
+
+  //statistics per class
+  uint32_t steps[DALI_SCHED_CLASSES];      //commands or task steps run
+  uint32_t bus_ticks[DALI_SCHED_CLASSES];  //bus time used
+  uint32_t wait_max[DALI_SCHED_CLASSES];   //longest wait in ticks: interactive from queueing to completion, tasks from due to start
+  uint32_t late[DALI_SCHED_CLASSES];       //commands or steps which waited longer than latency_ms
+
+private:
+  struct Entry {
+    uint16_t cmd;       //0xFFFF: DAPC
+    uint8_t arg;
+    uint8_t level;
+    uint32_t tick;      //queued at
+    void (*done)(int16_t rv, uint32_t latency);
+  };
+  Dali *dali;
+  Entry q[DALI_SCHED_QUEUE];
+  volatile uint8_t qhead, qtail;   //update() reads at qhead, cmd() writes at qtail, both published with release stores
+  DaliTask *task[DALI_SCHED_CLASSES];  //first task of each class
+  uint32_t next_tick[DALI_SCHED_CLASSES]; //earliest tick for the next step (bus time budget)
+
+  uint8_t _push(uint16_t cmd, uint8_t arg, uint8_t level, void (*done)(int16_t, uint32_t));
+  uint8_t _run_queued();
+  uint8_t _run_step(uint8_t cls, uint32_t now);
+};
+
+//read a memory bank of a set of gear, one READ MEMORY LOCATION per step. The DTRs are loaded once, DTR0 of the gear
+//being read increments with every read, they are loaded again only when other code changed them in between.
+//data_hook gets the bank contents of each gear (len 0: the bank is not implemented or the gear did not answer)
+class DaliMemoryTask : public DaliTask {
+public:
+  //read bank of the gear in mask (bit n = short address n) into buf, at most size bytes per gear
+  void begin(uint8_t bank, uint64_t mask, uint8_t *buf, uint8_t size);
+  void (*data_hook)(uint8_t adr, uint8_t bank, const uint8_t *data, uint8_t len);
+  uint8_t step(Dali *dali);
+  uint16_t frames; //frames sent
+
+private:
+  uint8_t bank;
+  uint64_t todo;
+  uint8_t *buf;
+  uint8_t size;
+  uint8_t adr;    //gear being read, 0xFF: next one
+  uint8_t len;    //bytes to read from the gear (location 0 + 1)
+  uint8_t pos;    //bytes read from the gear
+  uint8_t base;   //DTR0 of the gear not read yet (broadcast load), valid while seq is current
+  uint8_t seq;    //dali->dtr_seq() after the last read
+  uint8_t retry;
+};
+
+//commission_new() in steps: gear without short address are initialised and randomised, then found one compare per
+//step and given the first free short address of *used (checked with VERIFY SHORT ADDRESS). *used is updated, cnt
+//holds the number of short addresses assigned
+class DaliCommissionTask : public DaliTask {
+public:
+  void begin(uint64_t *used);
+  uint8_t step(Dali *dali);
+  uint8_t cnt;
+
+private:
+  uint64_t *used;
+  uint8_t state;
+  uint8_t sa;
+  uint32_t adr, addsub, adr_last;
+  uint32_t tick;
+};
+
+//a periodic poller as a task which never ends: poll() sends at most one transaction and returns the number of frames
+//sent (DaliHealth::update(), DaliMeter::update(), ...), 0 gives the bus to the next class
+class DaliPollTask : public DaliTask {
+public:
+  uint8_t (*poll)();
+  uint8_t step(Dali *dali);
+};
+
+#endif
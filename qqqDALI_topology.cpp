@@ -0,0 +1,534 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Changelog:
+2026-10-19 Pruned, time sliced scan, min/max levels (snapshot version 2)
+2026-10-19 Created
+###########################################################################*/
+#include "qqqDALI_topology.h"
+
+//scan phases
+#define SCAN_IDLE 0
+#define SCAN_PRESENT 1 //QUERY CONTROL GEAR PRESENT for each short address
+#define SCAN_RANDOM 2  //random address of each gear found
+#define SCAN_ITEMS 3   //groups, device type, min/max level, scene levels: broadcast, per group, per gear
+
+//values asked in SCAN_ITEMS, the groups first: the group queries of the later items need them
+#define SCAN_ITEM_GROUPS_0_7 0
+#define SCAN_ITEM_GROUPS_8_15 1
+#define SCAN_ITEM_DT 2
+#define SCAN_ITEM_MIN 3
+#define SCAN_ITEM_MAX 4
+#define SCAN_ITEM_SCENE0 5
+#define SCAN_ITEM_CNT (SCAN_ITEM_SCENE0 + 16)
+
+#define SCAN_SCOPE_GEAR 17 //sscope: gear by gear
+
+static const uint8_t scan_cmd[SCAN_ITEM_SCENE0] = {
+  DALI_QUERY_GROUPS_0_7, DALI_QUERY_GROUPS_8_15, DALI_QUERY_DEVICE_TYPE, DALI_QUERY_MIN_LEVEL, DALI_QUERY_MAX_LEVEL
+};
+
+static uint8_t _count(uint64_t m) {
+  uint8_t n = 0;
+  for(; m; m &= m - 1) n++;
+  return n;
+}
+
+void DaliTopology::begin(Dali *dali) {
+  this->dali = dali;
+  frames = 0;
+  bus_ticks = 0;
+  sphase = SCAN_IDLE;
+  scan_budget_permille = 1000;
+  scan_frames = 0;
+  scan_ticks = 0;
+  clear();
+}
+
+void DaliTopology::clear() {
+  present = 0;
+  mismatch = 0;
+  unaddressed = 0;
+}
+
+const DaliTopoGear *DaliTopology::gear(uint8_t adr) {
+  if(adr >= DALI_TOPO_SIZE || !((present >> adr) & 1)) return 0;
+  return &g[adr];
+}
+
+uint64_t DaliTopology::group_members(uint8_t group) {
+  uint64_t m = 0;
+  if(group >= 16) return 0;
+  for(uint8_t i=0; i<DALI_TOPO_SIZE; i++) {
+    if(((present >> i) & 1) && ((g[i].groups >> group) & 1)) m |= (uint64_t)1 << i;
+  }
+  return m;
+}
+
+uint8_t DaliTopology::has_device_type(uint8_t adr, uint8_t dt) {
+  const DaliTopoGear *p = gear(adr);
+  if(!p) return 0;
+  for(uint8_t i=0; i<DALI_TOPO_DT_MAX; i++) {
+    if(p->dt[i] == dt) return 1;
+  }
+  return 0;
+}
+
+int16_t DaliTopology::_query_raw(uint8_t cmd0, uint8_t cmd1) {
+  uint32_t t0 = dali->tick();
+  int16_t rv = dali->tx_wait_rx(cmd0, cmd1);
+  frames++;
+  bus_ticks += dali->tick() - t0;
+  return rv;
+}
+
+int16_t DaliTopology::_query(uint16_t cmd, uint8_t adr) {
+  return _query_raw(adr << 1 | 1, cmd);
+}
+
+int16_t DaliTopology::_query_random(uint8_t adr, uint32_t *randomadr) {
+  uint32_t r = 0;
+  for(uint8_t i=0; i<3; i++) {
+    int16_t rv = _query(DALI_QUERY_RANDOM_ADDRESS_H + i, adr);
+    if(rv < 0) return rv;
+    r = (r << 8) | rv;
+  }
+  *randomadr = r;
+  return DALI_OK;
+}
+
+//-------------------------------------------------
+//SCAN
+int16_t DaliTopology::refresh(uint8_t adr) {
+  if(adr >= DALI_TOPO_SIZE) return -DALI_RESULT_INVALID_CMD;
+  uint64_t bit = (uint64_t)1 << adr;
+  present &= ~bit;
+  mismatch &= ~bit;
+  int16_t rv = _query(DALI_QUERY_CONTROL_GEAR_PRESENT, adr);
+  if(rv == -DALI_RESULT_NO_REPLY) return 0;
+  if(rv < 0) return rv;
+  DaliTopoGear *p = &g[adr];
+
+  rv = _query_random(adr, &p->randomadr);
+  if(rv < 0) return rv;
+
+  //device types: DALI-2 gear with several types reply MASK, then list them with QUERY NEXT DEVICE TYPE
+  for(uint8_t i=0; i<DALI_TOPO_DT_MAX; i++) p->dt[i] = DALI_TOPO_DT_NONE;
+  rv = _query(DALI_QUERY_DEVICE_TYPE, adr);
+  if(rv < 0) return rv;
+  if(rv != 0xFF) {
+    p->dt[0] = rv;
+  }else{
+    for(uint8_t i=0; i<DALI_TOPO_DT_MAX; i++) {
+      rv = _query(DALI_QUERY_NEXT_DEVICE_TYPE, adr);
+      if(rv < 0) return rv;
+      if(rv == DALI_TOPO_DT_NONE) break;
+      p->dt[i] = rv;
+    }
+  }
+
+  int16_t g0 = _query(DALI_QUERY_GROUPS_0_7, adr);
+  if(g0 < 0) return g0;
+  int16_t g1 = _query(DALI_QUERY_GROUPS_8_15, adr);
+  if(g1 < 0) return g1;
+  p->groups = (uint16_t)g1 << 8 | g0;
+
+  rv = _query(DALI_QUERY_MIN_LEVEL, adr);
+  if(rv < 0) return rv;
+  p->min_level = rv;
+  rv = _query(DALI_QUERY_MAX_LEVEL, adr);
+  if(rv < 0) return rv;
+  p->max_level = rv;
+
+  for(uint8_t s=0; s<16; s++) {
+    rv = _query(DALI_QUERY_SCENE0_LEVEL + s, adr);
+    if(rv < 0) return rv;
+    p->scene[s] = rv;
+  }
+  present |= bit;
+  return 1;
+}
+
+uint8_t DaliTopology::scan() {
+  uint16_t budget = scan_budget_permille;
+  scan_budget_permille = 1000;
+  scan_start();
+  while(scan_update());
+  scan_budget_permille = budget;
+  return _count(present);
+}
+
+void DaliTopology::scan_start() {
+  clear();
+  sphase = SCAN_PRESENT;
+  sadr = 0;
+  ssub = 0;
+  sfound = 0;
+  scan_frames = 0;
+  scan_ticks = 0;
+  next_tick = dali->tick();
+}
+
+uint8_t DaliTopology::scan_busy() {
+  return sphase != SCAN_IDLE;
+}
+
+uint8_t DaliTopology::scan_update() {
+  if(sphase == SCAN_IDLE) return 0;
+  uint32_t now = dali->tick();
+  if((int32_t)(now - next_tick) < 0) return 1;
+  uint32_t f0 = frames, b0 = bus_ticks;
+  uint8_t rv = _scan_step();
+  scan_frames += frames - f0;
+  scan_ticks += bus_ticks - b0;
+  uint32_t d = dali->tick() - now;
+  uint16_t budget = (scan_budget_permille == 0 || scan_budget_permille > 1000 ? 1000 : scan_budget_permille);
+  next_tick = now + d * 1000 / budget;
+  return rv;
+}
+
+void DaliTopology::_scan_item_start(uint8_t item) {
+  sitem = item;
+  sscope = 0;
+  sgroup_pay = 0;
+  stodo = sfound;
+  smerged = 0;
+}
+
+void DaliTopology::_scan_set(uint8_t adr, uint8_t item, uint8_t v) {
+  DaliTopoGear *p = &g[adr];
+  switch(item) {
+    case SCAN_ITEM_GROUPS_0_7: p->groups = (p->groups & 0xFF00) | v; break;
+    case SCAN_ITEM_GROUPS_8_15: p->groups = (p->groups & 0x00FF) | (uint16_t)v << 8; break;
+    case SCAN_ITEM_DT:
+      for(uint8_t i=0; i<DALI_TOPO_DT_MAX; i++) p->dt[i] = DALI_TOPO_DT_NONE;
+      if(v != 0xFF) p->dt[0] = v; //0xFF: several device types, listed by QUERY NEXT DEVICE TYPE
+      break;
+    case SCAN_ITEM_MIN: p->min_level = v; break;
+    case SCAN_ITEM_MAX: p->max_level = v; break;
+    default: p->scene[item - SCAN_ITEM_SCENE0] = v;
+  }
+}
+
+//QUERY NEXT DEVICE TYPE is only valid directly after QUERY DEVICE TYPE or QUERY NEXT DEVICE TYPE to the same gear:
+//the whole list in one scan step, other traffic (application, scheduler) runs between steps
+void DaliTopology::_scan_next_dt(uint8_t adr) {
+  for(uint8_t i=0; i<DALI_TOPO_DT_MAX; i++) {
+    int16_t rv = _query(DALI_QUERY_NEXT_DEVICE_TYPE, adr);
+    if(rv < 0) {
+      sfound &= ~((uint64_t)1 << adr);
+      return;
+    }
+    if(rv == DALI_TOPO_DT_NONE) return;
+    g[adr].dt[i] = rv;
+  }
+}
+
+//one step of the scan, sends at most one query, returns 0 when the scan is complete
+uint8_t DaliTopology::_scan_step() {
+  int16_t rv;
+  switch(sphase) {
+  case SCAN_PRESENT:
+    rv = _query(DALI_QUERY_CONTROL_GEAR_PRESENT, sadr);
+    if(rv >= 0) sfound |= (uint64_t)1 << sadr;
+    if(++sadr >= DALI_TOPO_SIZE) {
+      sphase = SCAN_RANDOM;
+      sadr = 0;
+      ssub = 0;
+    }
+    return 1;
+
+  case SCAN_RANDOM:
+    while(sadr < DALI_TOPO_SIZE && !((sfound >> sadr) & 1)) sadr++;
+    if(sadr >= DALI_TOPO_SIZE) {
+      sphase = SCAN_ITEMS;
+      _scan_item_start(0);
+      return 1;
+    }
+    rv = _query(DALI_QUERY_RANDOM_ADDRESS_H + ssub, sadr);
+    if(rv < 0) {
+      //lost or duplicate short address: not part of the topology, as with refresh()
+      sfound &= ~((uint64_t)1 << sadr);
+      sadr++;
+      ssub = 0;
+      return 1;
+    }
+    g[sadr].randomadr = (ssub ? g[sadr].randomadr << 8 : 0) | rv;
+    if(++ssub == 3) {
+      sadr++;
+      ssub = 0;
+    }
+    return 1;
+
+  case SCAN_ITEMS: {
+    uint8_t cmd = (sitem < SCAN_ITEM_SCENE0 ? scan_cmd[sitem] : DALI_QUERY_SCENE0_LEVEL + sitem - SCAN_ITEM_SCENE0);
+    while(1) {
+      if(!stodo) {
+        if(++sitem >= SCAN_ITEM_CNT) {
+          sphase = SCAN_IDLE;
+          present = sfound;
+          return 0;
+        }
+        _scan_item_start(sitem);
+        return 1;
+      }
+
+      //confirm a merged reply with one of its gear: replies at different delays overlap and can decode to a value
+      //none of the gear sent
+      if(smerged) {
+        uint8_t adr = 0;
+        while(!((smerged >> adr) & 1)) adr++;
+        uint64_t bit = (uint64_t)1 << adr;
+        uint64_t m = smerged;
+        smerged = 0;
+        stodo &= ~bit;
+        rv = _query(cmd, adr);
+        if(rv < 0) {
+          sfound &= ~bit;
+          return 1;
+        }
+        _scan_set(adr, sitem, rv);
+        if(rv == smerged_val) {
+          for(uint8_t i=0; i<DALI_TOPO_SIZE; i++) {
+            if((m >> i) & 1) _scan_set(i, sitem, rv);
+          }
+          stodo &= ~m;
+          if(sscope > 1) sgroup_pay++;
+        }else{
+          if(sscope > 1) sgroup_pay--;
+          if(sitem == SCAN_ITEM_DT && rv == 0xFF) _scan_next_dt(adr);
+        }
+        return 1;
+      }
+
+      //broadcast: a valid reply is a candidate for all gear (different values collide), confirmed in the next step.
+      //The broadcast and the confirming query pay off from 3 gear on
+      if(sscope == 0) {
+        sscope = 1;
+        if(_count(stodo) < 3) continue;
+        rv = _query_raw(0xFF, cmd);
+        if(rv >= 0 && !(sitem == SCAN_ITEM_DT && rv == 0xFF)) {
+          smerged = stodo;
+          smerged_val = rv;
+        }
+        return 1;
+      }
+
+      //per group, once the groups are known and while the group queries save more frames than they cost
+      if(sscope < SCAN_SCOPE_GEAR) {
+        uint8_t grp = sscope - 1;
+        sscope++;
+        if(sitem <= SCAN_ITEM_GROUPS_8_15 || sgroup_pay < -1) {
+          sscope = SCAN_SCOPE_GEAR;
+          continue;
+        }
+        uint64_t m = 0;
+        for(uint8_t i=0; i<DALI_TOPO_SIZE; i++) {
+          if(((stodo >> i) & 1) && ((g[i].groups >> grp) & 1)) m |= (uint64_t)1 << i;
+        }
+        if(_count(m) < 3) continue;
+        rv = _query_raw(0x80 | grp << 1 | 1, cmd);
+        if(rv >= 0 && !(sitem == SCAN_ITEM_DT && rv == 0xFF)) {
+          smerged = m;
+          smerged_val = rv;
+        }else{
+          sgroup_pay--;
+        }
+        return 1;
+      }
+
+      //gear by gear
+      uint8_t adr = 0;
+      while(!((stodo >> adr) & 1)) adr++;
+      uint64_t bit = (uint64_t)1 << adr;
+      stodo &= ~bit;
+      rv = _query(cmd, adr);
+      if(rv < 0) {
+        sfound &= ~bit;
+        return 1;
+      }
+      _scan_set(adr, sitem, rv);
+      if(sitem == SCAN_ITEM_DT && rv == 0xFF) _scan_next_dt(adr);
+      return 1;
+    }
+  }
+  }
+  return 0;
+}
+
+//-------------------------------------------------
+//SNAPSHOT
+static uint16_t _crc16(uint16_t crc, const uint8_t *data, uint8_t len) {
+  while(len--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for(uint8_t i=0; i<8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+uint16_t DaliTopology::snapshot_size(uint8_t gear_cnt) {
+  return 4 + (uint16_t)gear_cnt * (8 + 1 + DALI_TOPO_DT_MAX + 2 + 16) + 2;
+}
+
+uint16_t DaliTopology::serialize(void (*write_bytes)(const uint8_t *data, uint8_t len)) {
+  uint8_t buf[8 + 1 + DALI_TOPO_DT_MAX + 2 + 16];
+  uint8_t cnt = 0;
+  for(uint8_t i=0; i<DALI_TOPO_SIZE; i++) {
+    if((present >> i) & 1) cnt++;
+  }
+  buf[0] = 'D';
+  buf[1] = 'T';
+  buf[2] = DALI_TOPO_VERSION;
+  buf[3] = cnt;
+  uint16_t crc = _crc16(0xFFFF, buf, 4);
+  write_bytes(buf, 4);
+  uint16_t size = 4;
+
+  for(uint8_t i=0; i<DALI_TOPO_SIZE; i++) {
+    if(!((present >> i) & 1)) continue;
+    const DaliTopoGear *p = &g[i];
+    uint8_t n = 0;
+    buf[n++] = i;
+    buf[n++] = p->randomadr >> 16;
+    buf[n++] = p->randomadr >> 8;
+    buf[n++] = p->randomadr;
+    buf[n++] = p->groups >> 8;
+    buf[n++] = p->groups;
+    buf[n++] = p->min_level;
+    buf[n++] = p->max_level;
+    uint8_t ndt = 0;
+    while(ndt < DALI_TOPO_DT_MAX && p->dt[ndt] != DALI_TOPO_DT_NONE) ndt++;
+    buf[n++] = ndt;
+    for(uint8_t k=0; k<ndt; k++) buf[n++] = p->dt[k];
+    uint16_t scenes = 0;
+    for(uint8_t s=0; s<16; s++) {
+      if(p->scene[s] != 0xFF) scenes |= 1 << s;
+    }
+    buf[n++] = scenes >> 8;
+    buf[n++] = scenes;
+    for(uint8_t s=0; s<16; s++) {
+      if(p->scene[s] != 0xFF) buf[n++] = p->scene[s];
+    }
+    crc = _crc16(crc, buf, n);
+    write_bytes(buf, n);
+    size += n;
+  }
+
+  buf[0] = crc >> 8;
+  buf[1] = crc;
+  write_bytes(buf, 2);
+  return size + 2;
+}
+
+int16_t DaliTopology::deserialize(int16_t (*read_byte)()) {
+  clear();
+  uint16_t crc = 0xFFFF;
+  uint8_t hdr[4];
+  for(uint8_t i=0; i<4; i++) {
+    int16_t b = read_byte();
+    if(b < 0) return -DALI_RESULT_INVALID_SNAPSHOT;
+    hdr[i] = b;
+  }
+  if(hdr[0] != 'D' || hdr[1] != 'T' || (hdr[2] != 1 && hdr[2] != DALI_TOPO_VERSION)) return -DALI_RESULT_INVALID_SNAPSHOT;
+  crc = _crc16(crc, hdr, 4);
+  uint8_t h = (hdr[2] == 1 ? 6 : 8); //bytes before ndt: version 1 has no min/max level
+
+  uint64_t p = 0;
+  for(uint8_t k=0; k<hdr[3]; k++) {
+    uint8_t buf[8 + 1 + DALI_TOPO_DT_MAX + 2 + 16];
+    uint8_t n = 0;
+    uint8_t need = h + 1; //short address .. ndt
+    while(n < need) {
+      int16_t b = read_byte();
+      if(b < 0) return -DALI_RESULT_INVALID_SNAPSHOT;
+      buf[n++] = b;
+      if(n == h + 1) {
+        if(buf[h] > DALI_TOPO_DT_MAX) return -DALI_RESULT_INVALID_SNAPSHOT;
+        need += buf[h] + 2;
+      }else if(n == need && n == h + 1 + buf[h] + 2) {
+        uint16_t scenes = (uint16_t)buf[n - 2] << 8 | buf[n - 1];
+        for(uint8_t s=0; s<16; s++) {
+          if((scenes >> s) & 1) need++;
+        }
+      }
+    }
+    crc = _crc16(crc, buf, n);
+
+    uint8_t adr = buf[0];
+    if(adr >= 64) return -DALI_RESULT_INVALID_SNAPSHOT;
+    if(adr >= DALI_TOPO_SIZE) continue; //no room, the gear is unknown after the warm start
+    DaliTopoGear *q = &g[adr];
+    q->randomadr = (uint32_t)buf[1] << 16 | (uint16_t)buf[2] << 8 | buf[3];
+    q->groups = (uint16_t)buf[4] << 8 | buf[5];
+    q->min_level = (h == 8 ? buf[6] : DALI_TOPO_LEVEL_UNKNOWN);
+    q->max_level = (h == 8 ? buf[7] : DALI_TOPO_LEVEL_UNKNOWN);
+    uint8_t ndt = buf[h];
+    for(uint8_t i=0; i<DALI_TOPO_DT_MAX; i++) q->dt[i] = (i < ndt ? buf[h + 1 + i] : DALI_TOPO_DT_NONE);
+    uint8_t j = h + 1 + ndt;
+    uint16_t scenes = (uint16_t)buf[j] << 8 | buf[j + 1];
+    j += 2;
+    for(uint8_t s=0; s<16; s++) q->scene[s] = ((scenes >> s) & 1) ? buf[j++] : 0xFF;
+    p |= (uint64_t)1 << adr;
+  }
+
+  int16_t c0 = read_byte();
+  int16_t c1 = read_byte();
+  if(c0 < 0 || c1 < 0 || (uint16_t)(c0 << 8 | c1) != crc) return -DALI_RESULT_INVALID_SNAPSHOT;
+  present = p;
+  return DALI_OK;
+}
+
+//-------------------------------------------------
+//VERIFY
+int16_t DaliTopology::verify(uint8_t samples) {
+  mismatch = 0;
+  unaddressed = 0;
+
+  //gear without short address reply to the broadcast unaddressed query (several of them: collision)
+  int16_t rv = _query_raw(0xFD, DALI_QUERY_CONTROL_GEAR_PRESENT);
+  if(rv >= 0 || rv == -DALI_RESULT_COLLISION || rv == -DALI_RESULT_INVALID_REPLY) {
+    unaddressed = 1;
+  }else if(rv != -DALI_RESULT_NO_REPLY) {
+    return rv;
+  }
+
+  //random address of samples gear, spread over the present gear, starting at a different gear every boot
+  uint8_t cnt = 0;
+  for(uint8_t i=0; i<DALI_TOPO_SIZE; i++) {
+    if((present >> i) & 1) cnt++;
+  }
+  if(samples > cnt) samples = cnt;
+  if(samples) {
+    uint8_t step = cnt / samples;
+    uint8_t next = dali->tick() % step;
+    uint8_t k = 0; //index of gear adr in the present list
+    for(uint8_t adr=0; adr<DALI_TOPO_SIZE && samples; adr++) {
+      if(!((present >> adr) & 1)) continue;
+      if(k++ != next) continue;
+      next += step;
+      samples--;
+      uint32_t r;
+      rv = _query_random(adr, &r);
+      if(rv == -DALI_RESULT_NO_REPLY || rv == -DALI_RESULT_COLLISION || rv == -DALI_RESULT_INVALID_REPLY || (rv == DALI_OK && r != g[adr].randomadr)) {
+        mismatch |= (uint64_t)1 << adr;
+      }else if(rv < 0) {
+        return rv;
+      }
+    }
+  }
+  return (mismatch || unaddressed) ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/*###########################################################################
+        copyright qqqlab.com / github.com/qqqlab
+
+        This program is free software: you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation, either version 3 of the License, or
+        (at your option) any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+----------------------------------------------------------------------------
+Bus topology snapshot for a warm start
+
+scan() finds the gear and reads their random address, device types, groups,
+min/max levels and scene levels. Only the presence query (every short
+address) and the random address (every gear) are asked gear by gear, the
+other values are first asked with one broadcast query. Gear holding the
+same value send the same backward frame, but each at its own delay after
+the forward frame (5.5-10.5 ms): only gear which reply at nearly the same
+time (typically the same product) merge into one valid frame, others
+collide, or rarely decode as a value none of them sent. So a merged reply
+is only applied to all gear after one of them confirmed it by short
+address. On a collision or mismatch the value is asked per group (for
+groups with 3 or more gear still to query, while that pays off), then of
+the remaining gear one by one. On a bus of one product, scenes not used
+anywhere (all MASK), the same min/max levels and the groups 8-15 cost two
+frames each instead of one per gear; on a mixed bus the scan costs about
+as much as querying every gear. refresh() queries one gear without
+pruning, 25 frames.
+
+The scan is time sliced: scan_start(), then call scan_update() from loop(),
+it sends one query per call (a gear with several device types: QUERY
+DEVICE TYPE and its QUERY NEXT DEVICE TYPE list, which no other frame may
+interrupt) and spaces the queries to use at most
+scan_budget_permille of the bus time. scan() runs it to the end at full
+speed. scan_start() clears the topology, present is set when the scan
+completes. scan_frames and scan_ticks hold the frames and bus time it took.
+
+serialize() writes the result as a compact binary snapshot, deserialize()
+reads it back after a reboot.
+
+verify() then checks a snapshot against the bus with a few dozen frames
+instead of a full scan:
+- one broadcast-unaddressed query: gear without short address (new or
+  replaced gear) reply
+- the random address of a sample of gear: a different random address means
+  the gear was replaced or the bus re-commissioned
+verify() does not detect addressed gear added from another bus at an unused
+short address, nor group or scene changes made by another controller: run
+scan() (or refresh() for single gear) when that is possible.
+
+Snapshot format, version 2 (all fields bytes, multi byte values MSB first):
+  'D' 'T' version count
+  count records:
+    short_address random_h random_m random_l groups_8_15 groups_0_7
+    min_level max_level
+    ndt dt[ndt] scenes_8_15 scenes_0_7 level[one for each set scene bit]
+  crc16 (CCITT, init 0xFFFF) over all bytes before it
+Scene bit n is set if scene n has a level (not MASK). Version 1 snapshots
+(without min_level and max_level) are read with both set to
+DALI_TOPO_LEVEL_UNKNOWN.
+
+Changelog:
+2026-10-19 Pruned, time sliced scan, min/max levels (snapshot version 2)
+2026-10-19 Created
+###########################################################################*/
+#ifndef qqqDALI_topology_h
+#define qqqDALI_topology_h
+
+#include "qqqDALI.h"
+
+//number of short addresses with a topology entry (28 bytes each), reduce on small micro controllers
+#ifndef DALI_TOPO_SIZE
+#define DALI_TOPO_SIZE 64
+#endif
+
+#define DALI_TOPO_VERSION 2
+#define DALI_TOPO_DT_MAX 4 //device types per gear
+#define DALI_TOPO_DT_NONE 0xFE //unused device type entry (reply of QUERY NEXT DEVICE TYPE after the last type)
+#define DALI_TOPO_LEVEL_UNKNOWN 0xFF //min/max level not known (read from a version 1 snapshot)
+
+struct DaliTopoGear {
+  uint32_t randomadr;          //24 bit random address
+  uint16_t groups;             //bit n: member of group n
+  uint8_t min_level;
+  uint8_t max_level;
+  uint8_t dt[DALI_TOPO_DT_MAX]; //device types, DALI_TOPO_DT_NONE for unused entries
+  uint8_t scene[16];           //scene levels, 0xFF: MASK (not part of the scene)
+};
+
+class DaliTopology {
+public:
+  void begin(Dali *dali);
+
+  //full scan of short addresses 0..DALI_TOPO_SIZE-1, returns number of gear found
+  uint8_t scan();
+  //time sliced scan: scan_start(), then call scan_update() until it returns 0
+  void scan_start();
+  uint8_t scan_update(); //sends one query (or one device type list), returns 1 while the scan runs, 0 when it is complete
+  uint8_t scan_busy();
+  uint16_t scan_budget_permille; //max share of bus time used by scan_update() (default 1000 = as fast as possible)
+  uint32_t scan_frames; //frames of the last (or running) scan
+  uint32_t scan_ticks;  //bus time of the last (or running) scan
+  //query one short address again, returns 1 if present, 0 if not, negative DALI_RESULT_xxx on bus errors
+  int16_t refresh(uint8_t adr);
+
+  //snapshot: write_bytes as for DaliStreamTransport, read_byte returns -1 at the end of the data
+  uint16_t serialize(void (*write_bytes)(const uint8_t *data, uint8_t len)); //returns number of bytes written
+  int16_t deserialize(int16_t (*read_byte)()); //returns DALI_OK or -DALI_RESULT_INVALID_SNAPSHOT (topology is cleared)
+  static uint16_t snapshot_size(uint8_t gear_cnt); //largest snapshot of gear_cnt gear, in bytes
+
+  //check the topology against the bus with 1 + 3*samples frames, or 1 + 3*gear count if samples is 0xFF
+  //returns 0 if the bus matches, 1 if not, or negative DALI_RESULT_xxx on bus errors
+  int16_t verify(uint8_t samples=8);
+  uint64_t mismatch; //short addresses which failed verify() (bit n = short address n)
+  uint8_t unaddressed; //verify() found gear without short address
+
+  void clear();
+  uint64_t present; //short addresses with gear (bit n = short address n)
+  const DaliTopoGear *gear(uint8_t adr); //NULL if not present
+  uint64_t group_members(uint8_t group); //members of group 0-15 (bit n = short address n)
+  uint8_t  has_device_type(uint8_t adr, uint8_t dt);
+
+  uint32_t frames;    //number of frames sent
+  uint32_t bus_ticks; //bus time used by the frames
+
+private:
+  Dali *dali;
+  DaliTopoGear g[DALI_TOPO_SIZE];
+
+  //scan state
+  uint8_t sphase;    //SCAN_xxx
+  uint8_t sadr;      //short address (SCAN_PRESENT, SCAN_RANDOM)
+  uint8_t ssub;      //random address byte
+  uint8_t sitem;     //value asked (index in the scan item table)
+  uint8_t sscope;    //0: broadcast, 1-16: group 0-15, 17: gear by gear
+  int8_t sgroup_pay; //group queries which paid off minus the ones which did not, for sitem
+  uint64_t sfound;   //gear found
+  uint64_t stodo;    //gear which do not have sitem yet
+  uint64_t smerged;  //gear of a merged broadcast/group reply, applied when one of them confirmed it by short address
+  uint8_t smerged_val; //the merged reply
+  uint32_t next_tick; //earliest tick for the next query (bus time budget)
+
+  uint8_t _scan_step();
+  void _scan_item_start(uint8_t item);
+  void _scan_set(uint8_t adr, uint8_t item, uint8_t v);
+  void _scan_next_dt(uint8_t adr);
+  int16_t _query(uint16_t cmd, uint8_t adr);
+  int16_t _query_raw(uint8_t cmd0, uint8_t cmd1);
+  int16_t _query_random(uint8_t adr, uint32_t *randomadr);
+};
+
+#endif